@@ -0,0 +1,213 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * @file bench_common.c
+ *
+ * Helpers shared by the microbenchmarks.
+ */
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "epoxy/egl.h"
+
+#include "bench_common.h"
+
+#define BENCH_RUNS 100
+#define BENCH_CHILD_RUNS 20
+
+static EGLDisplay
+get_display(void)
+{
+    EGLDisplay dpy = EGL_NO_DISPLAY;
+    EGLint major, minor;
+
+    /* Benchmarks shouldn't depend on there being an X server. */
+    if (epoxy_has_egl_extension(EGL_NO_DISPLAY, "EGL_MESA_platform_surfaceless") &&
+        epoxy_has_egl_extension(EGL_NO_DISPLAY, "EGL_EXT_platform_base"))
+        dpy = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA,
+                                       EGL_DEFAULT_DISPLAY, NULL);
+
+    if (dpy == EGL_NO_DISPLAY)
+        dpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    if (dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, &major, &minor))
+        errx(77, "Couldn't initialize an EGL display");
+
+    return dpy;
+}
+
+void
+bench_make_context_current_or_skip(void)
+{
+    EGLDisplay dpy = get_display();
+    EGLint config_attribs[] = {
+        EGL_SURFACE_TYPE, 0,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLContext ctx;
+    EGLConfig cfg;
+    EGLint count;
+
+    if (!epoxy_has_egl_extension(dpy, "EGL_KHR_surfaceless_context"))
+        errx(77, "Benchmarks require EGL_KHR_surfaceless_context");
+
+    if (!eglBindAPI(EGL_OPENGL_API) ||
+        !eglChooseConfig(dpy, config_attribs, &cfg, 1, &count) || !count)
+        errx(77, "Couldn't get a desktop GL EGLConfig");
+
+    ctx = eglCreateContext(dpy, cfg, EGL_NO_CONTEXT, NULL);
+    if (!ctx)
+        errx(77, "Couldn't create a desktop GL context");
+
+    if (!eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx))
+        errx(77, "Couldn't make the context current");
+}
+
+static uint64_t
+now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int
+compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of the sorted samples. */
+static double
+percentile(const double *samples, unsigned count, unsigned percent)
+{
+    unsigned rank = (count * percent + 99) / 100;
+
+    return samples[rank ? rank - 1 : 0];
+}
+
+static void
+summarize(double *samples, unsigned count, struct bench_result *result)
+{
+    qsort(samples, count, sizeof(*samples), compare_doubles);
+
+    result->runs = count;
+    result->min = samples[0];
+    result->p50 = percentile(samples, count, 50);
+    result->p90 = percentile(samples, count, 90);
+    result->p99 = percentile(samples, count, 99);
+}
+
+void
+bench_run(void (*func)(uint32_t iterations), uint32_t iterations,
+          struct bench_result *result)
+{
+    double samples[BENCH_RUNS];
+    int i;
+
+    /* Warm up, which also resolves whatever is being called. */
+    func(iterations);
+
+    for (i = 0; i < BENCH_RUNS; i++) {
+        uint64_t start = now_ns();
+
+        func(iterations);
+        samples[i] = (double)(now_ns() - start) / iterations;
+    }
+
+    summarize(samples, BENCH_RUNS, result);
+}
+
+void
+bench_run_in_child(double (*func)(void), struct bench_result *result)
+{
+    double samples[BENCH_CHILD_RUNS];
+    int i;
+
+    for (i = 0; i < BENCH_CHILD_RUNS; i++) {
+        int fds[2], status;
+        pid_t pid;
+
+        if (pipe(fds) != 0)
+            err(1, "pipe");
+
+        /* Or the child would print what's buffered again when it exits. */
+        fflush(stdout);
+        pid = fork();
+        if (pid < 0)
+            err(1, "fork");
+        if (pid == 0) {
+            double ns = func();
+
+            close(fds[0]);
+            if (write(fds[1], &ns, sizeof(ns)) != sizeof(ns))
+                err(1, "write");
+            exit(0);
+        }
+
+        close(fds[1]);
+        if (read(fds[0], &samples[i], sizeof(samples[i])) != sizeof(samples[i])) {
+            waitpid(pid, &status, 0);
+            if (WIFEXITED(status) && WEXITSTATUS(status) == 77)
+                exit(77);
+            errx(1, "The benchmark's child process failed");
+        }
+        close(fds[0]);
+        waitpid(pid, &status, 0);
+    }
+
+    summarize(samples, BENCH_CHILD_RUNS, result);
+}
+
+void
+bench_report(const char *name, const struct bench_result *result)
+{
+    const char *json_path = getenv("EPOXY_BENCH_JSON");
+
+    printf("%-32s %8.2f ns/op  (p50 %.2f, p90 %.2f, p99 %.2f)\n",
+           name, result->min, result->p50, result->p90, result->p99);
+
+    if (json_path) {
+        FILE *json = fopen(json_path, "a");
+
+        if (!json)
+            err(1, "%s", json_path);
+
+        fprintf(json,
+                "{\"name\": \"%s\", \"unit\": \"ns/op\", \"runs\": %u, "
+                "\"min\": %.2f, \"p50\": %.2f, \"p90\": %.2f, \"p99\": %.2f}\n",
+                name, result->runs, result->min,
+                result->p50, result->p90, result->p99);
+        fclose(json);
+    }
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * @file bench_common.h
+ *
+ * Helpers shared by the microbenchmarks.
+ */
+
+#ifndef BENCH_COMMON_H
+#define BENCH_COMMON_H
+
+#include <stdint.h>
+
+/**
+ * Makes a GL context current on an EGL display that doesn't need a
+ * window system if possible, or exits with 77 (skipped).
+ */
+void
+bench_make_context_current_or_skip(void);
+
+/**
+ * The time an operation took, in nanoseconds, over all the runs of a
+ * benchmark.
+ */
+struct bench_result {
+    unsigned runs;
+    double min;
+    double p50;
+    double p90;
+    double p99;
+};
+
+/**
+ * Runs func, which does the operation being measured "iterations"
+ * times, over and over, and stores how long it took per operation.
+ */
+void
+bench_run(void (*func)(uint32_t iterations), uint32_t iterations,
+          struct bench_result *result);
+
+/**
+ * Runs func over and over, each time in a fresh child process, for
+ * measuring things that only happen once per process.  func returns
+ * the time it measured, in nanoseconds per operation.
+ *
+ * If a child exits with 77 (skipped), so does the caller.
+ */
+void
+bench_run_in_child(double (*func)(void), struct bench_result *result);
+
+/**
+ * Prints the result of a benchmark.
+ *
+ * If EPOXY_BENCH_JSON names a file, the result also gets appended to
+ * it as a line of JSON, for comparing runs with other tools.
+ */
+void
+bench_report(const char *name, const struct bench_result *result);
+
+#endif /* BENCH_COMMON_H */
@@ -0,0 +1,182 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * @file dispatch.c
+ *
+ * Measures the paths every GL call and most epoxy helpers go through:
+ * the first call of a function, which resolves it, later calls through
+ * epoxy's function pointer compared to calling the driver directly,
+ * and the version and extension checks.
+ */
+
+#include <stdint.h>
+#include <time.h>
+
+#include "epoxy/gl.h"
+
+#include "bench_common.h"
+
+#define CALL_ITERATIONS 1000000
+#define STRING_ITERATIONS 1000
+
+/* Not in the registry, so it has to be looked for in the driver's list. */
+#define UNKNOWN_EXTENSION "GL_EPOXY_not_an_extension"
+
+static PFNGLGETERRORPROC driver_glGetError;
+static int extension_id;
+static volatile int sink;
+
+static uint64_t
+now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* The first call in a process, which also sets up the context's state. */
+static double
+first_call(void)
+{
+    uint64_t start;
+
+    bench_make_context_current_or_skip();
+
+    start = now_ns();
+    glGetError();
+    return now_ns() - start;
+}
+
+/* The first call of a function, once the context's state is known. */
+static double
+first_call_after_another(void)
+{
+    uint64_t start;
+
+    bench_make_context_current_or_skip();
+    glGetError();
+
+    start = now_ns();
+    glIsEnabled(GL_DITHER);
+    return now_ns() - start;
+}
+
+static void
+call_pointer(uint32_t iterations)
+{
+    uint32_t i;
+
+    for (i = 0; i < iterations; i++)
+        glGetError();
+}
+
+static void
+call_driver(uint32_t iterations)
+{
+    uint32_t i;
+
+    for (i = 0; i < iterations; i++)
+        driver_glGetError();
+}
+
+static void
+is_desktop_gl(uint32_t iterations)
+{
+    uint32_t i;
+
+    for (i = 0; i < iterations; i++)
+        sink = epoxy_is_desktop_gl();
+}
+
+static void
+gl_version(uint32_t iterations)
+{
+    uint32_t i;
+
+    for (i = 0; i < iterations; i++)
+        sink = epoxy_gl_version();
+}
+
+static void
+has_extension(uint32_t iterations)
+{
+    uint32_t i;
+
+    for (i = 0; i < iterations; i++)
+        sink = epoxy_has_gl_extension("GL_ARB_vertex_buffer_object");
+}
+
+static void
+has_extension_id(uint32_t iterations)
+{
+    uint32_t i;
+
+    for (i = 0; i < iterations; i++)
+        sink = epoxy_has_gl_extension_id(extension_id);
+}
+
+static void
+has_unknown_extension(uint32_t iterations)
+{
+    uint32_t i;
+
+    for (i = 0; i < iterations; i++)
+        sink = epoxy_has_gl_extension(UNKNOWN_EXTENSION);
+}
+
+int
+main(int argc, char **argv)
+{
+    struct bench_result result;
+
+    bench_run_in_child(first_call, &result);
+    bench_report("first call", &result);
+    bench_run_in_child(first_call_after_another, &result);
+    bench_report("first call after another", &result);
+
+    bench_make_context_current_or_skip();
+
+    driver_glGetError = epoxy_lookup("glGetError");
+    extension_id = epoxy_gl_extension_id("GL_ARB_vertex_buffer_object");
+
+    bench_run(call_pointer, CALL_ITERATIONS, &result);
+    bench_report("glGetError epoxy pointer", &result);
+    bench_run(call_driver, CALL_ITERATIONS, &result);
+    bench_report("glGetError driver pointer", &result);
+
+    bench_run(is_desktop_gl, CALL_ITERATIONS, &result);
+    bench_report("epoxy_is_desktop_gl()", &result);
+    bench_run(gl_version, CALL_ITERATIONS, &result);
+    bench_report("epoxy_gl_version()", &result);
+
+    bench_run(has_extension, CALL_ITERATIONS, &result);
+    bench_report("epoxy_has_gl_extension()", &result);
+    bench_run(has_extension_id, CALL_ITERATIONS, &result);
+    bench_report("epoxy_has_gl_extension_id()", &result);
+    bench_run(has_unknown_extension, STRING_ITERATIONS, &result);
+    bench_report("epoxy_has_gl_extension() unknown", &result);
+
+    return 0;
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * @file extension_set.c
+ *
+ * Measures checking for extensions in a list of them, searching the
+ * list with epoxy_extension_in_string() compared to splitting it up
+ * once with epoxy_extension_set_create() and checking the set, over a
+ * made up list as long as the EGL and GLX ones of the big drivers.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "epoxy/common.h"
+
+#include "bench_common.h"
+
+/* About 20 KB of names. */
+#define LIST_EXTENSIONS 600
+
+/* As many checks as a renderer probing what it can use would make,
+ * half of them for extensions that aren't in the list.
+ */
+#define CHECKS 64
+
+#define CHECK_ITERATIONS 100
+#define CREATE_ITERATIONS 100
+
+static char *list;
+static char checks[CHECKS][48];
+static struct epoxy_extension_set *set;
+static volatile int sink;
+
+static void
+make_list(void)
+{
+    size_t length = 0;
+    unsigned i;
+
+    list = malloc(LIST_EXTENSIONS * 40);
+    if (!list)
+        abort();
+
+    for (i = 0; i < LIST_EXTENSIONS; i++) {
+        length += sprintf(list + length, "%sEGL_EPOXY_made_up_extension_%u",
+                          i ? " " : "", i * 7919 % 10007);
+    }
+
+    /* The same prefix as the names in the list, which is the slow case
+     * for searching it.
+     */
+    for (i = 0; i < CHECKS; i++) {
+        sprintf(checks[i], "EGL_EPOXY_made_up_extension_%u",
+                i % 2 ? (i * 9 % LIST_EXTENSIONS) * 7919 % 10007 : 10007 + i);
+    }
+}
+
+static void
+in_string(uint32_t iterations)
+{
+    uint32_t i, j;
+
+    for (i = 0; i < iterations; i++) {
+        for (j = 0; j < CHECKS; j++)
+            sink = epoxy_extension_in_string(list, checks[j]);
+    }
+}
+
+static void
+set_has(uint32_t iterations)
+{
+    uint32_t i, j;
+
+    for (i = 0; i < iterations; i++) {
+        for (j = 0; j < CHECKS; j++)
+            sink = epoxy_extension_set_has(set, checks[j]);
+    }
+}
+
+static void
+set_create(uint32_t iterations)
+{
+    uint32_t i;
+
+    for (i = 0; i < iterations; i++)
+        epoxy_extension_set_destroy(epoxy_extension_set_create(list));
+}
+
+static void
+create_and_check(uint32_t iterations)
+{
+    uint32_t i, j;
+
+    for (i = 0; i < iterations; i++) {
+        struct epoxy_extension_set *fresh = epoxy_extension_set_create(list);
+
+        for (j = 0; j < CHECKS; j++)
+            sink = epoxy_extension_set_has(fresh, checks[j]);
+        epoxy_extension_set_destroy(fresh);
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    struct bench_result result;
+
+    make_list();
+    set = epoxy_extension_set_create(list);
+    if (!set)
+        return 1;
+
+    bench_run(in_string, CHECK_ITERATIONS, &result);
+    bench_report("epoxy_extension_in_string() x64", &result);
+
+    bench_run(set_has, CHECK_ITERATIONS, &result);
+    bench_report("epoxy_extension_set_has() x64", &result);
+
+    bench_run(set_create, CREATE_ITERATIONS, &result);
+    bench_report("epoxy_extension_set_create()", &result);
+
+    bench_run(create_and_check, CREATE_ITERATIONS, &result);
+    bench_report("epoxy_extension_set_create() and has() x64", &result);
+
+    epoxy_extension_set_destroy(set);
+    return 0;
+}
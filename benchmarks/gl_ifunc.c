@@ -0,0 +1,90 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * @file gl_ifunc.c
+ *
+ * Compares the cost of calling a GL function through epoxy's function
+ * pointer, through the IFUNC that epoxy exports for it when built with
+ * -Difunc=true, and straight through the driver's function pointer.
+ *
+ * The IFUNC only gets bound to the driver if the dynamic linker
+ * resolves it at the first call, with a context current, so this has
+ * to be linked with lazy binding.
+ */
+
+#define EPOXY_GL_IFUNC
+
+#include "epoxy/gl.h"
+
+#include "bench_common.h"
+
+#define ITERATIONS 1000000
+
+static PFNGLGETERRORPROC driver_glGetError;
+
+static void
+call_pointer(uint32_t iterations)
+{
+    uint32_t i;
+
+    for (i = 0; i < iterations; i++)
+        epoxy_glGetError();
+}
+
+static void
+call_ifunc(uint32_t iterations)
+{
+    uint32_t i;
+
+    for (i = 0; i < iterations; i++)
+        glGetError();
+}
+
+static void
+call_driver(uint32_t iterations)
+{
+    uint32_t i;
+
+    for (i = 0; i < iterations; i++)
+        driver_glGetError();
+}
+
+int
+main(int argc, char **argv)
+{
+    struct bench_result result;
+
+    bench_make_context_current_or_skip();
+
+    driver_glGetError = epoxy_lookup("glGetError");
+
+    bench_run(call_pointer, ITERATIONS, &result);
+    bench_report("glGetError epoxy pointer", &result);
+    bench_run(call_ifunc, ITERATIONS, &result);
+    bench_report("glGetError ifunc", &result);
+    bench_run(call_driver, ITERATIONS, &result);
+    bench_report("glGetError driver pointer", &result);
+
+    return 0;
+}
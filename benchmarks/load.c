@@ -0,0 +1,236 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * @file load.c
+ *
+ * Measures what loading libepoxy costs a process: how long dlopen()
+ * takes to map and relocate it, how much of it the relocations leave
+ * as private dirty memory, and how many relocations there are.  It
+ * also reports how big the library's segments are, to keep track of
+ * how much code and data the generated dispatch amounts to.
+ *
+ * Each load happens in a fresh child process, since the library can
+ * only be loaded once per process.
+ */
+
+#define _GNU_SOURCE
+
+#include <dlfcn.h>
+#include <err.h>
+#include <limits.h>
+#include <link.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef DT_RELRSZ
+#define DT_RELRSZ 35
+#endif
+
+#define LOAD_RUNS 20
+
+struct load_result {
+    uint64_t ns;
+    unsigned long dirty_kb;
+    unsigned long text_kb;
+    unsigned long mapped_kb;
+    unsigned long rela_count;
+    unsigned long relr_bytes;
+
+    uintptr_t base;
+};
+
+static uint64_t
+now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Sums up the Private_Dirty of the mappings of the given file. */
+static unsigned long
+private_dirty_kb(const char *path)
+{
+    FILE *smaps = fopen("/proc/self/smaps", "r");
+    char line[PATH_MAX + 128];
+    unsigned long total = 0;
+    bool in_library = false;
+
+    if (!smaps)
+        return 0;
+
+    while (fgets(line, sizeof(line), smaps)) {
+        unsigned long start, end, kb;
+        char *name;
+
+        if (sscanf(line, "Private_Dirty: %lu kB", &kb) == 1) {
+            if (in_library)
+                total += kb;
+        } else if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+            /* The start of a mapping; its file name is the last field. */
+            name = strchr(line, '/');
+            in_library = name && strncmp(name, path, strlen(path)) == 0 &&
+                name[strlen(path)] == '\n';
+        }
+    }
+
+    fclose(smaps);
+    return total;
+}
+
+static void
+count_relocations(void *handle, struct load_result *result)
+{
+    struct link_map *map;
+    const ElfW(Dyn) *dyn;
+    unsigned long rela_size = 0, rela_ent = sizeof(ElfW(Rela)), plt_size = 0;
+
+    if (dlinfo(handle, RTLD_DI_LINKMAP, &map) != 0)
+        return;
+    result->base = map->l_addr;
+
+    for (dyn = map->l_ld; dyn->d_tag != DT_NULL; dyn++) {
+        switch (dyn->d_tag) {
+        case DT_RELASZ:
+            rela_size = dyn->d_un.d_val;
+            break;
+        case DT_RELAENT:
+            rela_ent = dyn->d_un.d_val;
+            break;
+        case DT_PLTRELSZ:
+            plt_size = dyn->d_un.d_val;
+            break;
+        case DT_RELRSZ:
+            result->relr_bytes = dyn->d_un.d_val;
+            break;
+        }
+    }
+
+    /* DT_RELASZ may or may not include the PLT relocations, which
+     * follow the others when it does.
+     */
+    result->rela_count = (rela_size + plt_size) / rela_ent;
+}
+
+static int
+measure_segments(struct dl_phdr_info *info, size_t size, void *data)
+{
+    struct load_result *result = data;
+    unsigned long text = 0, mapped = 0;
+    int i;
+
+    (void)size;
+
+    if (info->dlpi_addr != result->base)
+        return 0;
+
+    for (i = 0; i < info->dlpi_phnum; i++) {
+        const ElfW(Phdr) *phdr = &info->dlpi_phdr[i];
+
+        if (phdr->p_type != PT_LOAD)
+            continue;
+        mapped += phdr->p_memsz;
+        if (phdr->p_flags & PF_X)
+            text += phdr->p_memsz;
+    }
+
+    result->text_kb = text / 1024;
+    result->mapped_kb = mapped / 1024;
+    return 1;
+}
+
+static void
+load(const char *path, int fd)
+{
+    struct load_result result = { 0 };
+    uint64_t start = now_ns();
+    void *handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+
+    result.ns = now_ns() - start;
+    if (!handle)
+        errx(1, "Couldn't load %s: %s", path, dlerror());
+
+    result.dirty_kb = private_dirty_kb(path);
+    count_relocations(handle, &result);
+    dl_iterate_phdr(measure_segments, &result);
+
+    if (write(fd, &result, sizeof(result)) != sizeof(result))
+        err(1, "write");
+    _exit(0);
+}
+
+int
+main(int argc, char **argv)
+{
+    struct load_result best = { .ns = UINT64_MAX };
+    char path[PATH_MAX];
+    int i;
+
+    if (argc != 2)
+        errx(1, "usage: %s path/to/libepoxy.so", argv[0]);
+    if (!realpath(argv[1], path))
+        err(1, "%s", argv[1]);
+
+    for (i = 0; i < LOAD_RUNS; i++) {
+        struct load_result result;
+        int fds[2], status;
+        pid_t pid;
+
+        if (pipe(fds) != 0)
+            err(1, "pipe");
+
+        pid = fork();
+        if (pid < 0)
+            err(1, "fork");
+        if (pid == 0) {
+            close(fds[0]);
+            load(path, fds[1]);
+        }
+
+        close(fds[1]);
+        if (read(fds[0], &result, sizeof(result)) != sizeof(result))
+            errx(1, "Loading the library failed");
+        close(fds[0]);
+        waitpid(pid, &status, 0);
+
+        if (result.ns < best.ns)
+            best = result;
+    }
+
+    printf("%-32s %8.2f ns/op\n", "dlopen", (double)best.ns);
+    printf("%-32s %8lu kB\n", "private dirty", best.dirty_kb);
+    printf("%-32s %8lu\n", "rela relocations", best.rela_count);
+    printf("%-32s %8lu bytes\n", "relr relocations", best.relr_bytes);
+    printf("%-32s %8lu kB\n", "code", best.text_kb);
+    printf("%-32s %8lu kB\n", "mapped", best.mapped_kb);
+
+    return 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * @file resolve.c
+ *
+ * Measures how long resolving the GL functions takes, by resolving
+ * all of them with epoxy_resolve_all().
+ *
+ * Functions only get resolved once per process, so each run happens
+ * in a fresh child process.
+ */
+
+#include <stdint.h>
+#include <time.h>
+
+#include "epoxy/gl.h"
+
+#include "bench_common.h"
+
+static uint64_t
+now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static double
+resolve_all(void)
+{
+    uint64_t start;
+    int resolved;
+
+    bench_make_context_current_or_skip();
+
+    start = now_ns();
+    resolved = epoxy_resolve_all();
+    return (double)(now_ns() - start) / (resolved ? resolved : 1);
+}
+
+int
+main(int argc, char **argv)
+{
+    struct bench_result result;
+
+    bench_run_in_child(resolve_all, &result);
+    bench_report("epoxy_resolve_all() per function", &result);
+
+    return 0;
+}
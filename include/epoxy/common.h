@@ -53,11 +53,26 @@ typedef unsigned char bool;
 # include <stdbool.h>
 #endif
 
+#include <stddef.h>
+
 EPOXY_BEGIN_DECLS
 
 EPOXY_PUBLIC bool epoxy_extension_in_string(const char *extension_list,
                                             const char *ext);
 
+struct epoxy_extension_set;
+
+EPOXY_PUBLIC struct epoxy_extension_set *
+epoxy_extension_set_create(const char *extension_list);
+EPOXY_PUBLIC void epoxy_extension_set_destroy(struct epoxy_extension_set *set);
+EPOXY_PUBLIC bool epoxy_extension_set_has(const struct epoxy_extension_set *set,
+                                          const char *ext);
+EPOXY_PUBLIC unsigned int
+epoxy_extension_set_count(const struct epoxy_extension_set *set);
+EPOXY_PUBLIC const char *
+epoxy_extension_set_next(const struct epoxy_extension_set *set,
+                         unsigned int *iter, size_t *len);
+
 EPOXY_END_DECLS
 
 #endif /* EPOXY_COMMON_H */
@@ -92,10 +92,89 @@ EPOXY_BEGIN_DECLS
 #include "epoxy/gl_generated.h"
 
 EPOXY_PUBLIC bool epoxy_has_gl_extension(const char *extension);
+EPOXY_PUBLIC int epoxy_gl_extension_id(const char *extension);
+EPOXY_PUBLIC bool epoxy_has_gl_extension_id(int id);
+EPOXY_PUBLIC uint64_t epoxy_has_gl_extension_ids(const int *ids, int count);
 EPOXY_PUBLIC bool epoxy_is_desktop_gl(void);
 EPOXY_PUBLIC int epoxy_gl_version(void);
 EPOXY_PUBLIC int epoxy_glsl_version(void);
 
+/* the window system binding of a context */
+typedef enum {
+    EPOXY_CONTEXT_PLATFORM_NONE = 0,
+    EPOXY_CONTEXT_PLATFORM_GLX,
+    EPOXY_CONTEXT_PLATFORM_EGL,
+    EPOXY_CONTEXT_PLATFORM_WGL,
+} epoxy_context_platform_t;
+
+/*
+ * facts about the current context, as cached by epoxy the first time
+ * they were needed; the versions use the same encoding as
+ * epoxy_gl_version() and epoxy_glsl_version()
+ */
+struct epoxy_context_info {
+    epoxy_context_platform_t platform;
+    void *display;
+    void *context;
+    bool is_desktop_gl;
+    int gl_version;
+    int glsl_version;
+};
+
+EPOXY_PUBLIC bool epoxy_get_context_info(struct epoxy_context_info *info);
+
+EPOXY_PUBLIC int epoxy_resolve_all(void);
+EPOXY_PUBLIC int epoxy_resolve_feature(const char *feature);
+EPOXY_PUBLIC void *epoxy_lookup(const char *name);
+EPOXY_PUBLIC int epoxy_preresolve_profile(const char *path);
+
+/*
+ * the calls made to a function while running with EPOXY_STATS, summed
+ * over every thread; only a sample of the calls gets timed
+ */
+struct epoxy_stats_entry {
+    const char *name;
+    uint64_t calls;
+    uint64_t sampled_calls;
+    uint64_t sampled_ns;
+};
+
+struct epoxy_stats {
+    uint64_t frames;
+    int entry_count;
+    struct epoxy_stats_entry *entries;
+};
+
+EPOXY_PUBLIC bool epoxy_stats_snapshot(struct epoxy_stats *stats);
+EPOXY_PUBLIC void epoxy_stats_release(struct epoxy_stats *stats);
+
+EPOXY_PUBLIC bool epoxy_trace_start(void);
+EPOXY_PUBLIC void epoxy_trace_stop(void);
+EPOXY_PUBLIC bool epoxy_trace_flush(const char *path, unsigned last_ms);
+
+EPOXY_PUBLIC bool epoxy_queue_start(void);
+EPOXY_PUBLIC void epoxy_queue_finish(void);
+EPOXY_PUBLIC void epoxy_queue_stop(void);
+
+/*
+ * the calls made to the functions that the shadow state keeps track of,
+ * summed over every thread
+ */
+struct epoxy_shadow_state_stats {
+    uint64_t calls;
+    uint64_t dropped;
+    uint64_t invalidations;
+    uint64_t queries;
+    uint64_t queries_answered;
+};
+
+EPOXY_PUBLIC bool epoxy_shadow_state_start(void);
+EPOXY_PUBLIC void epoxy_shadow_state_stop(void);
+EPOXY_PUBLIC bool epoxy_shadow_state_snapshot(struct epoxy_shadow_state_stats *stats);
+
+EPOXY_PUBLIC bool epoxy_query_cache_start(void);
+EPOXY_PUBLIC void epoxy_query_cache_stop(void);
+
 /*
  * the type of the stub function that the failure handler must return;
  * this function will be called on subsequent calls to the same bogus
@@ -110,6 +189,32 @@ typedef epoxy_resolver_stub_t
 EPOXY_PUBLIC epoxy_resolver_failure_handler_t
 epoxy_set_resolver_failure_handler(epoxy_resolver_failure_handler_t handler);
 
+/*
+ * what resolving a function involved: the provider that got chosen
+ * (NULL if none was found) and what looked the function up, the
+ * libraries that had to be opened for it, and in nanoseconds, how long
+ * it all took, how much of it went into deciding on the provider and
+ * loading the function from it, and how much into dlopen()
+ */
+struct epoxy_resolve_event {
+    const char *name;
+    const char *provider;
+    const char *loader;
+    const char *const *libraries;
+    int library_count;
+    void *function;
+    uint64_t elapsed_ns;
+    uint64_t condition_ns;
+    uint64_t load_ns;
+    uint64_t dlopen_ns;
+};
+
+typedef void (*epoxy_resolve_listener_t)(const struct epoxy_resolve_event *event,
+                                         void *data);
+
+EPOXY_PUBLIC void
+epoxy_set_resolve_listener(epoxy_resolve_listener_t listener, void *data);
+
 EPOXY_END_DECLS
 
 #endif /* EPOXY_GL_H */
@@ -0,0 +1,551 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * @file dispatch_cache.c
+ *
+ * Implements EPOXY_RESOLVE_CACHE, a file remembering where the
+ * functions an app used were found, so that later runs against the
+ * same driver can skip looking them up.
+ *
+ * Each function is stored as an offset from the load address of the
+ * library it was found in, and libraries are identified by their ELF
+ * build-id, so the cache only gets used when exactly the same
+ * libraries are loaded.  The GL renderer and version strings are part
+ * of the key too, since they decide which providers get used, and so
+ * are the registry extensions the context has, which can change
+ * without either of them (with MESA_EXTENSION_OVERRIDE, say).
+ *
+ * A file that doesn't parse all the way through gets ignored as a
+ * whole, without presetting any of the functions in it.
+ *
+ * Only pointers to symbols that the libraries export get cached.
+ * Pointers handed out by GetProcAddress for anything else may be
+ * stubs that got assigned to the function at runtime, which could
+ * belong to a different function in the next run.
+ */
+
+#define _GNU_SOURCE
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "dispatch_common.h"
+
+#ifdef __ELF__
+
+#include <dlfcn.h>
+#include <inttypes.h>
+#include <link.h>
+#include <unistd.h>
+
+#define CACHE_MAGIC "epoxy-resolve-cache 2"
+
+/* Enough for the hex of the usual 20 byte SHA-1 build-ids, and then
+ * some.
+ */
+#define MAX_BUILD_ID 64
+
+struct cache_object {
+    uintptr_t base;
+    uintptr_t start, end;
+    char build_id[2 * MAX_BUILD_ID + 1];
+
+    /* Index in the cache file's list of libraries, or -1. */
+    int library;
+};
+
+struct cache_objects {
+    struct cache_object *objects;
+    size_t count, size;
+};
+
+struct cache_preset {
+    bool (*preset)(int function, void *func);
+    int function;
+    void *func;
+};
+
+static const struct cache_target {
+    const int *count;
+    const char *(*name)(int function);
+    int (*lookup)(const char *name, size_t len);
+    void *(*resolved)(int function);
+    bool (*preset)(int function, void *func);
+} cache_targets[] = {
+    { &gl_function_count, gl_function_name, gl_function_lookup,
+      gl_resolved_function, gl_preset_function },
+#if PLATFORM_HAS_EGL
+    { &egl_function_count, egl_function_name, egl_function_lookup,
+      egl_resolved_function, egl_preset_function },
+#endif
+#if PLATFORM_HAS_GLX
+    { &glx_function_count, glx_function_name, glx_function_lookup,
+      glx_resolved_function, glx_preset_function },
+#endif
+};
+
+#define ARRAY_SIZE(arr) (sizeof(arr) / sizeof(arr[0]))
+
+/* The file, and the key of the context it was loaded for. */
+static char *cache_path;
+static int cache_platform;
+static char *cache_renderer;
+static char *cache_version;
+static char *cache_extensions;
+
+/* Whether the file matched, and how many functions it had. */
+static bool cache_matched;
+static int cache_loaded;
+
+static bool
+note_build_id(struct dl_phdr_info *info, const ElfW(Phdr) *phdr, char *out)
+{
+    size_t align = phdr->p_align == 8 ? 8 : 4;
+    const char *note = (const char *)(info->dlpi_addr + phdr->p_vaddr);
+    const char *end = note + phdr->p_memsz;
+
+    while (note + sizeof(ElfW(Nhdr)) <= end) {
+        const ElfW(Nhdr) *nhdr = (const ElfW(Nhdr) *)note;
+        const char *name = note + sizeof(*nhdr);
+        const unsigned char *desc =
+            (const unsigned char *)name + ((nhdr->n_namesz + align - 1) & ~(align - 1));
+
+        if (nhdr->n_type == NT_GNU_BUILD_ID &&
+            nhdr->n_namesz == 4 && memcmp(name, "GNU", 4) == 0) {
+            size_t i;
+
+            if (nhdr->n_descsz == 0 || nhdr->n_descsz > MAX_BUILD_ID)
+                return false;
+
+            for (i = 0; i < nhdr->n_descsz; i++)
+                sprintf(out + 2 * i, "%02x", desc[i]);
+            return true;
+        }
+
+        note = (const char *)desc + ((nhdr->n_descsz + align - 1) & ~(align - 1));
+    }
+
+    return false;
+}
+
+static int
+collect_object(struct dl_phdr_info *info, size_t size, void *data)
+{
+    struct cache_objects *list = data;
+    struct cache_object object;
+    bool have_build_id = false;
+    int i;
+
+    (void)size;
+
+    /* The app's functions aren't driver functions, even if it has
+     * replaced some pointers with them.
+     */
+    if (!info->dlpi_name || !info->dlpi_name[0])
+        return 0;
+
+    memset(&object, 0, sizeof(object));
+    object.base = info->dlpi_addr;
+    object.start = UINTPTR_MAX;
+    object.library = -1;
+
+    for (i = 0; i < info->dlpi_phnum; i++) {
+        const ElfW(Phdr) *phdr = &info->dlpi_phdr[i];
+
+        if (phdr->p_type == PT_LOAD) {
+            uintptr_t start = info->dlpi_addr + phdr->p_vaddr;
+
+            if (start < object.start)
+                object.start = start;
+            if (start + phdr->p_memsz > object.end)
+                object.end = start + phdr->p_memsz;
+        } else if (phdr->p_type == PT_NOTE && !have_build_id) {
+            have_build_id = note_build_id(info, phdr, object.build_id);
+        }
+    }
+
+    /* Neither are epoxy's own. */
+    if (!have_build_id || object.start >= object.end ||
+        ((uintptr_t)collect_object >= object.start &&
+         (uintptr_t)collect_object < object.end))
+        return 0;
+
+    if (list->count == list->size) {
+        size_t new_size = list->size ? list->size * 2 : 32;
+        struct cache_object *objects = realloc(list->objects,
+                                               new_size * sizeof(*objects));
+
+        if (!objects)
+            return 1;
+        list->objects = objects;
+        list->size = new_size;
+    }
+
+    list->objects[list->count++] = object;
+
+    return 0;
+}
+
+static void
+collect_objects(struct cache_objects *list)
+{
+    memset(list, 0, sizeof(*list));
+    dl_iterate_phdr(collect_object, list);
+}
+
+static struct cache_object *
+find_object(struct cache_objects *list, uintptr_t addr)
+{
+    size_t i;
+
+    for (i = 0; i < list->count; i++) {
+        if (addr >= list->objects[i].start && addr < list->objects[i].end)
+            return &list->objects[i];
+    }
+
+    return NULL;
+}
+
+static char *
+context_string(GLenum name)
+{
+    const char *string = (const char *)glGetString(name);
+
+    return strdup(string ? string : "");
+}
+
+/* The registry extensions of the context, as hex digits of four
+ * extension IDs each.
+ */
+static char *
+context_extensions(void)
+{
+    int digits = (gl_extension_count + 3) / 4;
+    char *string = malloc(digits + 1);
+    int i, id;
+
+    if (!string)
+        return NULL;
+
+    for (i = 0; i < digits; i++) {
+        int nibble = 0;
+
+        for (id = 4 * i; id < 4 * i + 4 && id < gl_extension_count; id++) {
+            if (epoxy_conservative_has_gl_extension_id(id))
+                nibble |= 1 << (id % 4);
+        }
+        string[i] = "0123456789abcdef"[nibble];
+    }
+    string[digits] = 0;
+
+    return string;
+}
+
+static bool
+key_matches(const char *line, const char *key, const char *value)
+{
+    size_t len = strlen(key);
+
+    return strncmp(line, key, len) == 0 && line[len] == ' ' &&
+        strcmp(line + len + 1, value) == 0;
+}
+
+static int
+cache_lookup(const char *name, size_t len, const struct cache_target **target)
+{
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(cache_targets); i++) {
+        int function = cache_targets[i].lookup(name, len);
+
+        if (function >= 0) {
+            *target = &cache_targets[i];
+            return function;
+        }
+    }
+
+    return -1;
+}
+
+/* Reads the cache, presetting the functions in it if its key matches
+ * the current context and the loaded libraries.  Returns whether it
+ * matched.
+ */
+static bool
+read_cache(FILE *file, struct cache_objects *objects)
+{
+    struct cache_object **libraries = NULL;
+    size_t num_libraries = 0;
+    struct cache_preset *presets = NULL;
+    size_t num_presets = 0;
+    size_t i;
+    char line[1024];
+    int platform;
+    bool matched = false;
+
+    if (!fgets(line, sizeof(line), file) ||
+        strcmp(line, CACHE_MAGIC "\n") != 0)
+        goto out;
+
+    if (!fgets(line, sizeof(line), file) ||
+        sscanf(line, "platform %d", &platform) != 1 ||
+        platform != cache_platform)
+        goto out;
+
+    if (!fgets(line, sizeof(line), file))
+        goto out;
+    line[strcspn(line, "\n")] = 0;
+    if (!key_matches(line, "renderer", cache_renderer))
+        goto out;
+
+    if (!fgets(line, sizeof(line), file))
+        goto out;
+    line[strcspn(line, "\n")] = 0;
+    if (!key_matches(line, "version", cache_version))
+        goto out;
+
+    if (!fgets(line, sizeof(line), file))
+        goto out;
+    line[strcspn(line, "\n")] = 0;
+    if (!key_matches(line, "extensions", cache_extensions))
+        goto out;
+
+    while (fgets(line, sizeof(line), file)) {
+        char build_id[2 * MAX_BUILD_ID + 1];
+        unsigned library;
+        uintptr_t offset;
+        int name_start;
+
+        line[strcspn(line, "\n")] = 0;
+
+        if (sscanf(line, "library %128s", build_id) == 1) {
+            struct cache_object **new_libraries;
+
+            for (i = 0; i < objects->count; i++) {
+                if (strcmp(objects->objects[i].build_id, build_id) == 0)
+                    break;
+            }
+            if (i == objects->count)
+                goto out;
+
+            new_libraries = realloc(libraries, (num_libraries + 1) * sizeof(*libraries));
+            if (!new_libraries)
+                goto out;
+            libraries = new_libraries;
+            libraries[num_libraries++] = &objects->objects[i];
+        } else if (sscanf(line, "function %u %" SCNxPTR " %n",
+                          &library, &offset, &name_start) == 2) {
+            const struct cache_target *target;
+            const char *name = line + name_start;
+            int function = cache_lookup(name, strlen(name), &target);
+            struct cache_preset *new_presets;
+            struct cache_object *object;
+            uintptr_t addr;
+
+            if (library >= num_libraries || function < 0)
+                goto out;
+
+            object = libraries[library];
+            addr = object->base + offset;
+            if (addr < object->start || addr >= object->end)
+                goto out;
+
+            new_presets = realloc(presets, (num_presets + 1) * sizeof(*presets));
+            if (!new_presets)
+                goto out;
+            presets = new_presets;
+            presets[num_presets].preset = target->preset;
+            presets[num_presets].function = function;
+            presets[num_presets].func = (void *)addr;
+            num_presets++;
+        } else {
+            goto out;
+        }
+    }
+
+    for (i = 0; i < num_presets; i++) {
+        presets[i].preset(presets[i].function, presets[i].func);
+        cache_loaded++;
+    }
+    matched = true;
+
+out:
+    free(presets);
+    free(libraries);
+    return matched;
+}
+
+void
+epoxy_resolve_cache_load(const char *path)
+{
+    struct epoxy_context_info info;
+    struct cache_objects objects;
+    FILE *file;
+
+    if (cache_path || !epoxy_get_context_info(&info))
+        return;
+
+    cache_path = strdup(path);
+    cache_platform = info.platform;
+    cache_renderer = context_string(GL_RENDERER);
+    cache_version = context_string(GL_VERSION);
+    cache_extensions = context_extensions();
+    if (!cache_path || !cache_renderer || !cache_version || !cache_extensions)
+        return;
+
+    file = fopen(path, "r");
+    if (!file)
+        return;
+
+    collect_objects(&objects);
+    cache_matched = read_cache(file, &objects);
+    free(objects.objects);
+
+    fclose(file);
+}
+
+static void
+write_cache(FILE *file, struct cache_objects *objects)
+{
+    int num_libraries = 0;
+    size_t i;
+
+    fprintf(file, CACHE_MAGIC "\n");
+    fprintf(file, "platform %d\n", cache_platform);
+    fprintf(file, "renderer %s\n", cache_renderer);
+    fprintf(file, "version %s\n", cache_version);
+    fprintf(file, "extensions %s\n", cache_extensions);
+
+    for (i = 0; i < ARRAY_SIZE(cache_targets); i++) {
+        const struct cache_target *target = &cache_targets[i];
+        int function;
+
+        for (function = 0; function < *target->count; function++) {
+            void *func = target->resolved(function);
+            struct cache_object *object;
+            Dl_info info;
+
+            if (!func || !dladdr(func, &info) ||
+                !info.dli_sname || info.dli_saddr != func)
+                continue;
+
+            object = find_object(objects, (uintptr_t)func);
+            if (!object)
+                continue;
+
+            if (object->library < 0) {
+                object->library = num_libraries++;
+                fprintf(file, "library %s\n", object->build_id);
+            }
+
+            fprintf(file, "function %d %" PRIxPTR " %s\n", object->library,
+                    (uintptr_t)func - object->base, target->name(function));
+        }
+    }
+}
+
+static int
+count_cacheable(void)
+{
+    int count = 0;
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(cache_targets); i++) {
+        int function;
+
+        for (function = 0; function < *cache_targets[i].count; function++) {
+            void *func = cache_targets[i].resolved(function);
+            Dl_info info;
+
+            if (func && dladdr(func, &info) &&
+                info.dli_sname && info.dli_saddr == func)
+                count++;
+        }
+    }
+
+    return count;
+}
+
+void
+epoxy_resolve_cache_save(void)
+{
+    struct cache_objects objects;
+    char *tmp_path;
+    FILE *file;
+    int fd;
+
+    if (!cache_path || !cache_renderer || !cache_version || !cache_extensions)
+        return;
+
+    /* Nothing new got resolved since the cache was loaded. */
+    if (cache_matched && count_cacheable() <= cache_loaded)
+        return;
+
+    /* Other processes may be reading the cache, or writing it at the
+     * same time, so only ever replace it with a complete file.
+     */
+    if (asprintf(&tmp_path, "%s.XXXXXX", cache_path) < 0)
+        return;
+
+    fd = mkstemp(tmp_path);
+    if (fd < 0) {
+        free(tmp_path);
+        return;
+    }
+
+    file = fdopen(fd, "w");
+    if (!file) {
+        close(fd);
+        unlink(tmp_path);
+        free(tmp_path);
+        return;
+    }
+
+    collect_objects(&objects);
+    write_cache(file, &objects);
+    free(objects.objects);
+
+    if (fclose(file) != 0 || rename(tmp_path, cache_path) != 0)
+        unlink(tmp_path);
+    free(tmp_path);
+}
+
+#else /* !__ELF__ */
+
+/* Without ELF build-ids there's nothing to key the cache on. */
+
+void
+epoxy_resolve_cache_load(const char *path)
+{
+    (void)path;
+}
+
+void
+epoxy_resolve_cache_save(void)
+{
+}
+
+#endif /* !__ELF__ */
@@ -221,7 +221,9 @@
 struct api {
 #ifndef _WIN32
     /*
-     * Locking for making sure we don't double-dlopen().
+     * Locking for making sure we don't double-dlopen().  The handles
+     * below are only ever set once, with a release store, so they can
+     * be read without it.
      */
     pthread_mutex_t mutex;
 #endif
@@ -249,20 +251,6 @@ struct api {
 
     /* dlopen() return value for libGLESv2.so.2 */
     void *gles2_handle;
-
-    /*
-     * This value gets incremented when any thread is in
-     * glBegin()/glEnd() called through epoxy.
-     *
-     * We're not guaranteed to be called through our wrapper, so the
-     * conservative paths also try to handle the failure cases they'll
-     * see if begin_count didn't reflect reality.  It's also a bit of
-     * a bug that the conservative paths might return success because
-     * some other thread was in epoxy glBegin/glEnd while our thread
-     * is trying to resolve, but given that it's basically just for
-     * informative error messages, we shouldn't need to care.
-     */
-    long begin_count;
 };
 
 static struct api api = {
@@ -275,25 +263,229 @@ static struct api api = {
 
 static bool library_initialized;
 
+/*
+ * Whether this thread is in glBegin()/glEnd() called through epoxy,
+ * where the conservative paths can't query the context.
+ *
+ * We're not guaranteed to be called through our wrapper, so the
+ * conservative paths also try to handle the failure cases they'll
+ * see if this didn't reflect reality.
+ */
+static EPOXY_THREAD_LOCAL bool in_begin_end;
+
+/*
+ * Facts about a context that the resolvers keep asking about, queried
+ * from the driver once and then reused.  Once the context is destroyed,
+ * its entry is retired, and lookups skip it, since a new context may
+ * get the same handle.  A retired entry is freed as soon as no thread
+ * has it as the one it found last, since the functions of the thread
+ * that had it current may still be using what's in it.
+ */
+struct epoxy_context_state {
+    struct epoxy_context_state *next;
+
+    epoxy_context_platform_t platform;
+    void *display;
+    void *context;
+    long retired;
+
+    /* How many threads have it in found_context. */
+    long users;
+
+    /*
+     * A copy of the context's GL_VERSION, for telling it apart from a
+     * later context with the same handle when epoxy didn't see it
+     * getting destroyed, or NULL until it's needed.
+     */
+    char *gl_version_string;
+
+    /* Each of these is -1 until it has been queried. */
+    int is_desktop_gl;
+    int gl_version;
+    int glsl_version;
+    int core_profile;
+#if PLATFORM_HAS_EGL
+    EGLint egl_client_type;
+#endif
+
+    /*
+     * Bitset of the GL extensions from the registry that the context
+     * supports, indexed by gl_extension_lookup() IDs, or NULL until
+     * the extension list has been parsed.
+     */
+    uint32_t *gl_extensions;
+
+    /*
+     * The whole GL_EXTENSIONS list of a context before GL 3.0, for the
+     * names that aren't in the registry, or NULL until it's needed.
+     */
+    struct epoxy_extension_set *gl_extension_set;
+
+    /*
+     * Arrays of enum epoxy_provider_state, indexed by the provider
+     * enums of each of the generated dispatch files.
+     */
+    uint8_t *provider_cache[EPOXY_TARGET_COUNT];
+
+    /* What the query cache knows about the context, or NULL. */
+    void *query_cache;
+
+#if USING_SHADOW_STATE
+    /*
+     * Tells the context apart from every other one for the shadow
+     * state, unlike its handle and the address of its state, which
+     * later contexts may get.
+     */
+    uint64_t id;
+#endif
+
+#if USING_DISPATCH_TABLE && !defined(_WIN32)
+    /*
+     * The GL dispatch table that calls go through while this context
+     * is current, shared with the other contexts that resolve the
+     * same way once dispatch_table_settled is set.
+     */
+    void *dispatch_table;
+    long dispatch_table_settled;
+
+    /* Set once the facts that decide its functions have been asked for. */
+    long identified;
+#endif
+};
+
+/*
+ * The list is only walked and changed with context_states_mutex held,
+ * and never while calling GL, which may come back to it.  Nothing ever
+ * gets taken off the list on Windows, which has no lock, so adding to
+ * it is done with atomics.
+ */
+static struct epoxy_context_state *context_states;
+#ifndef _WIN32
+static pthread_mutex_t context_states_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+#if USING_SHADOW_STATE
+static uint64_t last_context_id;
+#endif
+
+static void
+lock_context_states(void)
+{
+#ifndef _WIN32
+    pthread_mutex_lock(&context_states_mutex);
+#endif
+}
+
+static void
+unlock_context_states(void)
+{
+#ifndef _WIN32
+    pthread_mutex_unlock(&context_states_mutex);
+#endif
+}
+
+#if PLATFORM_HAS_GLX || PLATFORM_HAS_EGL
+/*
+ * What epoxy's glXMakeCurrent() and eglMakeCurrent() wrappers last
+ * made current on this thread, so that finding the current context
+ * doesn't have to ask the driver.  Each window system's half is only
+ * used while it's known; otherwise the driver gets asked as before.
+ */
+struct epoxy_current_context {
+    bool glx_known;
+    void *glx_display;
+    void *glx_context;
+
+    bool egl_known;
+    void *egl_display;
+    void *egl_context;
+
+    /* The state of the context above, once it has been looked up. */
+    struct epoxy_context_state *state;
+};
+
+static EPOXY_THREAD_LOCAL struct epoxy_current_context current_context;
+#endif
+
+/*
+ * The context that was last found current on this thread, and its
+ * state, which gets used again without walking the list for as long as
+ * the same context is current, and doesn't get freed until the thread
+ * lets go of it.  For the contexts that epoxy didn't make current, the
+ * driver still has to be asked which one that is.
+ */
+struct epoxy_found_context {
+    epoxy_context_platform_t platform;
+    void *display;
+    void *context;
+    struct epoxy_context_state *state;
+};
+
+static EPOXY_THREAD_LOCAL struct epoxy_found_context found_context;
+
+#if USING_DISPATCH_TABLE && !defined(_WIN32)
+EPOXY_THREAD_LOCAL_FAST void *gl_current_dispatch_table;
+
+/*
+ * The context that the global function pointers get resolved for,
+ * which is the first one we saw, or one that took its place after it
+ * was destroyed, until a context that needs different pointers shows
+ * up alongside it and we switch to per-context dispatch tables.
+ */
+static struct epoxy_context_state *first_context_state;
+static long using_dispatch_tables;
+
+static void epoxy_check_dispatch_tables(struct epoxy_context_state *state);
+#endif
+
+static struct epoxy_context_state *epoxy_current_context_state(void);
 static bool epoxy_current_context_is_glx(void);
+static bool epoxy_context_state_is_desktop_gl(struct epoxy_context_state *state);
+static int epoxy_context_state_gl_version(struct epoxy_context_state *state,
+                                          int error_version);
+#if USING_DISPATCH_TABLE && !defined(_WIN32)
+static bool epoxy_context_state_core_profile(struct epoxy_context_state *state);
+#endif
 
 #if PLATFORM_HAS_EGL
 static EGLenum
-epoxy_egl_get_current_gl_context_api(void);
+epoxy_egl_context_state_api(struct epoxy_context_state *state);
 #endif
 
 CONSTRUCT (library_init)
+DESTRUCT (library_fini)
+
+static void eager_init(void);
+static void profile_fini(void);
 
 static void
 library_init(void)
 {
     library_initialized = true;
+
+    epoxy_resolve_report_init();
+    eager_init();
+    epoxy_stats_init();
+    epoxy_trace_init();
+    epoxy_shadow_state_init();
+}
+
+static void
+library_fini(void)
+{
+    epoxy_resolve_cache_save();
+    epoxy_stats_fini();
+    epoxy_trace_fini();
+    epoxy_resolve_report_fini();
+    profile_fini();
 }
 
 static bool
 get_dlopen_handle(void **handle, const char *lib_name, bool exit_on_fail, bool load)
 {
-    if (*handle)
+    uint64_t report_start;
+    void *result;
+
+    if (epoxy_atomic_load_ptr(handle))
         return true;
 
     if (!library_initialized) {
@@ -302,16 +494,25 @@ get_dlopen_handle(void **handle, const char *lib_name, bool exit_on_fail, bool l
     }
 
 #ifdef _WIN32
-    *handle = LoadLibraryA(lib_name);
+    report_start = epoxy_resolve_report_dlopen_start();
+    result = LoadLibraryA(lib_name);
+    epoxy_resolve_report_dlopen(lib_name, report_start, result != NULL);
+    if (result)
+        epoxy_atomic_store_ptr(handle, result);
 #else
     pthread_mutex_lock(&api.mutex);
-    if (!*handle) {
+    result = *handle;
+    if (!result) {
         int flags = RTLD_LAZY | RTLD_LOCAL;
         if (!load)
             flags |= RTLD_NOLOAD;
 
-        *handle = dlopen(lib_name, flags);
-        if (!*handle) {
+        report_start = epoxy_resolve_report_dlopen_start();
+        result = dlopen(lib_name, flags);
+        epoxy_resolve_report_dlopen(lib_name, report_start, result != NULL);
+        if (result) {
+            epoxy_atomic_store_ptr(handle, result);
+        } else {
             if (exit_on_fail) {
                 fprintf(stderr, "Couldn't open %s: %s\n", lib_name, dlerror());
                 abort();
@@ -323,7 +524,7 @@ get_dlopen_handle(void **handle, const char *lib_name, bool exit_on_fail, bool l
     pthread_mutex_unlock(&api.mutex);
 #endif
 
-    return *handle != NULL;
+    return result != NULL;
 }
 
 static void *
@@ -333,10 +534,18 @@ do_dlsym(void **handle, const char *name, bool exit_on_fail)
     const char *error = "";
 
 #ifdef _WIN32
+    epoxy_resolve_report_loader("GetProcAddress");
     result = GetProcAddress(*handle, name);
 #else
+    epoxy_resolve_report_loader("dlsym");
+    result = epoxy_elf_dlsym(*handle, name);
+    if (result)
+        return result;
+
     result = dlsym(*handle, name);
-    if (!result)
+    if (result)
+        epoxy_elf_index_handle(*handle, name, result);
+    else
         error = dlerror();
 #endif
     if (!result && exit_on_fail) {
@@ -347,16 +556,792 @@ do_dlsym(void **handle, const char *name, bool exit_on_fail)
     return result;
 }
 
+void
+epoxy_set_current_context(epoxy_context_platform_t platform, bool known,
+                          void *display, void *context)
+{
+#if PLATFORM_HAS_GLX || PLATFORM_HAS_EGL
+    switch (platform) {
+    case EPOXY_CONTEXT_PLATFORM_GLX:
+        current_context.glx_known = known;
+        current_context.glx_display = context ? display : NULL;
+        current_context.glx_context = context;
+        break;
+    case EPOXY_CONTEXT_PLATFORM_EGL:
+        current_context.egl_known = known;
+        current_context.egl_display = context ? display : NULL;
+        current_context.egl_context = context;
+        break;
+    default:
+        break;
+    }
+
+    current_context.state = NULL;
+#if USING_DISPATCH_TABLE && !defined(_WIN32)
+    gl_current_dispatch_table = NULL;
+#endif
+    epoxy_shadow_state_reset();
+
+#if USING_DISPATCH_TABLE && !defined(_WIN32)
+    /* Once the global pointers are resolved for a context, one that
+     * we haven't seen gets compared with it right away, since the calls
+     * to the functions that are resolved already don't come by us.
+     */
+    if (known && context && epoxy_atomic_load_ptr(&first_context_state) &&
+        !epoxy_atomic_load_long(&using_dispatch_tables))
+        epoxy_current_context_state();
+#endif
+#else
+    (void)platform;
+    (void)known;
+    (void)display;
+    (void)context;
+#endif
+}
+
 /**
- * @brief Checks whether we're using OpenGL or OpenGL ES
+ * Finds the context that is current on this thread, without loading
+ * any window system library that the app hasn't loaded already.
  *
- * @return `true` if we're using OpenGL
+ * This calls the window system entrypoints we dlsym() ourselves
+ * rather than the epoxy ones, since it's used while evaluating
+ * provider conditions, and so may not recurse into the resolvers.
+ * The driver is only asked about the window systems whose MakeCurrent
+ * calls we haven't seen, and *tracked says whether it was asked at all.
+ */
+static epoxy_context_platform_t
+epoxy_identify_current_context(void **display, void **context, bool *tracked)
+{
+#if PLATFORM_HAS_GLX
+    static PFNGLXGETCURRENTCONTEXTPROC glx_get_current_context;
+    static PFNGLXGETCURRENTDISPLAYPROC glx_get_current_display;
+#endif
+#if PLATFORM_HAS_EGL
+    static PFNEGLGETCURRENTCONTEXTPROC egl_get_current_context;
+    static PFNEGLGETCURRENTDISPLAYPROC egl_get_current_display;
+#endif
+
+    *tracked = true;
+
+#if PLATFORM_HAS_GLX
+    if (current_context.glx_known) {
+        if (current_context.glx_context) {
+            *display = current_context.glx_display;
+            *context = current_context.glx_context;
+            return EPOXY_CONTEXT_PLATFORM_GLX;
+        }
+#if PLATFORM_HAS_EGL
+    } else if (current_context.egl_known && current_context.egl_context) {
+        /* The app tells us about contexts it makes current behind
+         * our back, and a thread only has one, so a current EGL
+         * context means there's no need to ask GLX.
+         */
+#endif
+    } else {
+        *tracked = false;
+
+        if (!glx_get_current_display) {
+            glx_get_current_context =
+                epoxy_conservative_glx_dlsym("glXGetCurrentContext", false);
+            if (glx_get_current_context)
+                glx_get_current_display =
+                    epoxy_conservative_glx_dlsym("glXGetCurrentDisplay", false);
+        }
+
+        if (glx_get_current_context && glx_get_current_display) {
+            GLXContext ctx = glx_get_current_context();
+
+            if (ctx) {
+                *display = glx_get_current_display();
+                *context = ctx;
+                return EPOXY_CONTEXT_PLATFORM_GLX;
+            }
+        }
+    }
+#endif
+
+#if PLATFORM_HAS_EGL
+    if (current_context.egl_known) {
+        if (current_context.egl_context) {
+            *display = current_context.egl_display;
+            *context = current_context.egl_context;
+            return EPOXY_CONTEXT_PLATFORM_EGL;
+        }
+    } else {
+        *tracked = false;
+
+        if (!egl_get_current_display) {
+            egl_get_current_context =
+                epoxy_conservative_egl_dlsym("eglGetCurrentContext", false);
+            if (egl_get_current_context)
+                egl_get_current_display =
+                    epoxy_conservative_egl_dlsym("eglGetCurrentDisplay", false);
+        }
+
+        if (egl_get_current_context && egl_get_current_display) {
+            EGLContext ctx = egl_get_current_context();
+
+            if (ctx != EGL_NO_CONTEXT) {
+                *display = egl_get_current_display();
+                *context = ctx;
+                return EPOXY_CONTEXT_PLATFORM_EGL;
+            }
+        }
+    }
+#endif
+
+#if PLATFORM_HAS_WGL
+    {
+        HGLRC ctx = wglGetCurrentContext();
+
+        *tracked = false;
+
+        if (ctx) {
+            *display = wglGetCurrentDC();
+            *context = ctx;
+            return EPOXY_CONTEXT_PLATFORM_WGL;
+        }
+    }
+#endif
+
+    return EPOXY_CONTEXT_PLATFORM_NONE;
+}
+
+/**
+ * Returns the cached state for a context, creating it on first use,
+ * with the calling thread counted as one of its users.
+ */
+static struct epoxy_context_state *
+epoxy_find_context_state(epoxy_context_platform_t platform,
+                         void *display, void *context, bool *created)
+{
+    struct epoxy_context_state *head, *state, *other;
+
+    *created = false;
+
+    lock_context_states();
+    head = epoxy_atomic_load_ptr(&context_states);
+    for (state = head; state; state = state->next) {
+        if (state->platform == platform &&
+            state->display == display &&
+            state->context == context &&
+            !epoxy_atomic_load_long(&state->retired)) {
+            state->users++;
+            unlock_context_states();
+            return state;
+        }
+    }
+
+    state = calloc(1, sizeof(*state));
+    if (!state) {
+        unlock_context_states();
+        return NULL;
+    }
+
+    state->platform = platform;
+    state->display = display;
+    state->context = context;
+    state->users = 1;
+#if USING_SHADOW_STATE
+    state->id = ++last_context_id;
+#endif
+    state->is_desktop_gl = -1;
+    state->gl_version = -1;
+    state->glsl_version = -1;
+    state->core_profile = -1;
+#if PLATFORM_HAS_EGL
+    state->egl_client_type = -1;
+#endif
+
+    while (true) {
+        state->next = head;
+        if (epoxy_atomic_cas_ptr(&context_states, head, state)) {
+            unlock_context_states();
+            *created = true;
+            return state;
+        }
+
+        /* Someone else added entries; make sure they didn't just add
+         * this same context.
+         */
+        head = epoxy_atomic_load_ptr(&context_states);
+        for (other = head; other != state->next; other = other->next) {
+            if (other->platform == platform &&
+                other->display == display &&
+                other->context == context &&
+                !epoxy_atomic_load_long(&other->retired)) {
+                free(state);
+                other->users++;
+                unlock_context_states();
+                return other;
+            }
+        }
+    }
+}
+
+/**
+ * Frees a state once its context is gone and no thread has it in
+ * found_context, unless the global function pointers are still
+ * resolved for it.  The list has to be locked.
+ */
+static void
+epoxy_free_context_state(struct epoxy_context_state *state)
+{
+#ifndef _WIN32
+    struct epoxy_context_state **link;
+    int i;
+
+    if (!epoxy_atomic_load_long(&state->retired) || state->users)
+        return;
+#if USING_DISPATCH_TABLE
+    if (state == epoxy_atomic_load_ptr(&first_context_state))
+        return;
+#endif
+
+    for (link = &context_states; *link != state; link = &(*link)->next) {
+        if (!*link)
+            return;
+    }
+    epoxy_atomic_store_ptr(link, state->next);
+
+#if USING_DISPATCH_TABLE
+    {
+        struct epoxy_context_state *other;
+
+        /* The contexts that resolve alike share one table. */
+        for (other = context_states; other; other = other->next) {
+            if (other->dispatch_table == state->dispatch_table)
+                break;
+        }
+        if (!other)
+            free(state->dispatch_table);
+    }
+#endif
+
+    for (i = 0; i < EPOXY_TARGET_COUNT; i++)
+        free(state->provider_cache[i]);
+    free(state->gl_extensions);
+    epoxy_extension_set_destroy(state->gl_extension_set);
+#if USING_SHADOW_STATE
+    epoxy_query_cache_free(state->query_cache);
+#endif
+    free(state->gl_version_string);
+    free(state);
+#else
+    (void)state;
+#endif
+}
+
+/**
+ * Lets go of the state that this thread found last, freeing it if its
+ * context is gone and no other thread has it.
+ */
+static void
+epoxy_release_found_context(void)
+{
+    struct epoxy_context_state *state = found_context.state;
+
+    found_context.state = NULL;
+#if PLATFORM_HAS_GLX || PLATFORM_HAS_EGL
+    current_context.state = NULL;
+#endif
+#if USING_DISPATCH_TABLE && !defined(_WIN32)
+    gl_current_dispatch_table = NULL;
+#endif
+    if (!state)
+        return;
+
+    lock_context_states();
+    state->users--;
+    epoxy_free_context_state(state);
+    unlock_context_states();
+}
+
+void
+epoxy_forget_context_states(epoxy_context_platform_t platform,
+                            void *display, void *context)
+{
+    struct epoxy_context_state *state, *next;
+
+    lock_context_states();
+    for (state = context_states; state; state = next) {
+        next = state->next;
+        if (state->platform == platform &&
+            state->display == display &&
+            (!context || state->context == context)) {
+            epoxy_atomic_cas_long(&state->retired, 0, 1);
+            epoxy_free_context_state(state);
+        }
+    }
+    unlock_context_states();
+
+    /* The thread that destroyed its current context may still have it
+     * current, but it shouldn't be found again for a new one.
+     */
+    if (found_context.state && epoxy_atomic_load_long(&found_context.state->retired))
+        epoxy_release_found_context();
+}
+
+/**
+ * Returns whether the current context has the GL_VERSION that the
+ * state's context had, remembering that on first use.
+ *
+ * This asks the driver itself, since the query cache and the
+ * conservative paths answer from the state.
+ */
+static bool
+epoxy_context_state_check_version(struct epoxy_context_state *state)
+{
+    PFNGLGETSTRINGPROC get_string;
+    const char *version;
+    char *copy;
+
+    if (in_begin_end)
+        return true;
+
+    get_string = epoxy_get_bootstrap_proc_address("glGetString");
+    if (!get_string)
+        return true;
+
+    version = (const char *)get_string(GL_VERSION);
+    if (!version)
+        return true;
+
+    copy = epoxy_atomic_load_ptr(&state->gl_version_string);
+    if (copy)
+        return strcmp(copy, version) == 0;
+
+    copy = strdup(version);
+    if (copy && !epoxy_atomic_cas_ptr(&state->gl_version_string, NULL, copy))
+        free(copy);
+    return true;
+}
+
+/**
+ * Finds the state of the context that is now current on this thread,
+ * in place of the one found before.
+ *
+ * Epoxy doesn't see a context that it didn't make current getting
+ * destroyed either, and a new one may have got its handle since, so
+ * the new one's GL_VERSION gets checked against the one that the state
+ * was made for.  That catches it getting switched to after another
+ * context, or after none, but not while its handle stays current.
+ */
+static struct epoxy_context_state *
+epoxy_update_found_context(epoxy_context_platform_t platform,
+                           void *display, void *context, bool tracked)
+{
+    struct epoxy_context_state *state;
+    bool created;
+
+    epoxy_release_found_context();
+
+    state = epoxy_find_context_state(platform, display, context, &created);
+    if (!state)
+        return NULL;
+
+    found_context.platform = platform;
+    found_context.display = display;
+    found_context.context = context;
+    found_context.state = state;
+#if PLATFORM_HAS_GLX || PLATFORM_HAS_EGL
+    if (tracked)
+        current_context.state = state;
+#endif
+
+    if (!tracked && !epoxy_context_state_check_version(state)) {
+        epoxy_forget_context_states(platform, display, context);
+        return epoxy_update_found_context(platform, display, context, tracked);
+    }
+
+#if USING_DISPATCH_TABLE && !defined(_WIN32)
+    if (created)
+        epoxy_check_dispatch_tables(state);
+#endif
+
+    return state;
+}
+
+/**
+ * Returns the cached state for the current context, or NULL if no
+ * context we know how to identify is current (in which case nothing
+ * should be cached).
+ */
+static struct epoxy_context_state *
+epoxy_current_context_state(void)
+{
+    struct epoxy_context_state *state;
+    epoxy_context_platform_t platform;
+    void *display = NULL, *context = NULL;
+    bool tracked;
+
+#if PLATFORM_HAS_GLX || PLATFORM_HAS_EGL
+    if (current_context.state)
+        return current_context.state;
+#endif
+
+    platform = epoxy_identify_current_context(&display, &context, &tracked);
+    if (platform == EPOXY_CONTEXT_PLATFORM_NONE) {
+        /* The last one may be destroyed now, and its handle given to
+         * a context that gets made current next.
+         */
+        epoxy_release_found_context();
+        return NULL;
+    }
+
+    state = found_context.state;
+    if (!state ||
+        found_context.platform != platform ||
+        found_context.display != display ||
+        found_context.context != context ||
+        epoxy_atomic_load_long(&state->retired))
+        return epoxy_update_found_context(platform, display, context, tracked);
+
+#if PLATFORM_HAS_GLX || PLATFORM_HAS_EGL
+    if (tracked)
+        current_context.state = state;
+#endif
+
+    return state;
+}
+
+#if USING_SHADOW_STATE
+/**
+ * Returns where the query cache of the current context goes, or NULL if
+ * no context we know how to identify is current.
+ */
+void **
+epoxy_current_query_cache(void)
+{
+    struct epoxy_context_state *state = epoxy_current_context_state();
+
+    return state ? &state->query_cache : NULL;
+}
+
+/**
+ * Returns what tells the current context apart from every other one
+ * that was ever current, or 0 if no context we know how to identify is
+ * current.
+ */
+uint64_t
+epoxy_current_context_id(void)
+{
+    struct epoxy_context_state *state = epoxy_current_context_state();
+
+    return state ? state->id : 0;
+}
+#endif
+
+/**
+ * Returns whether an IFUNC resolver of an exported GL entrypoint can
+ * resolve its function for the current context.
+ *
+ * The dynamic linker runs the resolvers either while relocating, when
+ * not even our own constructor has run and nothing may be called, or
+ * at the first call through the caller's PLT slot, when there should
+ * be a context current.
  */
 bool
-epoxy_is_desktop_gl(void)
+epoxy_ifunc_can_resolve(void)
+{
+    return library_initialized && epoxy_current_context_state() != NULL;
+}
+
+static long ifunc_bound;
+
+/**
+ * Records that an IFUNC resolver bound a caller's PLT slot to a
+ * function of the driver, which the calls through it keep going to
+ * for good, whatever epoxy's pointers get switched to later.
+ */
+void
+epoxy_ifunc_note_bound(void)
+{
+    epoxy_atomic_cas_long(&ifunc_bound, 0, 1);
+}
+
+/**
+ * Returns whether any IFUNC entrypoint got bound to the driver, which
+ * the modes that work by switching epoxy's pointers can't get in front
+ * of.
+ */
+bool
+epoxy_ifunc_bound(void)
+{
+    return epoxy_atomic_load_long(&ifunc_bound);
+}
+
+#if USING_DISPATCH_TABLE && !defined(_WIN32)
+/**
+ * Asks for what decides the functions a context gets, while it's
+ * current, so that it can be compared with others that aren't.
+ */
+static void
+epoxy_identify_context_state(struct epoxy_context_state *state)
+{
+#if PLATFORM_HAS_EGL
+    epoxy_egl_context_state_api(state);
+#endif
+    epoxy_context_state_is_desktop_gl(state);
+    epoxy_context_state_gl_version(state, 0);
+    epoxy_context_state_core_profile(state);
+    epoxy_atomic_cas_long(&state->identified, 0, 1);
+}
+
+/**
+ * Returns whether two contexts get the same function pointers: the
+ * window system's GetProcAddress doesn't depend on the context, but
+ * the library and vendor we get them from depend on the display and
+ * the client API, and the resolvers pick between the names of a
+ * function by the GL, version and profile of the context.
+ */
+static bool
+epoxy_context_states_compatible(struct epoxy_context_state *a,
+                                struct epoxy_context_state *b)
+{
+    if (a->platform != b->platform || a->display != b->display)
+        return false;
+
+#if PLATFORM_HAS_EGL
+    if (epoxy_egl_context_state_api(a) != epoxy_egl_context_state_api(b))
+        return false;
+#endif
+
+    return a->is_desktop_gl == b->is_desktop_gl &&
+           a->gl_version == b->gl_version &&
+           a->core_profile == b->core_profile;
+}
+
+static void
+epoxy_warn_ifunc_bound(void)
+{
+    if (epoxy_ifunc_bound())
+        fputs("GL entrypoints exported as IFUNCs were bound to the first "
+              "context's functions, which other contexts will get too\n",
+              stderr);
+}
+
+/**
+ * Returns a context other than the given ones that hasn't been
+ * destroyed, and that has been compared with the one that the global
+ * pointers are for already.  The list has to be locked.
+ */
+static struct epoxy_context_state *
+epoxy_find_live_context_state(struct epoxy_context_state *state,
+                              struct epoxy_context_state *first)
+{
+    struct epoxy_context_state *other;
+
+    for (other = context_states; other; other = other->next) {
+        if (other != state && other != first &&
+            !epoxy_atomic_load_long(&other->retired) &&
+            epoxy_atomic_load_long(&other->identified))
+            return other;
+    }
+
+    return NULL;
+}
+
+/**
+ * Switches the GL calls over to per-context dispatch tables if a
+ * newly seen context can't share the global function pointers with
+ * the contexts they're for.
+ *
+ * Only the contexts that are still around count: once the one they
+ * were resolved for is destroyed, any other that's still around can
+ * take its place, since it shares them, and if there's none left (say,
+ * the app only made that one to check what it could get), the new
+ * context takes its place, with the pointers resolved again if it
+ * needs other ones.  The one that got replaced can be freed then.
+ */
+static void
+epoxy_check_dispatch_tables(struct epoxy_context_state *state)
+{
+    struct epoxy_context_state *first, *other;
+    bool reset = false, switch_tables = false;
+
+    /* Ask now, while the context is surely still around to compare
+     * against later ones.  Once the calls go through dispatch tables,
+     * that waits until the context gets one.
+     */
+    if (epoxy_atomic_load_long(&using_dispatch_tables))
+        return;
+    epoxy_identify_context_state(state);
+
+    lock_context_states();
+    first = epoxy_atomic_load_ptr(&first_context_state);
+    if (!first) {
+        epoxy_atomic_store_ptr(&first_context_state, state);
+    } else if (epoxy_atomic_load_long(&first->retired)) {
+        other = epoxy_find_live_context_state(state, first);
+        if (other) {
+            epoxy_atomic_store_ptr(&first_context_state, other);
+            switch_tables = !epoxy_context_states_compatible(other, state);
+        } else {
+            epoxy_atomic_store_ptr(&first_context_state, state);
+            reset = !epoxy_context_states_compatible(first, state);
+        }
+        epoxy_free_context_state(first);
+    } else {
+        switch_tables = !epoxy_context_states_compatible(first, state);
+    }
+    if (switch_tables)
+        switch_tables = epoxy_atomic_cas_long(&using_dispatch_tables, 0, 1);
+    unlock_context_states();
+
+    if (reset || switch_tables)
+        epoxy_warn_ifunc_bound();
+    if (reset)
+        gl_reset_function_pointers();
+    if (switch_tables)
+        gl_switch_to_dispatch_table();
+}
+
+/**
+ * Returns the GL dispatch table of the current context, creating it
+ * on first use.
+ *
+ * The answer is remembered for the thread only if we know when its
+ * current context changes.  Otherwise the driver has to be asked for
+ * the current context on every call, but as long as that's the same
+ * one, its state, and so its table, is the one found last time.
+ */
+void *
+epoxy_context_dispatch_table(size_t size)
+{
+    static void *no_context_table;
+    struct epoxy_context_state *state = epoxy_current_context_state();
+    struct epoxy_context_state *other;
+    void *table = NULL, *new_table = NULL;
+
+    if (!state) {
+        /* Calling GL without a current context only gets as far as
+         * the resolvers' error handling.
+         */
+        table = epoxy_atomic_load_ptr(&no_context_table);
+        if (table)
+            return table;
+
+        new_table = calloc(1, size);
+        if (!new_table) {
+            fputs("Couldn't allocate a GL dispatch table\n", stderr);
+            abort();
+        }
+
+        if (!epoxy_atomic_cas_ptr(&no_context_table, NULL, new_table))
+            free(new_table);
+        return epoxy_atomic_load_ptr(&no_context_table);
+    }
+
+    table = epoxy_atomic_load_ptr(&state->dispatch_table);
+    if (!table) {
+        /* Identifying the context calls GL, which goes through a table
+         * of its own until it's known which one it can share.  Only
+         * settled tables get shared, so that this one can be freed.
+         */
+        new_table = calloc(1, size);
+        if (!new_table) {
+            fputs("Couldn't allocate a GL dispatch table\n", stderr);
+            abort();
+        }
+
+        if (epoxy_atomic_cas_ptr(&state->dispatch_table, NULL, new_table)) {
+            epoxy_identify_context_state(state);
+
+            lock_context_states();
+            for (other = context_states; other && !table; other = other->next) {
+                if (other != state &&
+                    epoxy_atomic_load_long(&other->dispatch_table_settled) &&
+                    epoxy_context_states_compatible(state, other))
+                    table = epoxy_atomic_load_ptr(&other->dispatch_table);
+            }
+
+            if (table) {
+                epoxy_atomic_store_ptr(&state->dispatch_table, table);
+                free(new_table);
+            }
+            epoxy_atomic_cas_long(&state->dispatch_table_settled, 0, 1);
+            unlock_context_states();
+        } else {
+            free(new_table);
+        }
+
+        table = epoxy_atomic_load_ptr(&state->dispatch_table);
+    }
+
+#if PLATFORM_HAS_GLX || PLATFORM_HAS_EGL
+    if (current_context.state == state)
+        gl_current_dispatch_table = table;
+#endif
+
+    return table;
+}
+#endif /* USING_DISPATCH_TABLE && !_WIN32 */
+
+/**
+ * Returns the display and context that are current on this thread,
+ * if they're from the given window system.
+ */
+bool
+epoxy_current_context(epoxy_context_platform_t platform,
+                      void **display, void **context)
+{
+    struct epoxy_context_state *state = epoxy_current_context_state();
+
+    if (!state || state->platform != platform)
+        return false;
+
+    *display = state->display;
+    *context = state->context;
+    return true;
+}
+
+/**
+ * Returns the per-context array of enum epoxy_provider_state that the
+ * generated resolvers use to remember which providers are present,
+ * or NULL if the answers can't be cached right now.
+ */
+uint8_t *
+epoxy_context_provider_cache(enum epoxy_dispatch_target target, size_t count)
+{
+    struct epoxy_context_state *state;
+    uint8_t *cache;
+
+    /* The conservative checks give made-up answers inside of
+     * glBegin()/glEnd(), which we must not remember.
+     */
+    if (in_begin_end)
+        return NULL;
+
+    state = epoxy_current_context_state();
+    if (!state)
+        return NULL;
+
+    cache = epoxy_atomic_load_ptr(&state->provider_cache[target]);
+    if (cache)
+        return cache;
+
+    cache = calloc(count, sizeof(*cache));
+    if (!cache)
+        return NULL;
+
+    if (!epoxy_atomic_cas_ptr(&state->provider_cache[target], NULL, cache)) {
+        free(cache);
+        cache = epoxy_atomic_load_ptr(&state->provider_cache[target]);
+    }
+
+    return cache;
+}
+
+static bool
+epoxy_context_state_is_desktop_gl(struct epoxy_context_state *state)
 {
     const char *es_prefix = "OpenGL ES";
     const char *version;
+    bool is_desktop_gl;
+
+    if (state && state->is_desktop_gl != -1)
+        return state->is_desktop_gl;
 
 #if PLATFORM_HAS_EGL
     /* PowerVR's OpenGL ES implementation (and perhaps other) don't
@@ -366,17 +1351,19 @@ epoxy_is_desktop_gl(void)
      * OpenGL ES, we must also check the context type through EGL (we
      * can do that as PowerVR is only usable through EGL).
      */
-    if (!epoxy_current_context_is_glx()) {
-        switch (epoxy_egl_get_current_gl_context_api()) {
-        case EGL_OPENGL_API:     return true;
-        case EGL_OPENGL_ES_API:  return false;
-        case EGL_NONE:
-        default:  break;
-        }
+    switch (epoxy_egl_context_state_api(state)) {
+    case EGL_OPENGL_API:
+        state->is_desktop_gl = true;
+        return true;
+    case EGL_OPENGL_ES_API:
+        state->is_desktop_gl = false;
+        return false;
+    case EGL_NONE:
+    default:  break;
     }
 #endif
 
-    if (api.begin_count)
+    if (in_begin_end)
         return true;
 
     version = (const char *)glGetString(GL_VERSION);
@@ -389,7 +1376,22 @@ epoxy_is_desktop_gl(void)
     if (!version)
         return true;
 
-    return strncmp(es_prefix, version, strlen(es_prefix));
+    is_desktop_gl = strncmp(es_prefix, version, strlen(es_prefix));
+    if (state)
+        state->is_desktop_gl = is_desktop_gl;
+
+    return is_desktop_gl;
+}
+
+/**
+ * @brief Checks whether we're using OpenGL or OpenGL ES
+ *
+ * @return `true` if we're using OpenGL
+ */
+bool
+epoxy_is_desktop_gl(void)
+{
+    return epoxy_context_state_is_desktop_gl(epoxy_current_context_state());
 }
 
 static int
@@ -417,6 +1419,46 @@ epoxy_internal_gl_version(GLenum version_string, int error_version, int factor)
     return factor * major + minor;
 }
 
+static int
+epoxy_context_state_gl_version(struct epoxy_context_state *state,
+                               int error_version)
+{
+    int version;
+
+    if (state && state->gl_version != -1)
+        return state->gl_version;
+
+    version = epoxy_internal_gl_version(GL_VERSION, -1, 10);
+    if (version == -1)
+        return error_version;
+
+    if (state)
+        state->gl_version = version;
+
+    return version;
+}
+
+#if USING_DISPATCH_TABLE && !defined(_WIN32)
+static bool
+epoxy_context_state_core_profile(struct epoxy_context_state *state)
+{
+    GLint mask = 0;
+
+    if (state && state->core_profile != -1)
+        return state->core_profile;
+
+    /* Only desktop GL 3.2 and later have profiles. */
+    if (epoxy_context_state_is_desktop_gl(state) &&
+        epoxy_context_state_gl_version(state, 0) >= 32)
+        glGetIntegerv(GL_CONTEXT_PROFILE_MASK, &mask);
+
+    if (state)
+        state->core_profile = (mask & GL_CONTEXT_CORE_PROFILE_BIT) != 0;
+
+    return (mask & GL_CONTEXT_CORE_PROFILE_BIT) != 0;
+}
+#endif
+
 /**
  * @brief Returns the version of OpenGL we are using
  *
@@ -435,16 +1477,38 @@ epoxy_internal_gl_version(GLenum version_string, int error_version, int factor)
 int
 epoxy_gl_version(void)
 {
-    return epoxy_internal_gl_version(GL_VERSION, 0, 10);
+    return epoxy_context_state_gl_version(epoxy_current_context_state(), 0);
 }
 
 int
 epoxy_conservative_gl_version(void)
 {
-    if (api.begin_count)
+    if (in_begin_end)
         return 100;
 
-    return epoxy_internal_gl_version(GL_VERSION, 100, 10);
+    return epoxy_context_state_gl_version(epoxy_current_context_state(), 100);
+}
+
+static int
+epoxy_context_state_glsl_version(struct epoxy_context_state *state)
+{
+    int version = 0;
+
+    if (state && state->glsl_version != -1)
+        return state->glsl_version;
+
+    if (epoxy_context_state_gl_version(state, 0) >= 20 ||
+        epoxy_has_gl_extension ("GL_ARB_shading_language_100")) {
+        version = epoxy_internal_gl_version(GL_SHADING_LANGUAGE_VERSION, -1, 100);
+        if (version == -1)
+            return 0;
+    }
+
+    /* Only remember a missing GLSL if we actually got a GL version. */
+    if (state && state->gl_version != -1)
+        state->glsl_version = version;
+
+    return version;
 }
 
 /**
@@ -465,11 +1529,40 @@ epoxy_conservative_gl_version(void)
 int
 epoxy_glsl_version(void)
 {
-    if (epoxy_gl_version() >= 20 ||
-        epoxy_has_gl_extension ("GL_ARB_shading_language_100"))
-        return epoxy_internal_gl_version(GL_SHADING_LANGUAGE_VERSION, 0, 100);
+    return epoxy_context_state_glsl_version(epoxy_current_context_state());
+}
+
+/**
+ * @brief Returns what epoxy knows about the current context
+ *
+ * Epoxy caches the window system binding, profile and versions of
+ * each context the first time they are needed while resolving
+ * functions, so this is a cheap way to get at all of them.
+ *
+ * @param info The structure to fill in
+ * @return `false` if no context that epoxy can identify is current,
+ * in which case @p info is left untouched
+ *
+ * @see epoxy_gl_version()
+ * @see epoxy_glsl_version()
+ * @see epoxy_is_desktop_gl()
+ */
+bool
+epoxy_get_context_info(struct epoxy_context_info *info)
+{
+    struct epoxy_context_state *state = epoxy_current_context_state();
+
+    if (!state)
+        return false;
+
+    info->platform = state->platform;
+    info->display = state->display;
+    info->context = state->context;
+    info->is_desktop_gl = epoxy_context_state_is_desktop_gl(state);
+    info->gl_version = epoxy_context_state_gl_version(state, 0);
+    info->glsl_version = epoxy_context_state_glsl_version(state);
 
-    return 0;
+    return true;
 }
 
 /**
@@ -496,31 +1589,142 @@ epoxy_extension_in_string(const char *extension_list, const char *ext)
     const char *ptr = extension_list;
     int len;
 
-    if (!ext)
-        return false;
+    if (!ext)
+        return false;
+
+    len = strlen(ext);
+
+    if (extension_list == NULL || *extension_list == '\0')
+        return false;
+
+    /* Make sure that don't just find an extension with our name as a prefix. */
+    while (true) {
+        ptr = strstr(ptr, ext);
+        if (!ptr)
+            return false;
+
+        if (ptr[len] == ' ' || ptr[len] == 0)
+            return true;
+        ptr += len;
+    }
+}
+
+/**
+ * Returns the bitset of registry GL extensions supported by the
+ * context, parsing the context's extension list the first time, or
+ * NULL if the list couldn't be retrieved.
+ */
+static const uint32_t *
+epoxy_context_state_gl_extensions(struct epoxy_context_state *state)
+{
+    uint32_t *extensions;
+    int id;
+
+    extensions = epoxy_atomic_load_ptr(&state->gl_extensions);
+    if (extensions)
+        return extensions;
+
+    if (in_begin_end)
+        return NULL;
+
+    extensions = calloc((gl_extension_count + 31) / 32, sizeof(*extensions));
+    if (!extensions)
+        return NULL;
+
+    if (epoxy_context_state_gl_version(state, 0) < 30) {
+        const char *exts = (const char *)glGetString(GL_EXTENSIONS);
+
+        if (!exts) {
+            free(extensions);
+            return NULL;
+        }
+
+        while (*exts) {
+            size_t len = strcspn(exts, " ");
 
-    len = strlen(ext);
+            id = gl_extension_lookup(exts, len);
+            if (id >= 0)
+                extensions[id / 32] |= 1u << (id % 32);
 
-    if (extension_list == NULL || *extension_list == '\0')
-        return false;
+            exts += len;
+            while (*exts == ' ')
+                exts++;
+        }
+    } else {
+        int num_extensions = 0;
+        int i;
 
-    /* Make sure that don't just find an extension with our name as a prefix. */
-    while (true) {
-        ptr = strstr(ptr, ext);
-        if (!ptr)
-            return false;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &num_extensions);
+        if (num_extensions == 0) {
+            free(extensions);
+            return NULL;
+        }
 
-        if (ptr[len] == ' ' || ptr[len] == 0)
-            return true;
-        ptr += len;
+        for (i = 0; i < num_extensions; i++) {
+            const char *gl_ext = (const char *)glGetStringi(GL_EXTENSIONS, i);
+
+            if (!gl_ext) {
+                free(extensions);
+                return NULL;
+            }
+
+            id = gl_extension_lookup(gl_ext, strlen(gl_ext));
+            if (id >= 0)
+                extensions[id / 32] |= 1u << (id % 32);
+        }
+    }
+
+    if (!epoxy_atomic_cas_ptr(&state->gl_extensions, NULL, extensions)) {
+        free(extensions);
+        extensions = epoxy_atomic_load_ptr(&state->gl_extensions);
+    }
+
+    return extensions;
+}
+
+static const struct epoxy_extension_set *
+epoxy_context_state_gl_extension_set(struct epoxy_context_state *state)
+{
+    struct epoxy_extension_set *set;
+
+    set = epoxy_atomic_load_ptr(&state->gl_extension_set);
+    if (set || in_begin_end)
+        return set;
+
+    set = epoxy_extension_set_create((const char *)glGetString(GL_EXTENSIONS));
+    if (set && !epoxy_atomic_cas_ptr(&state->gl_extension_set, NULL, set)) {
+        epoxy_extension_set_destroy(set);
+        set = epoxy_atomic_load_ptr(&state->gl_extension_set);
     }
+
+    return set;
 }
 
 static bool
-epoxy_internal_has_gl_extension(const char *ext, bool invalid_op_mode)
+epoxy_internal_has_gl_extension(struct epoxy_context_state *state,
+                                int id, const char *ext,
+                                bool invalid_op_mode)
 {
-    if (epoxy_gl_version() < 30) {
-        const char *exts = (const char *)glGetString(GL_EXTENSIONS);
+    /* Extensions that are in the registry can be looked up in the
+     * context's bitset, anything else needs the list from the driver.
+     */
+    if (state && id >= 0) {
+        const uint32_t *extensions = epoxy_context_state_gl_extensions(state);
+
+        if (extensions)
+            return extensions[id / 32] & (1u << (id % 32));
+    }
+
+    if (epoxy_context_state_gl_version(state, 0) < 30) {
+        const struct epoxy_extension_set *set = NULL;
+        const char *exts;
+
+        if (state)
+            set = epoxy_context_state_gl_extension_set(state);
+        if (set)
+            return epoxy_extension_set_has(set, ext);
+
+        exts = (const char *)glGetString(GL_EXTENSIONS);
         if (!exts)
             return invalid_op_mode;
         return epoxy_extension_in_string(exts, ext);
@@ -550,13 +1754,13 @@ epoxy_load_glx(bool exit_if_fails, bool load)
 #if PLATFORM_HAS_GLX
 # ifdef GLVND_GLX_LIB
     /* prefer the glvnd library if it exists */
-    if (!api.glx_handle)
+    if (!epoxy_atomic_load_ptr(&api.glx_handle))
 	get_dlopen_handle(&api.glx_handle, GLVND_GLX_LIB, false, load);
 # endif
-    if (!api.glx_handle)
+    if (!epoxy_atomic_load_ptr(&api.glx_handle))
         get_dlopen_handle(&api.glx_handle, GLX_LIB, exit_if_fails, load);
 #endif
-    return api.glx_handle != NULL;
+    return epoxy_atomic_load_ptr(&api.glx_handle) != NULL;
 }
 
 void *
@@ -576,31 +1780,9 @@ epoxy_conservative_glx_dlsym(const char *name, bool exit_if_fails)
 static bool
 epoxy_current_context_is_glx(void)
 {
-#if !PLATFORM_HAS_GLX
-    return false;
-#else
-    void *sym;
-
-    sym = epoxy_conservative_glx_dlsym("glXGetCurrentContext", false);
-    if (sym) {
-        if (glXGetCurrentContext())
-            return true;
-    } else {
-        (void)dlerror();
-    }
+    struct epoxy_context_state *state = epoxy_current_context_state();
 
-#if PLATFORM_HAS_EGL
-    sym = epoxy_conservative_egl_dlsym("eglGetCurrentContext", false);
-    if (sym) {
-        if (epoxy_egl_get_current_gl_context_api() != EGL_NONE)
-            return false;
-    } else {
-        (void)dlerror();
-    }
-#endif /* PLATFORM_HAS_EGL */
-
-    return false;
-#endif /* PLATFORM_HAS_GLX */
+    return state && state->platform == EPOXY_CONTEXT_PLATFORM_GLX;
 }
 
 /**
@@ -617,16 +1799,102 @@ epoxy_current_context_is_glx(void)
 bool
 epoxy_has_gl_extension(const char *ext)
 {
-    return epoxy_internal_has_gl_extension(ext, false);
+    return epoxy_internal_has_gl_extension(epoxy_current_context_state(),
+                                           epoxy_gl_extension_id(ext),
+                                           ext, false);
 }
 
 bool
 epoxy_conservative_has_gl_extension(const char *ext)
 {
-    if (api.begin_count)
+    if (in_begin_end)
+        return true;
+
+    return epoxy_internal_has_gl_extension(epoxy_current_context_state(),
+                                           epoxy_gl_extension_id(ext),
+                                           ext, true);
+}
+
+bool
+epoxy_conservative_has_gl_extension_id(int id)
+{
+    if (in_begin_end)
         return true;
 
-    return epoxy_internal_has_gl_extension(ext, true);
+    return epoxy_internal_has_gl_extension(epoxy_current_context_state(),
+                                           id, gl_extension_name(id), true);
+}
+
+/**
+ * @brief Returns the ID that epoxy uses for a GL extension
+ *
+ * Checking for an extension by ID with epoxy_has_gl_extension_id() or
+ * epoxy_has_gl_extension_ids() only has to test a bit in a set that
+ * epoxy builds once per context, instead of searching the context's
+ * extension list.
+ *
+ * IDs depend on the GL registry that epoxy was built from, so they
+ * should be looked up at runtime and not stored anywhere.
+ *
+ * @param ext The name of the GL extension
+ * @return The ID of the extension, or -1 if the extension isn't in
+ * epoxy's registry (in which case use epoxy_has_gl_extension())
+ */
+int
+epoxy_gl_extension_id(const char *ext)
+{
+    if (!ext)
+        return -1;
+
+    return gl_extension_lookup(ext, strlen(ext));
+}
+
+/**
+ * @brief Returns true if the GL extension with the given ID is
+ * supported in the current context.
+ *
+ * @param id The ID of the GL extension, from epoxy_gl_extension_id()
+ * @return `true` if the extension is available
+ *
+ * @see epoxy_has_gl_extension()
+ */
+bool
+epoxy_has_gl_extension_id(int id)
+{
+    if (id < 0 || id >= gl_extension_count)
+        return false;
+
+    return epoxy_internal_has_gl_extension(epoxy_current_context_state(),
+                                           id, gl_extension_name(id), false);
+}
+
+/**
+ * @brief Checks for many GL extensions in the current context at once
+ *
+ * @param ids The IDs of the GL extensions, from epoxy_gl_extension_id()
+ * @param count The number of IDs, at most 64
+ * @return A mask with bit `i` set if extension `ids[i]` is available
+ *
+ * @see epoxy_has_gl_extension_id()
+ */
+uint64_t
+epoxy_has_gl_extension_ids(const int *ids, int count)
+{
+    struct epoxy_context_state *state = epoxy_current_context_state();
+    uint64_t mask = 0;
+    int i;
+
+    for (i = 0; i < count && i < 64; i++) {
+        if (ids[i] < 0 || ids[i] >= gl_extension_count)
+            continue;
+
+        if (epoxy_internal_has_gl_extension(state, ids[i],
+                                            gl_extension_name(ids[i]),
+                                            false))
+            mask |= (uint64_t)1 << i;
+    }
+
+    return mask;
 }
 
 bool
@@ -664,7 +1932,7 @@ epoxy_glx_dlsym(const char *name)
 static void
 epoxy_load_gl(void)
 {
-    if (api.gl_handle)
+    if (epoxy_atomic_load_ptr(&api.gl_handle))
 	return;
 
 #if defined(_WIN32) || defined(__APPLE__)
@@ -675,15 +1943,15 @@ epoxy_load_gl(void)
     // Using the inverse ordering OPENGL_LIB -> GLX_LIB, causes issues such as:
     // https://github.com/anholt/libepoxy/issues/240 (apitrace missing calls)
     // https://github.com/anholt/libepoxy/issues/252 (Xorg boot crash)
-    get_dlopen_handle(&api.glx_handle, GLX_LIB, false, true);
-    api.gl_handle = api.glx_handle;
+    if (get_dlopen_handle(&api.glx_handle, GLX_LIB, false, true))
+        epoxy_atomic_cas_ptr(&api.gl_handle, NULL, api.glx_handle);
 
 #if defined(OPENGL_LIB)
-    if (!api.gl_handle)
+    if (!epoxy_atomic_load_ptr(&api.gl_handle))
         get_dlopen_handle(&api.gl_handle, OPENGL_LIB, false, true);
 #endif
 
-    if (!api.gl_handle) {
+    if (!epoxy_atomic_load_ptr(&api.gl_handle)) {
 #if defined(OPENGL_LIB)
         fprintf(stderr, "Couldn't open %s or %s\n", GLX_LIB, OPENGL_LIB);
 #else
@@ -780,19 +2048,24 @@ epoxy_get_core_proc_address(const char *name, int core_version)
 
 #if PLATFORM_HAS_EGL
 static EGLenum
-epoxy_egl_get_current_gl_context_api(void)
+epoxy_egl_context_state_api(struct epoxy_context_state *state)
 {
     EGLint curapi;
 
-    if (!api.egl_handle)
+    if (!state || state->platform != EPOXY_CONTEXT_PLATFORM_EGL)
         return EGL_NONE;
 
-    if (eglQueryContext(eglGetCurrentDisplay(), eglGetCurrentContext(),
+    if (state->egl_client_type != -1)
+        return (EGLenum) state->egl_client_type;
+
+    if (eglQueryContext(state->display, state->context,
 			EGL_CONTEXT_CLIENT_TYPE, &curapi) == EGL_FALSE) {
 	(void)eglGetError();
 	return EGL_NONE;
     }
 
+    state->egl_client_type = curapi;
+
     return (EGLenum) curapi;
 }
 #endif /* PLATFORM_HAS_EGL */
@@ -814,7 +2087,7 @@ epoxy_get_bootstrap_proc_address(const char *name)
      * use that.
      */
 #if PLATFORM_HAS_GLX
-    if (api.glx_handle && glXGetCurrentContext())
+    if (epoxy_atomic_load_ptr(&api.glx_handle) && epoxy_current_context_is_glx())
         return epoxy_gl_dlsym(name);
 #endif
 
@@ -824,15 +2097,15 @@ epoxy_get_bootstrap_proc_address(const char *name)
      * non-X11 ES2 context from loading a bunch of X11 junk).
      */
 #if PLATFORM_HAS_EGL
-    get_dlopen_handle(&api.egl_handle, EGL_LIB, false, true);
-    if (api.egl_handle) {
+    if (get_dlopen_handle(&api.egl_handle, EGL_LIB, false, true)) {
+        struct epoxy_context_state *state = epoxy_current_context_state();
         int version = 0;
-        switch (epoxy_egl_get_current_gl_context_api()) {
+        switch (epoxy_egl_context_state_api(state)) {
         case EGL_OPENGL_API:
             return epoxy_gl_dlsym(name);
         case EGL_OPENGL_ES_API:
-            if (eglQueryContext(eglGetCurrentDisplay(),
-                                eglGetCurrentContext(),
+            if (eglQueryContext(state->display,
+                                state->context,
                                 EGL_CONTEXT_CLIENT_VERSION,
                                 &version)) {
                 if (version >= 2)
@@ -851,15 +2124,15 @@ epoxy_get_bootstrap_proc_address(const char *name)
 void *
 epoxy_get_proc_address(const char *name)
 {
-#if PLATFORM_HAS_EGL
-    GLenum egl_api = EGL_NONE;
-
-    if (!epoxy_current_context_is_glx())
-      egl_api = epoxy_egl_get_current_gl_context_api();
+#if PLATFORM_HAS_EGL || PLATFORM_HAS_GLX
+    struct epoxy_context_state *state = epoxy_current_context_state();
+#endif
 
-    switch (egl_api) {
+#if PLATFORM_HAS_EGL
+    switch (epoxy_egl_context_state_api(state)) {
     case EGL_OPENGL_API:
     case EGL_OPENGL_ES_API:
+        epoxy_resolve_report_loader("eglGetProcAddress");
         return eglGetProcAddress(name);
     case EGL_NONE:
         break;
@@ -867,12 +2140,15 @@ epoxy_get_proc_address(const char *name)
 #endif
 
 #if defined(_WIN32)
+    epoxy_resolve_report_loader("wglGetProcAddress");
     return wglGetProcAddress(name);
 #elif defined(__APPLE__)
     return epoxy_gl_dlsym(name);
 #elif PLATFORM_HAS_GLX
-    if (epoxy_current_context_is_glx())
+    if (state && state->platform == EPOXY_CONTEXT_PLATFORM_GLX) {
+        epoxy_resolve_report_loader("glXGetProcAddressARB");
         return glXGetProcAddressARB((const GLubyte *)name);
+    }
     assert(0 && "Couldn't find current GLX or EGL context.\n");
 #endif
 
@@ -882,13 +2158,7 @@ epoxy_get_proc_address(const char *name)
 WRAPPER_VISIBILITY (void)
 WRAPPER(epoxy_glBegin)(GLenum primtype)
 {
-#ifdef _WIN32
-    InterlockedIncrement(&api.begin_count);
-#else
-    pthread_mutex_lock(&api.mutex);
-    api.begin_count++;
-    pthread_mutex_unlock(&api.mutex);
-#endif
+    in_begin_end = true;
 
     epoxy_glBegin_unwrapped(primtype);
 }
@@ -898,13 +2168,7 @@ WRAPPER(epoxy_glEnd)(void)
 {
     epoxy_glEnd_unwrapped();
 
-#ifdef _WIN32
-    InterlockedDecrement(&api.begin_count);
-#else
-    pthread_mutex_lock(&api.mutex);
-    api.begin_count--;
-    pthread_mutex_unlock(&api.mutex);
-#endif
+    in_begin_end = false;
 }
 
 PFNGLBEGINPROC epoxy_glBegin = epoxy_glBegin_wrapped;
@@ -922,15 +2186,351 @@ epoxy_resolver_failure_handler_t epoxy_resolver_failure_handler;
 epoxy_resolver_failure_handler_t
 epoxy_set_resolver_failure_handler(epoxy_resolver_failure_handler_t handler)
 {
-#ifdef _WIN32
-    return InterlockedExchangePointer((void**)&epoxy_resolver_failure_handler,
-				      handler);
-#else
-    epoxy_resolver_failure_handler_t old;
-    pthread_mutex_lock(&api.mutex);
-    old = epoxy_resolver_failure_handler;
-    epoxy_resolver_failure_handler = handler;
-    pthread_mutex_unlock(&api.mutex);
-    return old;
+    return epoxy_atomic_exchange_ptr(&epoxy_resolver_failure_handler, handler);
+}
+
+/**
+ * @brief Resolves every function that the current context provides.
+ *
+ * Epoxy normally looks up each function the first time it's called.
+ * This does all of those lookups at once, for apps that would rather
+ * pay for them up front than in the middle of their first frames.
+ * Functions that the context doesn't provide are left alone, so that
+ * calling them still reports the failure.
+ *
+ * Setting the `EPOXY_EAGER` environment variable to 1 does this
+ * automatically, the first time a function gets resolved with a
+ * context current.
+ *
+ * @return The number of functions resolved, which is 0 if no context
+ * is current.
+ */
+int
+epoxy_resolve_all(void)
+{
+    struct epoxy_context_state *state;
+    int resolved;
+
+    if (in_begin_end)
+        return 0;
+
+    state = epoxy_current_context_state();
+    if (!state)
+        return 0;
+
+    resolved = gl_resolve_all();
+
+    switch (state->platform) {
+#if PLATFORM_HAS_GLX
+    case EPOXY_CONTEXT_PLATFORM_GLX:
+        resolved += glx_resolve_all();
+        break;
+#endif
+#if PLATFORM_HAS_EGL
+    case EPOXY_CONTEXT_PLATFORM_EGL:
+        resolved += egl_resolve_all();
+        break;
+#endif
+#if PLATFORM_HAS_WGL
+    case EPOXY_CONTEXT_PLATFORM_WGL:
+        resolved += wgl_resolve_all();
+        break;
+#endif
+    default:
+        break;
+    }
+
+    return resolved;
+}
+
+/**
+ * @brief Resolves the functions of a single version or extension.
+ *
+ * This is like epoxy_resolve_all(), but only for the functions that
+ * the feature provides.  They still get resolved from whichever
+ * provider the current context prefers.
+ *
+ * @param feature The registry name of the version or extension, like
+ * `GL_VERSION_4_5` or `GL_ARB_direct_state_access`.
+ *
+ * @return The number of functions resolved, which is 0 if no context
+ * is current, or -1 if epoxy doesn't know of the feature.
+ */
+int
+epoxy_resolve_feature(const char *feature)
+{
+    int resolved;
+
+    if (in_begin_end || !epoxy_current_context_state())
+        return 0;
+
+    resolved = gl_resolve_feature(feature);
+#if PLATFORM_HAS_GLX
+    if (resolved < 0)
+        resolved = glx_resolve_feature(feature);
+#endif
+#if PLATFORM_HAS_EGL
+    if (resolved < 0)
+        resolved = egl_resolve_feature(feature);
+#endif
+#if PLATFORM_HAS_WGL
+    if (resolved < 0)
+        resolved = wgl_resolve_feature(feature);
+#endif
+
+    return resolved;
+}
+
+static void *
+epoxy_internal_lookup(const char *name, size_t len)
+{
+    int function;
+
+    function = gl_function_lookup(name, len);
+    if (function >= 0) {
+        void *func = gl_get_function(function, false);
+
+        if (!func && epoxy_current_context_state())
+            func = gl_get_function(function, true);
+        return func;
+    }
+
+#if PLATFORM_HAS_GLX
+    function = glx_function_lookup(name, len);
+    if (function >= 0)
+        return glx_get_function(function, true);
+#endif
+#if PLATFORM_HAS_EGL
+    function = egl_function_lookup(name, len);
+    if (function >= 0)
+        return egl_get_function(function, true);
+#endif
+#if PLATFORM_HAS_WGL
+    function = wgl_function_lookup(name, len);
+    if (function >= 0)
+        return wgl_get_function(function, true);
+#endif
+
+    return NULL;
+}
+
+/**
+ * @brief Returns the pointer epoxy calls a function through, by name.
+ *
+ * This is for code that only has the names of the functions it needs,
+ * like language bindings.  Unlike `eglGetProcAddress()` and friends,
+ * the function is resolved the same way that calling it through epoxy
+ * would, using any of its aliases, and later lookups return what was
+ * resolved without going back to the driver.  The name is found with
+ * a perfect hash generated from the registry, so this takes constant
+ * time.
+ *
+ * GL functions that haven't been resolved yet need a context to be
+ * current.
+ *
+ * @param name The name of the function, like `glDrawArrays`.
+ *
+ * @return The function pointer, or NULL if epoxy doesn't know of the
+ * function or the current context doesn't provide it.
+ */
+void *
+epoxy_lookup(const char *name)
+{
+    return epoxy_internal_lookup(name, strlen(name));
+}
+
+/**
+ * @brief Resolves the functions listed in a profile.
+ *
+ * Running an app with `EPOXY_PROFILE_OUT` set to a file name writes
+ * the names of the functions it resolved to that file at exit, one per
+ * line.
+ * Resolving just those up front gets most of the benefit of
+ * epoxy_resolve_all(), without looking up the thousands of functions
+ * the app never calls.  Setting `EPOXY_PROFILE_IN` to the file does
+ * this automatically, the first time a function gets resolved with a
+ * context current.
+ *
+ * Names that epoxy doesn't know, or that the current context doesn't
+ * provide, are skipped.
+ *
+ * @param path The profile file.
+ *
+ * @return The number of functions from the profile that are resolved,
+ * or -1 if the file couldn't be read.
+ */
+int
+epoxy_preresolve_profile(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    char line[256];
+    int resolved = 0;
+
+    if (!file)
+        return -1;
+
+    while (fgets(line, sizeof(line), file)) {
+        size_t len = strcspn(line, "\r\n");
+
+        if (len > 0 && epoxy_internal_lookup(line, len))
+            resolved++;
+    }
+
+    fclose(file);
+
+    return resolved;
+}
+
+/* Where EPOXY_PROFILE_OUT writes the functions that got resolved at
+ * exit, or NULL if it isn't set, and a bitset of them for each target.
+ */
+static FILE *profile_out;
+static long *profile_resolved[EPOXY_TARGET_COUNT];
+
+#define PROFILE_WORD_BITS (8 * sizeof(long))
+
+static const struct profile_target {
+    const int *count;
+    const char *(*name)(int function);
+} profile_targets[EPOXY_TARGET_COUNT] = {
+    [EPOXY_TARGET_GL] = { &gl_function_count, gl_function_name },
+#if PLATFORM_HAS_EGL
+    [EPOXY_TARGET_EGL] = { &egl_function_count, egl_function_name },
+#endif
+#if PLATFORM_HAS_GLX
+    [EPOXY_TARGET_GLX] = { &glx_function_count, glx_function_name },
+#endif
+#if PLATFORM_HAS_WGL
+    [EPOXY_TARGET_WGL] = { &wgl_function_count, wgl_function_name },
 #endif
+};
+
+/* Called by the generated code for every function that gets resolved. */
+void
+epoxy_profile_record(enum epoxy_dispatch_target target, int function)
+{
+    long *resolved = profile_resolved[target];
+
+    if (!resolved)
+        return;
+
+    epoxy_atomic_or_long(&resolved[function / PROFILE_WORD_BITS],
+                         (long)(1ul << (function % PROFILE_WORD_BITS)));
+}
+
+static void
+profile_init(const char *path)
+{
+    int target;
+
+    profile_out = fopen(path, "w");
+    if (!profile_out) {
+        fprintf(stderr, "Couldn't open the epoxy profile %s\n", path);
+        return;
+    }
+
+    for (target = 0; target < EPOXY_TARGET_COUNT; target++) {
+        if (profile_targets[target].count) {
+            int count = *profile_targets[target].count;
+
+            profile_resolved[target] = calloc((count + PROFILE_WORD_BITS - 1) /
+                                              PROFILE_WORD_BITS, sizeof(long));
+        }
+    }
+}
+
+static void
+profile_fini(void)
+{
+    int target, function;
+
+    if (!profile_out)
+        return;
+
+    for (target = 0; target < EPOXY_TARGET_COUNT; target++) {
+        long *resolved = profile_resolved[target];
+
+        if (!resolved)
+            continue;
+
+        for (function = 0; function < *profile_targets[target].count; function++) {
+            if (epoxy_atomic_load_long(&resolved[function / PROFILE_WORD_BITS]) &
+                (long)(1ul << (function % PROFILE_WORD_BITS)))
+                fprintf(profile_out, "%s\n", profile_targets[target].name(function));
+        }
+    }
+
+    fclose(profile_out);
+    profile_out = NULL;
+}
+
+/* The progress of the up front resolution asked for by the
+ * environment, in eager_state.
+ */
+enum {
+    EAGER_DISABLED,
+    EAGER_PENDING,
+    EAGER_RUNNING,
+    EAGER_DONE,
+};
+
+static long eager_state;
+static bool eager_all;
+static char *eager_profile;
+static char *eager_cache;
+
+/* Called by the generated code before every lazy resolve, to do the
+ * up front resolution asked for by the environment instead.  It gets
+ * retried until there's a current context to resolve against, and the
+ * resolves made while it's running don't recurse back in.
+ */
+void
+epoxy_eager_resolve(void)
+{
+    if (epoxy_atomic_load_long(&eager_state) != EAGER_PENDING ||
+        !epoxy_atomic_cas_long(&eager_state, EAGER_PENDING, EAGER_RUNNING))
+        return;
+
+    if (in_begin_end || !epoxy_current_context_state()) {
+        epoxy_atomic_cas_long(&eager_state, EAGER_RUNNING, EAGER_PENDING);
+        return;
+    }
+
+    if (eager_cache)
+        epoxy_resolve_cache_load(eager_cache);
+
+    if (eager_profile) {
+        if (epoxy_preresolve_profile(eager_profile) < 0)
+            fprintf(stderr, "Couldn't read the epoxy profile %s\n", eager_profile);
+    } else if (eager_all) {
+        epoxy_resolve_all();
+    }
+
+    epoxy_atomic_cas_long(&eager_state, EAGER_RUNNING, EAGER_DONE);
+}
+
+static void
+eager_init(void)
+{
+    const char *env;
+
+    env = getenv("EPOXY_PROFILE_OUT");
+    if (env && env[0])
+        profile_init(env);
+
+    env = getenv("EPOXY_RESOLVE_CACHE");
+    if (env && env[0])
+        eager_cache = strdup(env);
+
+    env = getenv("EPOXY_EAGER");
+    if (env && atoi(env)) {
+        eager_all = true;
+    } else {
+        env = getenv("EPOXY_PROFILE_IN");
+        if (env && env[0])
+            eager_profile = strdup(env);
+    }
+
+    if (eager_all || eager_profile || eager_cache)
+        eager_state = EAGER_PENDING;
 }
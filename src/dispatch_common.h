@@ -73,89 +73,635 @@
 #define ENDPACKED
 #endif
 
-/* On win32, we're going to need to keep a per-thread dispatch table,
- * since the function pointers depend on the device and pixel format
- * of the current context.
+/* Whether GL calls can go through per-context dispatch tables, once
+ * contexts that need different function pointers show up.
  */
 #if defined(_WIN32)
 #define USING_DISPATCH_TABLE 1
-#else
+#elif defined(__APPLE__) || defined(ANDROID)
 #define USING_DISPATCH_TABLE 0
+#else
+#define USING_DISPATCH_TABLE (PLATFORM_HAS_GLX || PLATFORM_HAS_EGL)
+#endif
+
+/* Pointer-sized, long and 64-bit atomics, used for publishing lazily
+ * allocated state that other threads may be reading without holding a
+ * lock, and for counters.
+ */
+#if defined(_MSC_VER)
+#define epoxy_atomic_load_ptr(p) \
+    InterlockedCompareExchangePointer((PVOID volatile *)(p), NULL, NULL)
+#define epoxy_atomic_cas_ptr(p, oldval, newval) \
+    (InterlockedCompareExchangePointer((PVOID volatile *)(p), (newval), (oldval)) == (oldval))
+#define epoxy_atomic_store_ptr(p, val) \
+    ((void)InterlockedExchangePointer((PVOID volatile *)(p), (val)))
+#define epoxy_atomic_exchange_ptr(p, val) \
+    InterlockedExchangePointer((PVOID volatile *)(p), (val))
+#define epoxy_atomic_load_long(p) \
+    InterlockedCompareExchange((LONG volatile *)(p), 0, 0)
+#define epoxy_atomic_cas_long(p, oldval, newval) \
+    (InterlockedCompareExchange((LONG volatile *)(p), (newval), (oldval)) == (oldval))
+#define epoxy_atomic_add_u64(p, val) \
+    ((void)InterlockedExchangeAdd64((LONG64 volatile *)(p), (val)))
+#define epoxy_atomic_or_long(p, val) \
+    ((void)InterlockedOr((LONG volatile *)(p), (val)))
+#else
+#define epoxy_atomic_load_ptr(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define epoxy_atomic_cas_ptr(p, oldval, newval) \
+    __sync_bool_compare_and_swap((p), (oldval), (newval))
+#define epoxy_atomic_store_ptr(p, val) __atomic_store_n((p), (val), __ATOMIC_RELEASE)
+#define epoxy_atomic_exchange_ptr(p, val) \
+    __atomic_exchange_n((p), (val), __ATOMIC_ACQ_REL)
+#define epoxy_atomic_load_long(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define epoxy_atomic_cas_long(p, oldval, newval) \
+    __sync_bool_compare_and_swap((p), (oldval), (newval))
+#define epoxy_atomic_add_u64(p, val) \
+    ((void)__atomic_fetch_add((p), (val), __ATOMIC_RELAXED))
+#define epoxy_atomic_or_long(p, val) \
+    ((void)__atomic_fetch_or((p), (val), __ATOMIC_RELAXED))
+#endif
+
+#if defined(_MSC_VER)
+#define EPOXY_THREAD_LOCAL __declspec(thread)
+#else
+#define EPOXY_THREAD_LOCAL __thread
+#endif
+
+/* For thread-local data read on every GL call: the initial-exec model
+ * makes that a single load, using the room glibc sets aside for
+ * dlopen()ed libraries, like Mesa's dispatch does.
+ */
+#if defined(__GLIBC__) && defined(__GNUC__)
+#define EPOXY_THREAD_LOCAL_FAST \
+    __attribute__((tls_model("initial-exec"))) EPOXY_THREAD_LOCAL
+#else
+#define EPOXY_THREAD_LOCAL_FAST EPOXY_THREAD_LOCAL
+#endif
+
+/* Code that only runs while resolving goes with the rest of the
+ * unlikely code, and the pointers and thunks of the functions that get
+ * called the most go together, so that the draw path touches as few
+ * cache lines and pages as possible.  The hot pointers get a section
+ * of their own, which EPOXY_HOT_DATA_ALIGN starts on a cache line.
+ */
+#ifdef __GNUC__
+#define EPOXY_COLD __attribute__((cold))
+#define EPOXY_HOT __attribute__((hot))
+#else
+#define EPOXY_COLD
+#define EPOXY_HOT
+#endif
+
+#if defined(__GNUC__) && defined(__ELF__)
+#define EPOXY_HOT_DATA __attribute__((section(".data.epoxy_hot")))
+#define EPOXY_HOT_DATA_ALIGN \
+    __asm__(".pushsection .data.epoxy_hot,\"aw\"\n.balign 64\n.popsection");
+#else
+#define EPOXY_HOT_DATA
+#define EPOXY_HOT_DATA_ALIGN
 #endif
 
 #define UNWRAPPED_PROTO(x) (GLAPIENTRY *x)
 #define WRAPPER_VISIBILITY(type) static type GLAPIENTRY
 #define WRAPPER(x) x ## _wrapped
 
-#define GEN_GLOBAL_REWRITE_PTR(name, args, passthrough)          \
-    static void EPOXY_CALLSPEC                                   \
-    name##_global_rewrite_ptr args                               \
-    {                                                            \
-        if (name == (void *)name##_global_rewrite_ptr)           \
-            name = (void *)name##_resolver();                    \
-        name passthrough;                                        \
+/* An executable may have its own copies of the public function
+ * pointers it uses (copy relocations), and those are the ones that
+ * calls go through.  Referring to the pointers through the GOT, which
+ * takes care of that, has the dynamic linker look up thousands of
+ * symbols whenever epoxy gets loaded, so the generated code instead
+ * asks epoxy_public_pointer() where each pointer lives when it first
+ * needs to know, and otherwise only refers to its own pointers through
+ * hidden aliases.
+ */
+#if defined(__GLIBC__) && defined(__ELF__) && defined(__GNUC__)
+#define USING_PUBLIC_POINTER_LOOKUP 1
+#define LOCAL_ALIAS(type, name) \
+    extern type name##_local __attribute__((alias(#name), visibility("hidden")));
+#define LOCAL_POINTER(name) name##_local
+#define PUBLIC_POINTER(name, function) \
+    (*(__typeof__(name) *)public_pointer(function))
+#define RESOLVED_POINTER(name, function)                                 \
+    (*(__typeof__(name) *)resolve_public_pointer(function,             \
+                                                 (void *)name##_global_rewrite_ptr))
+#else
+#define USING_PUBLIC_POINTER_LOOKUP 0
+#define LOCAL_ALIAS(type, name)
+#define LOCAL_POINTER(name) name
+#define PUBLIC_POINTER(name, function) name
+#define RESOLVED_POINTER(name, function)                                 \
+    (resolve_public_pointer(function, (void *)name##_global_rewrite_ptr), name)
+#endif
+
+/* The thunks that the global pointers start out with leave the work
+ * to resolve_public_pointer(), so that each of them is only a call and
+ * a jump.
+ */
+#define GEN_GLOBAL_REWRITE_PTR(name, function, args, passthrough)  \
+    static EPOXY_COLD void EPOXY_CALLSPEC                          \
+    name##_global_rewrite_ptr args                                 \
+    {                                                              \
+        RESOLVED_POINTER(name, function) passthrough;              \
     }
 
-#define GEN_GLOBAL_REWRITE_PTR_RET(ret, name, args, passthrough) \
-    static ret EPOXY_CALLSPEC                                    \
-    name##_global_rewrite_ptr args                               \
-    {                                                            \
-        if (name == (void *)name##_global_rewrite_ptr)           \
-            name = (void *)name##_resolver();                    \
-        return name passthrough;                                 \
+#define GEN_GLOBAL_REWRITE_PTR_RET(ret, name, function, args, passthrough) \
+    static EPOXY_COLD ret EPOXY_CALLSPEC                           \
+    name##_global_rewrite_ptr args                                 \
+    {                                                              \
+        return RESOLVED_POINTER(name, function) passthrough;       \
     }
 
 #if USING_DISPATCH_TABLE
-#define GEN_DISPATCH_TABLE_REWRITE_PTR(name, args, passthrough)            \
+/* Dispatch table entries start out NULL, and get resolved on the
+ * first call through them.
+ */
+#define GEN_DISPATCH_TABLE_THUNK(attr, name, args, passthrough)            \
+    static attr void EPOXY_CALLSPEC                                        \
+    name##_dispatch_table_thunk args                                       \
+    {                                                                      \
+        get_resolved_dispatch_table(offsetof(struct dispatch_table, name)) \
+            ->name passthrough;                                            \
+    }
+
+#define GEN_DISPATCH_TABLE_THUNK_RET(attr, ret, name, args, passthrough)   \
+    static attr ret EPOXY_CALLSPEC                                         \
+    name##_dispatch_table_thunk args                                       \
+    {                                                                      \
+        return get_resolved_dispatch_table(offsetof(struct dispatch_table, name)) \
+            ->name passthrough;                                            \
+    }
+
+#else
+#define GEN_DISPATCH_TABLE_THUNK(attr, name, args, passthrough)
+#define GEN_DISPATCH_TABLE_THUNK_RET(attr, ret, name, args, passthrough)
+#endif
+
+#define GEN_THUNKS(name, function, args, passthrough)                \
+    GEN_GLOBAL_REWRITE_PTR(name, function, args, passthrough)        \
+    GEN_DISPATCH_TABLE_THUNK(, name, args, passthrough)
+
+#define GEN_THUNKS_RET(ret, name, function, args, passthrough)       \
+    GEN_GLOBAL_REWRITE_PTR_RET(ret, name, function, args, passthrough) \
+    GEN_DISPATCH_TABLE_THUNK_RET(, ret, name, args, passthrough)
+
+/* For the entrypoints in the call-frequency profile. */
+#define GEN_HOT_THUNKS(name, function, args, passthrough)            \
+    GEN_GLOBAL_REWRITE_PTR(name, function, args, passthrough)        \
+    GEN_DISPATCH_TABLE_THUNK(EPOXY_HOT, name, args, passthrough)
+
+#define GEN_HOT_THUNKS_RET(ret, name, function, args, passthrough)   \
+    GEN_GLOBAL_REWRITE_PTR_RET(ret, name, function, args, passthrough) \
+    GEN_DISPATCH_TABLE_THUNK_RET(EPOXY_HOT, ret, name, args, passthrough)
+
+/* For the entrypoints that always go through the global pointers. */
+#define GEN_GLOBAL_THUNKS(name, function, args, passthrough)         \
+    GEN_GLOBAL_REWRITE_PTR(name, function, args, passthrough)
+
+#define GEN_GLOBAL_THUNKS_RET(ret, name, function, args, passthrough) \
+    GEN_GLOBAL_REWRITE_PTR_RET(ret, name, function, args, passthrough)
+
+/* The statistics and tracing modes (EPOXY_STATS and EPOXY_TRACE_OUT),
+ * the command queue and the shadow state interpose thunks of their own, which the
+ * generated code swaps into the public pointers, treating the slots
+ * they call through as the functions' pointers for as long as they're
+ * in.  Only one of them can be in at a time.  This relies on finding
+ * the public pointers, so it's left out where they can't be looked up.
+ */
+#define USING_INSTRUMENTATION (ENABLE_INSTRUMENTATION && USING_PUBLIC_POINTER_LOOKUP)
+#define USING_QUEUE (ENABLE_QUEUE && USING_PUBLIC_POINTER_LOOKUP)
+#define USING_SHADOW_STATE (ENABLE_SHADOW_STATE && USING_PUBLIC_POINTER_LOOKUP)
+#define USING_INTERPOSERS (USING_INSTRUMENTATION || USING_QUEUE || USING_SHADOW_STATE)
+
+enum epoxy_interposer {
+    EPOXY_INTERPOSER_NONE,
+    EPOXY_INTERPOSER_INSTRUMENTATION,
+    EPOXY_INTERPOSER_QUEUE,
+    EPOXY_INTERPOSER_SHADOW_STATE,
+};
+
+#define UNPARENTHESIZED(...) __VA_ARGS__
+
+#define INTERPOSED_CALL(name, function, passthrough)                       \
+    ((__typeof__(name))                                                    \
+     epoxy_atomic_load_ptr(&interposed_targets[function])) passthrough
+
+/* Besides the function, the instrumented thunks hand the hooks the
+ * integer and floating point arguments among the first eight, up to
+ * four of them, and flags saying where those came from.
+ */
+
+#define EPOXY_INSTRUMENT_FRAME 1
+#define EPOXY_INSTRUMENT_MAX_ARGS 4
+#define EPOXY_INSTRUMENT_ARG_COUNT(flags) (((flags) >> 1) & 7)
+#define EPOXY_INSTRUMENT_ARG_POSITION(flags, i) (((flags) >> (4 + 4 * (i))) & 7)
+#define EPOXY_INSTRUMENT_ARG_IS_FLOAT(flags, i) (((flags) >> (7 + 4 * (i))) & 1)
+
+#if USING_INSTRUMENTATION
+#define INSTRUMENTED_LEAVE(function, start, flags, values)                 \
+    epoxy_instrument_leave(INSTRUMENTED_TARGET, function, start, flags,    \
+                           (const int64_t[]) { UNPARENTHESIZED values })
+
+#define GEN_INSTRUMENTED_THUNK(name, function, flags, args, passthrough,   \
+                               values)                                     \
     static void EPOXY_CALLSPEC                                             \
-    name##_dispatch_table_rewrite_ptr args                                 \
+    name##_instrumented_thunk args                                         \
     {                                                                      \
-        struct dispatch_table *dispatch_table = get_dispatch_table();      \
+        uint64_t instrumented_start =                                      \
+            epoxy_instrument_enter(INSTRUMENTED_TARGET, function);         \
+        INTERPOSED_CALL(name, function, passthrough);                    \
+        INSTRUMENTED_LEAVE(function, instrumented_start, flags, values);   \
+    }
+
+#define GEN_INSTRUMENTED_THUNK_RET(ret, name, function, flags, args,       \
+                                   passthrough, values)                    \
+    static ret EPOXY_CALLSPEC                                              \
+    name##_instrumented_thunk args                                         \
+    {                                                                      \
+        uint64_t instrumented_start =                                      \
+            epoxy_instrument_enter(INSTRUMENTED_TARGET, function);         \
+        ret instrumented_result =                                          \
+            INTERPOSED_CALL(name, function, passthrough);                \
+        INSTRUMENTED_LEAVE(function, instrumented_start, flags, values);   \
+        return instrumented_result;                                        \
+    }
+
+/* The bits of a floating point argument, as a double. */
+static inline int64_t
+epoxy_instrument_float(double value)
+{
+    union {
+        double value;
+        int64_t bits;
+    } u;
+
+    u.value = value;
+    return u.bits;
+}
+#endif
+
+/* On the thread that started the command queue, the queued thunks put
+ * their arguments in a struct, which they hand to the queue along with
+ * the function replaying the call from it on the queue's thread.  The
+ * calls that return something, or pass pointers, wait for that.  Other
+ * threads just call through.
+ */
+#define EPOXY_QUEUE_SYNC 1
+#define EPOXY_QUEUE_FLUSH 2
+
+#if USING_QUEUE
+#define GEN_QUEUED_THUNK(name, function, flags, args, passthrough,         \
+                         members, values, replay_args)                     \
+    struct name##_queued { members };                                      \
+                                                                           \
+    static void                                                            \
+    name##_replay(void *data)                                              \
+    {                                                                      \
+        struct name##_queued *queued = data;                               \
+                                                                           \
+        (void)queued;                                                      \
+        INTERPOSED_CALL(name, function, replay_args);                      \
+    }                                                                      \
                                                                            \
-        dispatch_table->name = (void *)name##_resolver();                  \
-        dispatch_table->name passthrough;                                  \
+    static void EPOXY_CALLSPEC                                             \
+    name##_queued_thunk args                                               \
+    {                                                                      \
+        if (epoxy_queue_producer) {                                        \
+            struct name##_queued queued_call = { UNPARENTHESIZED values }; \
+                                                                           \
+            epoxy_queue_call(name##_replay, &queued_call,                  \
+                             sizeof(queued_call), flags);                  \
+        } else {                                                           \
+            INTERPOSED_CALL(name, function, passthrough);                  \
+        }                                                                  \
     }
 
-#define GEN_DISPATCH_TABLE_REWRITE_PTR_RET(ret, name, args, passthrough)   \
+#define GEN_QUEUED_THUNK_RET(ret, name, function, args, passthrough,       \
+                             members, values, replay_args)                 \
+    struct name##_queued { members ret queued_result; };                   \
+                                                                           \
+    static void                                                            \
+    name##_replay(void *data)                                              \
+    {                                                                      \
+        struct name##_queued *queued = data;                               \
+                                                                           \
+        queued->queued_result = INTERPOSED_CALL(name, function, replay_args); \
+    }                                                                      \
+                                                                           \
     static ret EPOXY_CALLSPEC                                              \
-    name##_dispatch_table_rewrite_ptr args                                 \
+    name##_queued_thunk args                                               \
     {                                                                      \
-        struct dispatch_table *dispatch_table = get_dispatch_table();      \
+        if (epoxy_queue_producer) {                                        \
+            struct name##_queued queued_call = { UNPARENTHESIZED values }; \
                                                                            \
-        dispatch_table->name = (void *)name##_resolver();                  \
-        return dispatch_table->name passthrough;                           \
+            epoxy_queue_call(name##_replay, &queued_call,                  \
+                             sizeof(queued_call), EPOXY_QUEUE_SYNC);       \
+            return queued_call.queued_result;                              \
+        }                                                                  \
+        return INTERPOSED_CALL(name, function, passthrough);               \
     }
+#endif
 
-#define GEN_DISPATCH_TABLE_THUNK(name, args, passthrough)                  \
+/* The shadow state's thunks hand the integer arguments of the calls it
+ * keeps track of to the filter, which says whether the call would
+ * change anything, or forgets what the call may change.  The query
+ * cache goes in with it, with thunks handing the queries to hooks that
+ * answer them, or make them through the pointer they're given.
+ */
+enum epoxy_shadow_call {
+    EPOXY_SHADOW_ENABLE,
+    EPOXY_SHADOW_DISABLE,
+    EPOXY_SHADOW_ACTIVE_TEXTURE,
+    EPOXY_SHADOW_BIND_TEXTURE,
+    EPOXY_SHADOW_BIND_BUFFER,
+    EPOXY_SHADOW_USE_PROGRAM,
+    EPOXY_SHADOW_BLEND_FUNC,
+    EPOXY_SHADOW_BLEND_FUNC_SEPARATE,
+    /* The calls that it can't model, but knows what they change. */
+    EPOXY_SHADOW_INDEXED_CAP,
+    EPOXY_SHADOW_INDEXED_BLEND_FUNC,
+    EPOXY_SHADOW_TEXTURES,
+    EPOXY_SHADOW_BUFFERS,
+    EPOXY_SHADOW_VERTEX_ARRAY,
+    EPOXY_SHADOW_PROGRAM,
+    /* Creating, linking or deleting objects that contexts may share. */
+    EPOXY_SHADOW_OBJECTS,
+    EPOXY_SHADOW_NEW_LIST,
+    EPOXY_SHADOW_END_LIST,
+    EPOXY_SHADOW_ALL,
+};
+
+#if USING_SHADOW_STATE
+#define GEN_SHADOWED_THUNK(name, function, call, args, passthrough, values) \
     static void EPOXY_CALLSPEC                                             \
-    name##_dispatch_table_thunk args                                       \
+    name##_shadowed_thunk args                                             \
+    {                                                                      \
+        if (epoxy_shadow_state_filter(call, (const uint32_t[]) {           \
+                    UNPARENTHESIZED values }))                             \
+            INTERPOSED_CALL(name, function, passthrough);                  \
+    }
+
+#define GEN_SHADOWED_QUERY_THUNK(name, function, args, passthrough, hook)  \
+    static void EPOXY_CALLSPEC                                             \
+    name##_shadowed_thunk args                                             \
     {                                                                      \
-        get_dispatch_table()->name passthrough;                            \
+        hook((__typeof__(name))                                            \
+             epoxy_atomic_load_ptr(&interposed_targets[function]),         \
+             UNPARENTHESIZED passthrough);                                 \
     }
 
-#define GEN_DISPATCH_TABLE_THUNK_RET(ret, name, args, passthrough)         \
+#define GEN_SHADOWED_QUERY_THUNK_RET(ret, name, function, args,           \
+                                     passthrough, hook)                    \
     static ret EPOXY_CALLSPEC                                              \
-    name##_dispatch_table_thunk args                                       \
+    name##_shadowed_thunk args                                             \
     {                                                                      \
-        return get_dispatch_table()->name passthrough;                     \
+        return hook((__typeof__(name))                                     \
+                    epoxy_atomic_load_ptr(&interposed_targets[function]),  \
+                    UNPARENTHESIZED passthrough);                          \
     }
+#endif
 
-#else
-#define GEN_DISPATCH_TABLE_REWRITE_PTR(name, args, passthrough)
-#define GEN_DISPATCH_TABLE_REWRITE_PTR_RET(ret, name, args, passthrough)
-#define GEN_DISPATCH_TABLE_THUNK(name, args, passthrough)
-#define GEN_DISPATCH_TABLE_THUNK_RET(ret, name, args, passthrough)
+/* The generated dispatch code that a per-context provider cache
+ * belongs to.
+ */
+enum epoxy_dispatch_target {
+    EPOXY_TARGET_GL,
+    EPOXY_TARGET_EGL,
+    EPOXY_TARGET_GLX,
+    EPOXY_TARGET_WGL,
+    EPOXY_TARGET_COUNT
+};
+
+/* Values stored in the per-context provider cache, one byte per
+ * provider enum of the generated code.
+ */
+enum epoxy_provider_state {
+    EPOXY_PROVIDER_UNKNOWN = 0,
+    EPOXY_PROVIDER_ABSENT,
+    EPOXY_PROVIDER_PRESENT,
+};
+
+uint8_t *epoxy_context_provider_cache(enum epoxy_dispatch_target target,
+                                      size_t count);
+
+/* The hash used by the perfect hash tables that gen_dispatch.py
+ * generates for looking up names.  This is FNV-1a with the seed mixed
+ * into the offset basis, and has to match name_hash() there.
+ */
+static inline uint32_t
+epoxy_name_hash(const char *name, size_t len, uint32_t seed)
+{
+    uint32_t hash = 2166136261u ^ seed;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+/* IDs of every extension in each registry, as generated into the
+ * dispatch code.  The lookups return -1 for unknown names.
+ */
+extern const int gl_extension_count;
+int gl_extension_lookup(const char *name, size_t len);
+const char *gl_extension_name(int id);
+extern const int egl_extension_count;
+int egl_extension_lookup(const char *name, size_t len);
+const char *egl_extension_name(int id);
+extern const int glx_extension_count;
+int glx_extension_lookup(const char *name, size_t len);
+const char *glx_extension_name(int id);
+extern const int wgl_extension_count;
+int wgl_extension_lookup(const char *name, size_t len);
+const char *wgl_extension_name(int id);
+
+/* The extension sets kept for each GLX display and screen or WGL HDC
+ * that gets asked about, in dispatch_extension_set.c.
+ */
+const struct epoxy_extension_set *epoxy_find_extension_set(const void *key, int index);
+const struct epoxy_extension_set *epoxy_add_extension_set(const void *key, int index,
+                                                          const char *extension_list,
+                                                          bool *new_key);
+void epoxy_forget_extension_sets(const void *key);
+
+/* Eager resolution of the function pointers, as generated into the
+ * dispatch code.  These return how many pointers they filled in, and
+ * the feature lookups return -1 for names they don't know.
+ */
+int gl_resolve_all(void);
+int gl_resolve_feature(const char *feature);
+int egl_resolve_all(void);
+int egl_resolve_feature(const char *feature);
+int glx_resolve_all(void);
+int glx_resolve_feature(const char *feature);
+int wgl_resolve_all(void);
+int wgl_resolve_feature(const char *feature);
+
+void epoxy_eager_resolve(void);
+void epoxy_profile_record(enum epoxy_dispatch_target target, int function);
+
+/* The resolve reports, for the listener set with
+ * epoxy_set_resolve_listener() and EPOXY_DEBUG_RESOLVE.  The resolver
+ * keeps a report on its stack for each function it resolves, which
+ * only gets filled in while something is listening, and the loaders
+ * add what they did to the innermost report of their thread.
+ */
+#define EPOXY_RESOLVE_MAX_LIBRARIES 4
+
+struct epoxy_resolve_report {
+    bool active;
+    bool loading;
+    const char *name;
+    const char *provider;
+    const char *loader;
+    const char *libraries[EPOXY_RESOLVE_MAX_LIBRARIES];
+    int library_count;
+    uint64_t start_ns;
+    uint64_t load_start_ns;
+    uint64_t condition_ns;
+    uint64_t dlopen_ns;
+    struct epoxy_resolve_report *outer;
+};
+
+void epoxy_resolve_report_begin(struct epoxy_resolve_report *report,
+                                const char *name);
+void epoxy_resolve_report_provider(struct epoxy_resolve_report *report,
+                                   const char *provider, const char *loader);
+void epoxy_resolve_report_end(struct epoxy_resolve_report *report,
+                              void *function);
+void epoxy_resolve_report_loader(const char *loader);
+uint64_t epoxy_resolve_report_dlopen_start(void);
+void epoxy_resolve_report_dlopen(const char *library, uint64_t start_ns,
+                                 bool opened);
+void epoxy_resolve_report_init(void);
+void epoxy_resolve_report_fini(void);
+
+/* The statistics and tracing modes.  The instrumented thunks call the
+ * hooks on the way in, which returns a timestamp if the call is to be
+ * timed, and hand it back on the way out along with the arguments.
+ */
+void epoxy_stats_init(void);
+void epoxy_stats_fini(void);
+void epoxy_trace_init(void);
+void epoxy_trace_fini(void);
+#if USING_INSTRUMENTATION
+uint64_t epoxy_instrument_enter(enum epoxy_dispatch_target target, int function);
+void epoxy_instrument_leave(enum epoxy_dispatch_target target, int function,
+                            uint64_t start, unsigned flags, const int64_t *args);
+uint64_t epoxy_instrument_now(void);
+const char *epoxy_instrument_function_name(enum epoxy_dispatch_target target,
+                                           int function);
+bool epoxy_instrument(bool enable);
+
+extern bool epoxy_stats_enabled;
+extern bool epoxy_tracing;
+void epoxy_trace_record(enum epoxy_dispatch_target target, int function,
+                        uint64_t start, uint64_t end, unsigned flags,
+                        const int64_t *args);
+#endif
+
+/* The shadow state, which forgets everything it knows whenever another
+ * context is current or one is made current through epoxy, and the
+ * query cache, which keeps what it knows with each context.
+ */
+void epoxy_shadow_state_init(void);
+void epoxy_shadow_state_reset(void);
+#if USING_SHADOW_STATE
+bool epoxy_shadow_state_filter(enum epoxy_shadow_call call, const uint32_t *args);
+GLboolean epoxy_shadow_state_is_enabled(GLboolean (GLAPIENTRY *is_enabled)(GLenum cap),
+                                        GLenum cap);
+
+const GLubyte *
+epoxy_query_cache_get_string(const GLubyte *(GLAPIENTRY *get_string)(GLenum name),
+                             GLenum name);
+const GLubyte *
+epoxy_query_cache_get_stringi(const GLubyte *(GLAPIENTRY *get_stringi)(GLenum name,
+                                                                       GLuint index),
+                              GLenum name, GLuint index);
+void
+epoxy_query_cache_get_integerv(void (GLAPIENTRY *get_integerv)(GLenum pname,
+                                                               GLint *data),
+                               GLenum pname, GLint *data);
+void **epoxy_current_query_cache(void);
+void epoxy_query_cache_free(void *cache);
+uint64_t epoxy_current_context_id(void);
+#endif
+
+/* The command queue. */
+#if USING_QUEUE
+extern EPOXY_THREAD_LOCAL_FAST bool epoxy_queue_producer;
+void epoxy_queue_call(void (*replay)(void *data), void *data, size_t size,
+                      unsigned flags);
+#endif
+
+/* Swaps the thunks of one interposer in the public pointers of each
+ * target for those of another, or for none, failing if the thunks in
+ * there are neither.
+ */
+#if USING_INTERPOSERS
+bool gl_interpose(enum epoxy_interposer from, enum epoxy_interposer to);
+bool egl_interpose(enum epoxy_interposer from, enum epoxy_interposer to);
+bool glx_interpose(enum epoxy_interposer from, enum epoxy_interposer to);
 #endif
 
-#define GEN_THUNKS(name, args, passthrough)                          \
-    GEN_GLOBAL_REWRITE_PTR(name, args, passthrough)                  \
-    GEN_DISPATCH_TABLE_REWRITE_PTR(name, args, passthrough)          \
-    GEN_DISPATCH_TABLE_THUNK(name, args, passthrough)
+/* Lookups of functions by name, returning -1 for unknown names, and
+ * of the pointers to call them through.  The pointers are NULL if the
+ * function isn't resolved, and can't be or isn't asked to be.
+ *
+ * The resolved and preset functions deal in the pointers behind any
+ * wrappers, with preset only filling in unresolved ones.
+ */
+extern const int gl_function_count;
+int gl_function_lookup(const char *name, size_t len);
+const char *gl_function_name(int function);
+void *gl_get_function(int function, bool resolve);
+void *gl_resolved_function(int function);
+bool gl_preset_function(int function, void *func);
+extern const int egl_function_count;
+int egl_function_lookup(const char *name, size_t len);
+const char *egl_function_name(int function);
+void *egl_get_function(int function, bool resolve);
+void *egl_resolved_function(int function);
+bool egl_preset_function(int function, void *func);
+extern const int glx_function_count;
+int glx_function_lookup(const char *name, size_t len);
+const char *glx_function_name(int function);
+void *glx_get_function(int function, bool resolve);
+void *glx_resolved_function(int function);
+bool glx_preset_function(int function, void *func);
+extern const int wgl_function_count;
+int wgl_function_lookup(const char *name, size_t len);
+const char *wgl_function_name(int function);
+void *wgl_get_function(int function, bool resolve);
+void *wgl_resolved_function(int function);
+bool wgl_preset_function(int function, void *func);
+
+/* Lock-free lookups in the symbol table of the library behind a
+ * dlopen() handle, once dlsym() has found a symbol in it.  The lookups
+ * return NULL for anything that has to be left to dlsym().
+ */
+void *epoxy_elf_dlsym(void *handle, const char *name);
+void epoxy_elf_index_handle(void *handle, const char *name, void *symbol);
+
+#if USING_PUBLIC_POINTER_LOOKUP
+/* Returns where the public pointer to the named function lives, given
+ * epoxy's own definition of it.
+ */
+void **epoxy_public_pointer(const char *name, void **local);
+#endif
 
-#define GEN_THUNKS_RET(ret, name, args, passthrough)                 \
-    GEN_GLOBAL_REWRITE_PTR_RET(ret, name, args, passthrough)         \
-    GEN_DISPATCH_TABLE_REWRITE_PTR_RET(ret, name, args, passthrough) \
-    GEN_DISPATCH_TABLE_THUNK_RET(ret, name, args, passthrough)
+/* The on-disk cache of resolved functions, for EPOXY_RESOLVE_CACHE. */
+void epoxy_resolve_cache_load(const char *path);
+void epoxy_resolve_cache_save(void);
+
+/* Whether the IFUNC resolvers of the GL entrypoints that ENABLE_IFUNC
+ * builds export can resolve functions for the current context.
+ */
+bool epoxy_ifunc_can_resolve(void);
+void epoxy_ifunc_note_bound(void);
+bool epoxy_ifunc_bound(void);
 
 void *epoxy_egl_dlsym(const char *name);
 void *epoxy_glx_dlsym(const char *name);
@@ -169,6 +715,7 @@ void *epoxy_get_bootstrap_proc_address(const char *name);
 
 int epoxy_conservative_gl_version(void);
 bool epoxy_conservative_has_gl_extension(const char *name);
+bool epoxy_conservative_has_gl_extension_id(int id);
 int epoxy_conservative_glx_version(void);
 bool epoxy_conservative_has_glx_extension(const char *name);
 int epoxy_conservative_egl_version(void);
@@ -180,6 +727,43 @@ void *epoxy_conservative_glx_dlsym(const char *name, bool exit_if_fails);
 bool epoxy_load_glx(bool exit_if_fails, bool load);
 bool epoxy_load_egl(bool exit_if_fails, bool load);
 
+/* Called by the MakeCurrent wrappers to record what they made current
+ * on this thread, or with known == false to have the current context
+ * queried from the driver again.
+ */
+void epoxy_set_current_context(epoxy_context_platform_t platform, bool known,
+                               void *display, void *context);
+/* Called by the wrappers of the functions that destroy contexts, or
+ * with context == NULL for all of the display's, so that a context that
+ * later gets the same handle doesn't inherit what was known about it.
+ */
+void epoxy_forget_context_states(epoxy_context_platform_t platform,
+                                 void *display, void *context);
+bool epoxy_current_context(epoxy_context_platform_t platform,
+                           void **display, void **context);
+
+#if PLATFORM_HAS_GLX
+#define glXMakeCurrent_unwrapped epoxy_glXMakeCurrent_unwrapped
+#define glXMakeContextCurrent_unwrapped epoxy_glXMakeContextCurrent_unwrapped
+#define glXDestroyContext_unwrapped epoxy_glXDestroyContext_unwrapped
+extern Bool UNWRAPPED_PROTO(glXMakeCurrent_unwrapped)(Display *dpy, GLXDrawable drawable, GLXContext ctx);
+extern Bool UNWRAPPED_PROTO(glXMakeContextCurrent_unwrapped)(Display *dpy, GLXDrawable draw, GLXDrawable read, GLXContext ctx);
+extern void UNWRAPPED_PROTO(glXDestroyContext_unwrapped)(Display *dpy, GLXContext ctx);
+#endif
+
+#if PLATFORM_HAS_EGL
+#define eglMakeCurrent_unwrapped epoxy_eglMakeCurrent_unwrapped
+#define eglBindAPI_unwrapped epoxy_eglBindAPI_unwrapped
+#define eglReleaseThread_unwrapped epoxy_eglReleaseThread_unwrapped
+#define eglDestroyContext_unwrapped epoxy_eglDestroyContext_unwrapped
+#define eglTerminate_unwrapped epoxy_eglTerminate_unwrapped
+extern EGLBoolean UNWRAPPED_PROTO(eglMakeCurrent_unwrapped)(EGLDisplay dpy, EGLSurface draw, EGLSurface read, EGLContext ctx);
+extern EGLBoolean UNWRAPPED_PROTO(eglBindAPI_unwrapped)(EGLenum api);
+extern EGLBoolean UNWRAPPED_PROTO(eglReleaseThread_unwrapped)(void);
+extern EGLBoolean UNWRAPPED_PROTO(eglDestroyContext_unwrapped)(EGLDisplay dpy, EGLContext ctx);
+extern EGLBoolean UNWRAPPED_PROTO(eglTerminate_unwrapped)(EGLDisplay dpy);
+#endif
+
 #define glBegin_unwrapped epoxy_glBegin_unwrapped
 #define glEnd_unwrapped epoxy_glEnd_unwrapped
 extern void UNWRAPPED_PROTO(glBegin_unwrapped)(GLenum primtype);
@@ -187,7 +771,18 @@ extern void UNWRAPPED_PROTO(glEnd_unwrapped)(void);
 
 extern epoxy_resolver_failure_handler_t epoxy_resolver_failure_handler;
 
-#if USING_DISPATCH_TABLE
+#if USING_DISPATCH_TABLE && !defined(_WIN32)
+void gl_switch_to_dispatch_table(void);
+void gl_reset_function_pointers(void);
+
+/* The current context's GL dispatch table, once the switch to dispatch
+ * tables has been made, cached per thread until the next MakeCurrent.
+ */
+extern EPOXY_THREAD_LOCAL_FAST void *gl_current_dispatch_table;
+void *epoxy_context_dispatch_table(size_t size);
+#endif
+
+#if USING_DISPATCH_TABLE && defined(_WIN32)
 void gl_init_dispatch_table(void);
 void gl_switch_to_dispatch_table(void);
 void wgl_init_dispatch_table(void);
@@ -199,8 +794,10 @@ extern uint32_t wgl_tls_index, wgl_tls_size;
 #define wglMakeContextCurrentARB_unwrapped epoxy_wglMakeContextCurrentARB_unwrapped
 #define wglMakeContextCurrentEXT_unwrapped epoxy_wglMakeContextCurrentEXT_unwrapped
 #define wglMakeAssociatedContextCurrentAMD_unwrapped epoxy_wglMakeAssociatedContextCurrentAMD_unwrapped
+#define wglDeleteContext_unwrapped epoxy_wglDeleteContext_unwrapped
 extern BOOL UNWRAPPED_PROTO(wglMakeCurrent_unwrapped)(HDC hdc, HGLRC hglrc);
 extern BOOL UNWRAPPED_PROTO(wglMakeContextCurrentARB_unwrapped)(HDC hDrawDC, HDC hReadDC, HGLRC hglrc);
 extern BOOL UNWRAPPED_PROTO(wglMakeContextCurrentEXT_unwrapped)(HDC hDrawDC, HDC hReadDC, HGLRC hglrc);
 extern BOOL UNWRAPPED_PROTO(wglMakeAssociatedContextCurrentAMD_unwrapped)(HGLRC hglrc);
+extern BOOL UNWRAPPED_PROTO(wglDeleteContext_unwrapped)(HGLRC hglrc);
 #endif /* _WIN32_ */
@@ -22,15 +22,218 @@
  */
 
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
 #include "dispatch_common.h"
 
+/* What epoxy found out about an initialized display, or about the
+ * client (EGL_NO_DISPLAY), from its version and extension strings.
+ */
+struct egl_display_info {
+    int version;
+    /* The registry's extensions, by egl_extension_lookup() ID. */
+    uint32_t *extensions;
+    /* All of them, for the names that aren't in the registry. */
+    struct epoxy_extension_set *set;
+    struct egl_display_info *next_retired;
+};
+
+struct egl_display_state {
+    EGLDisplay dpy;
+    /* NULL until asked for, and again once the display is terminated. */
+    struct egl_display_info *info;
+    struct egl_display_state *next;
+};
+
+/* Every display that epoxy was asked about, newest first. */
+static struct egl_display_state *egl_displays;
+
+/* The client's extensions don't change over the life of the process. */
+static struct egl_display_info *egl_client_info;
+
+/* The info of terminated displays, which other threads may still be
+ * reading, so it's never freed.
+ */
+static struct egl_display_info *retired_egl_infos;
+
+static void
+free_egl_display_info(struct egl_display_info *info)
+{
+    epoxy_extension_set_destroy(info->set);
+    free(info->extensions);
+    free(info);
+}
+
+/* Queries the strings of a display, returning NULL if it isn't
+ * initialized.  The client only has its extensions asked for, since
+ * asking EGL before 1.5 for its version is an EGL_BAD_DISPLAY error.
+ */
+static struct egl_display_info *
+make_egl_display_info(EGLDisplay dpy)
+{
+    const char *version = NULL;
+    const char *extensions;
+    struct egl_display_info *info;
+    unsigned int iter = 0;
+    const char *name;
+    size_t len;
+
+    if (dpy != EGL_NO_DISPLAY) {
+        version = eglQueryString(dpy, EGL_VERSION);
+        if (!version)
+            return NULL;
+    }
+    extensions = eglQueryString(dpy, EGL_EXTENSIONS);
+
+    info = calloc(1, sizeof(*info));
+    if (!info)
+        return NULL;
+
+    info->extensions = calloc((egl_extension_count + 31) / 32,
+                              sizeof(*info->extensions));
+    info->set = epoxy_extension_set_create(extensions);
+    if (!info->extensions || (extensions && !info->set)) {
+        free_egl_display_info(info);
+        return NULL;
+    }
+
+    if (version) {
+        int major, minor;
+        int ret = sscanf(version, "%d.%d", &major, &minor);
+
+        assert(ret == 2);
+        info->version = major * 10 + minor;
+    }
+
+    while ((name = epoxy_extension_set_next(info->set, &iter, &len))) {
+        int id = egl_extension_lookup(name, len);
+
+        if (id >= 0)
+            info->extensions[id / 32] |= 1u << (id % 32);
+    }
+
+    return info;
+}
+
+static struct egl_display_state *
+find_egl_display_state(EGLDisplay dpy, bool create)
+{
+    struct egl_display_state *head, *state, *other;
+
+    head = epoxy_atomic_load_ptr(&egl_displays);
+    for (state = head; state; state = state->next) {
+        if (state->dpy == dpy)
+            return state;
+    }
+
+    if (!create)
+        return NULL;
+
+    state = calloc(1, sizeof(*state));
+    if (!state)
+        return NULL;
+    state->dpy = dpy;
+
+    while (true) {
+        state->next = head;
+        if (epoxy_atomic_cas_ptr(&egl_displays, head, state))
+            return state;
+
+        /* Someone else added displays; make sure they didn't just add
+         * this same one.
+         */
+        head = epoxy_atomic_load_ptr(&egl_displays);
+        for (other = head; other != state->next; other = other->next) {
+            if (other->dpy == dpy) {
+                free(state);
+                return other;
+            }
+        }
+    }
+}
+
+/* Returns what's known about a display, or the client, asking the
+ * driver the first time, or NULL if the display isn't initialized.
+ */
+static struct egl_display_info *
+get_egl_display_info(EGLDisplay dpy)
+{
+    struct egl_display_info **slot = &egl_client_info;
+    struct egl_display_info *info;
+
+    if (dpy != EGL_NO_DISPLAY) {
+        struct egl_display_state *state = find_egl_display_state(dpy, true);
+
+        if (!state)
+            return NULL;
+        slot = &state->info;
+    }
+
+    info = epoxy_atomic_load_ptr(slot);
+    if (info)
+        return info;
+
+    info = make_egl_display_info(dpy);
+    if (info && !epoxy_atomic_cas_ptr(slot, NULL, info)) {
+        free_egl_display_info(info);
+        info = epoxy_atomic_load_ptr(slot);
+    }
+
+    return info;
+}
+
+static bool
+egl_display_info_has(const struct egl_display_info *info, const char *ext)
+{
+    int id = egl_extension_lookup(ext, strlen(ext));
+
+    if (id >= 0)
+        return info->extensions[id / 32] & (1u << (id % 32));
+
+    return epoxy_extension_set_has(info->set, ext);
+}
+
+/* Drops what's known about a display that got terminated, since it may
+ * get initialized again with another driver.
+ */
+static void
+forget_egl_display(EGLDisplay dpy)
+{
+    struct egl_display_state *state = find_egl_display_state(dpy, false);
+    struct egl_display_info *info;
+
+    if (!state)
+        return;
+
+    info = epoxy_atomic_exchange_ptr(&state->info, NULL);
+    if (!info)
+        return;
+
+    do {
+        info->next_retired = epoxy_atomic_load_ptr(&retired_egl_infos);
+    } while (!epoxy_atomic_cas_ptr(&retired_egl_infos, info->next_retired, info));
+}
+
+/* Returns the display of the current EGL context, asking the driver
+ * only if epoxy can't tell.
+ */
+static EGLDisplay
+epoxy_current_egl_display(void)
+{
+    void *dpy, *ctx;
+
+    if (epoxy_current_context(EPOXY_CONTEXT_PLATFORM_EGL, &dpy, &ctx))
+        return dpy;
+
+    return eglGetCurrentDisplay();
+}
+
 int
 epoxy_conservative_egl_version(void)
 {
-    EGLDisplay dpy = eglGetCurrentDisplay();
+    EGLDisplay dpy = epoxy_current_egl_display();
 
     if (!dpy)
         return 14;
@@ -60,23 +263,15 @@ epoxy_conservative_egl_version(void)
 int
 epoxy_egl_version(EGLDisplay dpy)
 {
-    int major, minor;
-    const char *version_string;
-    int ret;
-
-    version_string = eglQueryString(dpy, EGL_VERSION);
-    if (!version_string)
-        return 0;
+    struct egl_display_info *info = get_egl_display_info(dpy);
 
-    ret = sscanf(version_string, "%d.%d", &major, &minor);
-    assert(ret == 2);
-    return major * 10 + minor;
+    return info ? info->version : 0;
 }
 
 bool
 epoxy_conservative_has_egl_extension(const char *ext)
 {
-    return epoxy_has_egl_extension(eglGetCurrentDisplay(), ext);
+    return epoxy_has_egl_extension(epoxy_current_egl_display(), ext);
 }
 
 /**
@@ -87,13 +282,29 @@ epoxy_conservative_has_egl_extension(const char *ext)
  *
  * @return `true` if the extension is available
  *
+ * The display's extensions are only asked for the first time, and
+ * again once it's been terminated through epoxy, while the client's
+ * (which every display has) are only asked for once.
+ *
  * @see epoxy_has_gl_extension()
  * @see epoxy_has_glx_extension()
  */
 bool
 epoxy_has_egl_extension(EGLDisplay dpy, const char *ext)
 {
-    return epoxy_extension_in_string(eglQueryString(dpy, EGL_EXTENSIONS), ext) || epoxy_extension_in_string(eglQueryString(NULL, EGL_EXTENSIONS), ext);
+    struct egl_display_info *info;
+
+    if (!ext)
+        return false;
+
+    if (dpy != EGL_NO_DISPLAY) {
+        info = get_egl_display_info(dpy);
+        if (info && egl_display_info_has(info, ext))
+            return true;
+    }
+
+    info = get_egl_display_info(EGL_NO_DISPLAY);
+    return info && egl_display_info_has(info, ext);
 }
 
 /**
@@ -120,3 +331,81 @@ epoxy_has_egl(void)
     return false;
 #endif /* PLATFORM_HAS_EGL */
 }
+
+/**
+ * @brief Tells epoxy that eglMakeCurrent(), eglBindAPI() or
+ * eglReleaseThread() was called on this thread without going through
+ * epoxy.
+ *
+ * Epoxy keeps track of the EGL context that its own MakeCurrent calls
+ * made current, rather than asking the driver every time it needs to
+ * know.  Code that mixes those with calls straight to libEGL on the
+ * same thread needs to call this afterwards.
+ */
+void
+epoxy_handle_external_eglMakeCurrent(void)
+{
+    epoxy_set_current_context(EPOXY_CONTEXT_PLATFORM_EGL, false, NULL, NULL);
+}
+
+WRAPPER_VISIBILITY (EGLBoolean)
+WRAPPER(epoxy_eglMakeCurrent)(EGLDisplay dpy, EGLSurface draw,
+                              EGLSurface read, EGLContext ctx)
+{
+    EGLBoolean ret = epoxy_eglMakeCurrent_unwrapped(dpy, draw, read, ctx);
+
+    epoxy_set_current_context(EPOXY_CONTEXT_PLATFORM_EGL, ret, dpy, ctx);
+
+    return ret;
+}
+
+/* The current context is per client API, so switching the API can
+ * change it.
+ */
+WRAPPER_VISIBILITY (EGLBoolean)
+WRAPPER(epoxy_eglBindAPI)(EGLenum api)
+{
+    EGLBoolean ret = epoxy_eglBindAPI_unwrapped(api);
+
+    epoxy_handle_external_eglMakeCurrent();
+
+    return ret;
+}
+
+WRAPPER_VISIBILITY (EGLBoolean)
+WRAPPER(epoxy_eglReleaseThread)(void)
+{
+    EGLBoolean ret = epoxy_eglReleaseThread_unwrapped();
+
+    epoxy_handle_external_eglMakeCurrent();
+
+    return ret;
+}
+
+WRAPPER_VISIBILITY (EGLBoolean)
+WRAPPER(epoxy_eglDestroyContext)(EGLDisplay dpy, EGLContext ctx)
+{
+    EGLBoolean ret = epoxy_eglDestroyContext_unwrapped(dpy, ctx);
+
+    if (ret)
+        epoxy_forget_context_states(EPOXY_CONTEXT_PLATFORM_EGL, dpy, ctx);
+
+    return ret;
+}
+
+WRAPPER_VISIBILITY (EGLBoolean)
+WRAPPER(epoxy_eglTerminate)(EGLDisplay dpy)
+{
+    EGLBoolean ret = epoxy_eglTerminate_unwrapped(dpy);
+
+    forget_egl_display(dpy);
+    epoxy_forget_context_states(EPOXY_CONTEXT_PLATFORM_EGL, dpy, NULL);
+
+    return ret;
+}
+
+PFNEGLMAKECURRENTPROC epoxy_eglMakeCurrent = epoxy_eglMakeCurrent_wrapped;
+PFNEGLBINDAPIPROC epoxy_eglBindAPI = epoxy_eglBindAPI_wrapped;
+PFNEGLRELEASETHREADPROC epoxy_eglReleaseThread = epoxy_eglReleaseThread_wrapped;
+PFNEGLDESTROYCONTEXTPROC epoxy_eglDestroyContext = epoxy_eglDestroyContext_wrapped;
+PFNEGLTERMINATEPROC epoxy_eglTerminate = epoxy_eglTerminate_wrapped;
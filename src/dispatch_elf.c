@@ -0,0 +1,409 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * @file dispatch_elf.c
+ *
+ * Implements looking up the symbols of the GL libraries that epoxy
+ * dlopen()s straight from their GNU hash tables.
+ *
+ * Every dlsym() call takes the dynamic linker's lock and walks the
+ * hash chains of every library in the handle's scope, which adds up
+ * when resolving hundreds of functions at once.  The libraries export
+ * all of their functions themselves, though, so once dlsym() has told
+ * us which library a handle's symbols come from, the rest can be
+ * found in that library's own table without taking any lock.
+ *
+ * Anything that isn't a plain function or data symbol defined in that
+ * library (missing names, IFUNCs, non-default versions) is left to
+ * dlsym(), and so is everything if dlsym() has been interposed by a
+ * tracing tool or a test harness, since it may be redirecting lookups
+ * on purpose.
+ */
+
+#define _GNU_SOURCE
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dispatch_common.h"
+
+#ifdef __ELF__
+
+#include <dlfcn.h>
+#include <link.h>
+
+/* The dynamic symbols of the library that a dlopen() handle's lookups
+ * are answered from.  Entries are never freed, so that lookups can
+ * walk the list without taking a lock.
+ */
+struct elf_symbols {
+    struct elf_symbols *next;
+    void *handle;
+
+    /* False if lookups have to go through dlsym(). */
+    bool usable;
+
+    uintptr_t base;
+    uint32_t nbuckets;
+    uint32_t symoffset;
+    uint32_t bloom_size;
+    uint32_t bloom_shift;
+    const ElfW(Addr) *bloom;
+    const uint32_t *buckets;
+    const uint32_t *chain;
+    const ElfW(Sym) *symtab;
+    const char *strtab;
+    const ElfW(Half) *versym;
+};
+
+static struct elf_symbols *handle_symbols;
+
+static struct elf_symbols *
+find_handle_symbols(void *handle)
+{
+    struct elf_symbols *symbols;
+
+    for (symbols = epoxy_atomic_load_ptr(&handle_symbols);
+         symbols;
+         symbols = symbols->next) {
+        if (symbols->handle == handle)
+            return symbols;
+    }
+
+    return NULL;
+}
+
+static uint32_t
+gnu_hash(const char *name)
+{
+    uint32_t h = 5381;
+
+    for (; *name; name++)
+        h = (h << 5) + h + (unsigned char)*name;
+
+    return h;
+}
+
+static void *
+lookup_symbol(const struct elf_symbols *symbols, const char *name)
+{
+    const unsigned bits = sizeof(ElfW(Addr)) * 8;
+    uint32_t h = gnu_hash(name);
+    ElfW(Addr) word = symbols->bloom[(h / bits) & (symbols->bloom_size - 1)];
+    ElfW(Addr) mask = ((ElfW(Addr))1 << (h % bits)) |
+        ((ElfW(Addr))1 << ((h >> symbols->bloom_shift) % bits));
+    uint32_t i;
+
+    if ((word & mask) != mask)
+        return NULL;
+
+    i = symbols->buckets[h % symbols->nbuckets];
+    if (i < symbols->symoffset)
+        return NULL;
+
+    for (;; i++) {
+        const ElfW(Sym) *sym = &symbols->symtab[i];
+        uint32_t chain_hash = symbols->chain[i - symbols->symoffset];
+
+        if ((chain_hash | 1) == (h | 1) &&
+            strcmp(symbols->strtab + sym->st_name, name) == 0) {
+            int type = ELF64_ST_TYPE(sym->st_info);
+
+            if (sym->st_shndx == SHN_UNDEF || sym->st_value == 0)
+                return NULL;
+            if (type != STT_FUNC && type != STT_OBJECT && type != STT_NOTYPE)
+                return NULL;
+            /* Hidden, or local, versions aren't what dlsym() finds. */
+            if (symbols->versym && (symbols->versym[i] & 0x8000 ||
+                                    symbols->versym[i] == 0))
+                return NULL;
+
+            return (void *)(symbols->base + sym->st_value);
+        }
+
+        if (chain_hash & 1)
+            return NULL;
+    }
+}
+
+struct find_object {
+    uintptr_t addr;
+    struct elf_symbols *symbols;
+    bool found;
+};
+
+static bool
+read_dynamic(struct dl_phdr_info *info, const ElfW(Dyn) *dyn,
+             struct elf_symbols *symbols)
+{
+    const uint32_t *hash = NULL;
+
+    symbols->base = info->dlpi_addr;
+
+    for (; dyn->d_tag != DT_NULL; dyn++) {
+        /* Depending on the platform, the dynamic linker may or may
+         * not have already relocated these.
+         */
+        uintptr_t ptr = dyn->d_un.d_ptr;
+
+        if (ptr < symbols->base)
+            ptr += symbols->base;
+
+        switch (dyn->d_tag) {
+        case DT_GNU_HASH:
+            hash = (const uint32_t *)ptr;
+            break;
+        case DT_SYMTAB:
+            symbols->symtab = (const ElfW(Sym) *)ptr;
+            break;
+        case DT_STRTAB:
+            symbols->strtab = (const char *)ptr;
+            break;
+        case DT_VERSYM:
+            symbols->versym = (const ElfW(Half) *)ptr;
+            break;
+        }
+    }
+
+    if (!hash || !symbols->symtab || !symbols->strtab)
+        return false;
+
+    symbols->nbuckets = hash[0];
+    symbols->symoffset = hash[1];
+    symbols->bloom_size = hash[2];
+    symbols->bloom_shift = hash[3];
+    symbols->bloom = (const ElfW(Addr) *)(hash + 4);
+    symbols->buckets = (const uint32_t *)(symbols->bloom + symbols->bloom_size);
+    symbols->chain = symbols->buckets + symbols->nbuckets;
+
+    /* The bloom filter lookup relies on its size being a power of
+     * two, as the linkers make it.
+     */
+    return symbols->nbuckets != 0 && symbols->bloom_size != 0 &&
+        (symbols->bloom_size & (symbols->bloom_size - 1)) == 0;
+}
+
+/* Returns whether the object contains the address, and finds its
+ * dynamic section.
+ */
+static bool
+object_contains(struct dl_phdr_info *info, uintptr_t addr,
+                const ElfW(Dyn) **dyn)
+{
+    bool contains = false;
+    int i;
+
+    *dyn = NULL;
+    for (i = 0; i < info->dlpi_phnum; i++) {
+        const ElfW(Phdr) *phdr = &info->dlpi_phdr[i];
+        uintptr_t start = info->dlpi_addr + phdr->p_vaddr;
+
+        if (phdr->p_type == PT_LOAD &&
+            addr >= start && addr < start + phdr->p_memsz)
+            contains = true;
+        else if (phdr->p_type == PT_DYNAMIC)
+            *dyn = (const ElfW(Dyn) *)start;
+    }
+
+    return contains;
+}
+
+static int
+find_object(struct dl_phdr_info *info, size_t size, void *data)
+{
+    struct find_object *find = data;
+    const ElfW(Dyn) *dyn;
+
+    (void)size;
+
+    if (!object_contains(info, find->addr, &dyn))
+        return 0;
+
+    find->found = dyn && read_dynamic(info, dyn, find->symbols);
+    return 1;
+}
+
+static bool
+dlsym_is_interposed(void)
+{
+    Dl_info info;
+    const char *name;
+
+    if (!dladdr((void *)dlsym, &info) || !info.dli_fname)
+        return true;
+
+    name = strrchr(info.dli_fname, '/');
+    name = name ? name + 1 : info.dli_fname;
+
+    return strncmp(name, "libc.", 5) != 0 &&
+        strncmp(name, "libc-", 5) != 0 &&
+        strncmp(name, "libdl.", 6) != 0 &&
+        strncmp(name, "ld-", 3) != 0;
+}
+
+void *
+epoxy_elf_dlsym(void *handle, const char *name)
+{
+    struct elf_symbols *symbols = find_handle_symbols(handle);
+
+    if (!symbols || !symbols->usable)
+        return NULL;
+
+    return lookup_symbol(symbols, name);
+}
+
+void
+epoxy_elf_index_handle(void *handle, const char *name, void *symbol)
+{
+    struct elf_symbols *symbols;
+    struct find_object find;
+
+    if (find_handle_symbols(handle))
+        return;
+
+    symbols = calloc(1, sizeof(*symbols));
+    if (!symbols)
+        return;
+    symbols->handle = handle;
+
+    if (!dlsym_is_interposed()) {
+        find.addr = (uintptr_t)symbol;
+        find.symbols = symbols;
+        find.found = false;
+        dl_iterate_phdr(find_object, &find);
+
+        /* If the symbol didn't come from the library's own table
+         * (say, it was in one of its dependencies), the table can't
+         * answer for the handle.
+         */
+        symbols->usable = find.found && lookup_symbol(symbols, name) == symbol;
+    }
+
+    /* If another thread indexes the handle at the same time, there'll
+     * be two equivalent entries for it, which is harmless.
+     */
+    do {
+        symbols->next = epoxy_atomic_load_ptr(&handle_symbols);
+    } while (!epoxy_atomic_cas_ptr(&handle_symbols, symbols->next, symbols));
+}
+
+#if USING_PUBLIC_POINTER_LOOKUP
+/* What the executable, which is always the first object, has to do
+ * with epoxy's public pointers.
+ */
+enum executable_state {
+    EXECUTABLE_UNKNOWN,
+    /* Epoxy was linked into it, so the pointers are all its own,
+     * whatever other copies of epoxy the process might have loaded.
+     */
+    EXECUTABLE_CONTAINS_EPOXY,
+    /* Any copies of the pointers it made are in executable_symbols. */
+    EXECUTABLE_INDEXED,
+    /* Its symbols have to be found with dlsym(). */
+    EXECUTABLE_UNINDEXED,
+};
+
+static long executable_state;
+static struct elf_symbols executable_symbols;
+
+static int
+index_executable(struct dl_phdr_info *info, size_t size, void *data)
+{
+    struct find_object *find = data;
+    const ElfW(Dyn) *dyn;
+
+    (void)size;
+
+    if (object_contains(info, find->addr, &dyn))
+        find->found = false;
+    else
+        find->found = dyn && read_dynamic(info, dyn, find->symbols);
+    return 1;
+}
+
+void **
+epoxy_public_pointer(const char *name, void **local)
+{
+    long state = epoxy_atomic_load_long(&executable_state);
+    char symbol[256];
+    void **ptr;
+
+    if (state == EXECUTABLE_UNKNOWN) {
+        struct find_object find;
+        Dl_info info;
+        struct link_map *map;
+
+        /* Threads racing here all come to the same conclusion. */
+        if (!dladdr1(local, &info, (void **)&map, RTLD_DL_LINKMAP) ||
+            !map->l_prev) {
+            state = EXECUTABLE_CONTAINS_EPOXY;
+        } else {
+            find.addr = (uintptr_t)local;
+            find.symbols = &executable_symbols;
+            find.found = false;
+            dl_iterate_phdr(index_executable, &find);
+            state = find.found ? EXECUTABLE_INDEXED : EXECUTABLE_UNINDEXED;
+        }
+        epoxy_atomic_cas_long(&executable_state, EXECUTABLE_UNKNOWN, state);
+        state = epoxy_atomic_load_long(&executable_state);
+    }
+
+    if (state == EXECUTABLE_CONTAINS_EPOXY)
+        return local;
+
+    if (snprintf(symbol, sizeof(symbol), "epoxy_%s", name) >= (int)sizeof(symbol))
+        return local;
+
+    /* Only the executable gets copies of the pointers (through copy
+     * relocations), and calls go through its copy if it has one.
+     */
+    if (state == EXECUTABLE_INDEXED)
+        ptr = lookup_symbol(&executable_symbols, symbol);
+    else
+        ptr = dlsym(RTLD_DEFAULT, symbol);
+    return ptr ? ptr : local;
+}
+#endif
+
+#else /* !__ELF__ */
+
+void *
+epoxy_elf_dlsym(void *handle, const char *name)
+{
+    (void)handle;
+    (void)name;
+    return NULL;
+}
+
+void
+epoxy_elf_index_handle(void *handle, const char *name, void *symbol)
+{
+    (void)handle;
+    (void)name;
+    (void)symbol;
+}
+
+#endif /* !__ELF__ */
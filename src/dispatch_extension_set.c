@@ -0,0 +1,546 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * @file dispatch_extension_set.c
+ *
+ * Implements extension sets, which split a list of extensions up once
+ * so that checking for one doesn't have to search the whole list.
+ *
+ * The list gets copied and scanned for spaces 64 bytes at a time, with
+ * SSE2, AVX2 or NEON where the CPU has them, and the names found in it
+ * go into an open addressing hash table of their offsets in the copy.
+ * The GLX and WGL has_*_extension() helpers keep a set for each display
+ * they get asked about, until it's forgotten.
+ */
+
+#include "config.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dispatch_common.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define EXTENSION_SET_SSE2 1
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define EXTENSION_SET_AVX2 1
+#endif
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define EXTENSION_SET_NEON 1
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/* How many bytes get scanned for spaces at a time. */
+#define CHUNK_SIZE 64
+
+/* Past this many sets in use, the has_*_extension() helpers give up on
+ * keeping one for each new display, and search the list instead.
+ */
+#define MAX_CACHED_SETS 32
+
+struct extension_name {
+    uint32_t offset;
+    uint32_t len;
+};
+
+struct extension_slot {
+    uint32_t hash;
+    /* The index of the name plus one, or 0 for an empty slot. */
+    uint32_t name;
+};
+
+struct epoxy_extension_set {
+    /* The copy of the list, which the names point into. */
+    char *list;
+    size_t length;
+    struct extension_name *names;
+    uint32_t count;
+    /* Not counting the names that the list has more than once. */
+    uint32_t distinct;
+    uint32_t mask;
+    struct extension_slot *slots;
+};
+
+struct cached_extension_set {
+    const void *key;
+    int index;
+    long retired;
+    struct epoxy_extension_set *set;
+    struct cached_extension_set *next;
+};
+
+static struct cached_extension_set *cached_sets;
+
+/* Returns a bit for each of the 64 bytes at p that's a space. */
+typedef uint64_t (*space_scanner)(const char *p);
+
+#if !EXTENSION_SET_SSE2 && !EXTENSION_SET_NEON
+static uint64_t
+scan_spaces_scalar(const char *p)
+{
+    uint64_t spaces = 0;
+    int i;
+
+    for (i = 0; i < CHUNK_SIZE; i++)
+        spaces |= (uint64_t)(p[i] == ' ') << i;
+
+    return spaces;
+}
+#endif
+
+#if EXTENSION_SET_SSE2
+static uint64_t
+scan_spaces_sse2(const char *p)
+{
+    const __m128i space = _mm_set1_epi8(' ');
+    uint64_t spaces = 0;
+    int i;
+
+    for (i = 0; i < CHUNK_SIZE / 16; i++) {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)(p + 16 * i));
+        uint32_t bits = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, space));
+
+        spaces |= (uint64_t)bits << (16 * i);
+    }
+
+    return spaces;
+}
+#endif
+
+#if EXTENSION_SET_AVX2
+__attribute__((target("avx2")))
+static uint64_t
+scan_spaces_avx2(const char *p)
+{
+    const __m256i space = _mm256_set1_epi8(' ');
+    __m256i low = _mm256_loadu_si256((const __m256i *)p);
+    __m256i high = _mm256_loadu_si256((const __m256i *)(p + 32));
+    uint32_t low_bits = _mm256_movemask_epi8(_mm256_cmpeq_epi8(low, space));
+    uint32_t high_bits = _mm256_movemask_epi8(_mm256_cmpeq_epi8(high, space));
+
+    return (uint64_t)high_bits << 32 | low_bits;
+}
+#endif
+
+#if EXTENSION_SET_NEON
+static uint64_t
+scan_spaces_neon(const char *p)
+{
+    static const uint8_t bit_values[16] = {
+        1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128,
+    };
+    const uint8x16_t space = vdupq_n_u8(' ');
+    const uint8x16_t bits = vld1q_u8(bit_values);
+    uint8x16_t chunk[4];
+    uint8x16_t sum;
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        uint8x16_t bytes = vld1q_u8((const uint8_t *)p + 16 * i);
+
+        chunk[i] = vandq_u8(vceqq_u8(bytes, space), bits);
+    }
+
+    /* Adding up neighbouring bytes three times leaves a byte of bits
+     * for each 8 bytes, in order.
+     */
+    sum = vpaddq_u8(vpaddq_u8(chunk[0], chunk[1]), vpaddq_u8(chunk[2], chunk[3]));
+    sum = vpaddq_u8(sum, sum);
+
+    return vgetq_lane_u64(vreinterpretq_u64_u8(sum), 0);
+}
+#endif
+
+static space_scanner
+choose_space_scanner(void)
+{
+#if EXTENSION_SET_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return scan_spaces_avx2;
+#endif
+#if EXTENSION_SET_SSE2
+    return scan_spaces_sse2;
+#elif EXTENSION_SET_NEON
+    return scan_spaces_neon;
+#else
+    return scan_spaces_scalar;
+#endif
+}
+
+static int
+lowest_bit(uint64_t bits)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+
+    _BitScanForward64(&index, bits);
+    return index;
+#else
+    return __builtin_ctzll(bits);
+#endif
+}
+
+static const struct extension_slot *
+find_slot(const struct epoxy_extension_set *set, const char *name, size_t len,
+          uint32_t hash)
+{
+    uint32_t i = hash & set->mask;
+
+    while (set->slots[i].name) {
+        const struct extension_name *found = &set->names[set->slots[i].name - 1];
+
+        if (set->slots[i].hash == hash && found->len == len &&
+            memcmp(set->list + found->offset, name, len) == 0)
+            return &set->slots[i];
+        i = (i + 1) & set->mask;
+    }
+
+    return &set->slots[i];
+}
+
+static bool
+add_name(struct epoxy_extension_set *set, uint32_t *capacity,
+         size_t offset, size_t len)
+{
+    if (set->count == *capacity) {
+        struct extension_name *names;
+
+        names = realloc(set->names, 2 * *capacity * sizeof(*names));
+        if (!names)
+            return false;
+        set->names = names;
+        *capacity *= 2;
+    }
+
+    set->names[set->count].offset = offset;
+    set->names[set->count].len = len;
+    set->count++;
+    return true;
+}
+
+/* Finds the names in the copy of the list, which is padded with spaces
+ * to a whole number of chunks.
+ */
+static bool
+split_list(struct epoxy_extension_set *set, size_t padded_length)
+{
+    space_scanner scan_spaces = choose_space_scanner();
+    uint32_t capacity = 64;
+    bool in_name = false;
+    size_t start = 0;
+    size_t chunk;
+
+    set->names = malloc(capacity * sizeof(*set->names));
+    if (!set->names)
+        return false;
+
+    for (chunk = 0; chunk < padded_length; chunk += CHUNK_SIZE) {
+        uint64_t spaces = scan_spaces(set->list + chunk);
+        uint64_t edges = in_name ? spaces : ~spaces;
+
+        /* Each edge is where a name starts or ends. */
+        while (edges) {
+            int bit = lowest_bit(edges);
+
+            if (in_name) {
+                if (!add_name(set, &capacity, start, chunk + bit - start))
+                    return false;
+            } else {
+                start = chunk + bit;
+            }
+
+            in_name = !in_name;
+            edges = (in_name ? spaces : ~spaces) & (~(uint64_t)0 << bit);
+        }
+    }
+
+    return true;
+}
+
+static bool
+build_table(struct epoxy_extension_set *set)
+{
+    uint32_t size = 16;
+    uint32_t i;
+
+    while (size < 2 * set->count)
+        size *= 2;
+
+    set->slots = calloc(size, sizeof(*set->slots));
+    if (!set->slots)
+        return false;
+    set->mask = size - 1;
+
+    for (i = 0; i < set->count; i++) {
+        const struct extension_name *name = &set->names[i];
+        uint32_t hash = epoxy_name_hash(set->list + name->offset, name->len, 0);
+        struct extension_slot *slot;
+
+        slot = (struct extension_slot *)find_slot(set, set->list + name->offset,
+                                                  name->len, hash);
+        /* Lists sometimes have the same name twice. */
+        if (slot->name)
+            continue;
+
+        slot->hash = hash;
+        slot->name = i + 1;
+        set->distinct++;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Splits up a list of extensions, for checking for many of them.
+ *
+ * @param extension_list A list of extension names separated by spaces,
+ * like the ones glGetString(GL_EXTENSIONS) or eglQueryString() return,
+ * which gets copied.
+ *
+ * @return The set of the names in the list, to be freed with
+ * epoxy_extension_set_destroy(), or NULL if extension_list is NULL or
+ * memory ran out.
+ *
+ * Checking for an extension in the set takes about as long however
+ * long the list is, unlike epoxy_extension_in_string().
+ *
+ * @see epoxy_extension_set_has()
+ * @see epoxy_extension_set_next()
+ */
+struct epoxy_extension_set *
+epoxy_extension_set_create(const char *extension_list)
+{
+    struct epoxy_extension_set *set;
+    size_t padded_length;
+
+    if (!extension_list)
+        return NULL;
+
+    set = calloc(1, sizeof(*set));
+    if (!set)
+        return NULL;
+
+    /* With at least one space after the list, so that it ends a name. */
+    set->length = strlen(extension_list);
+    padded_length = (set->length + CHUNK_SIZE) & ~(size_t)(CHUNK_SIZE - 1);
+    set->list = malloc(padded_length);
+    if (!set->list || set->length > UINT32_MAX) {
+        epoxy_extension_set_destroy(set);
+        return NULL;
+    }
+    memcpy(set->list, extension_list, set->length);
+    memset(set->list + set->length, ' ', padded_length - set->length);
+
+    if (!split_list(set, padded_length) || !build_table(set)) {
+        epoxy_extension_set_destroy(set);
+        return NULL;
+    }
+
+    set->list[set->length] = '\0';
+    return set;
+}
+
+/**
+ * @brief Frees a set made by epoxy_extension_set_create().
+ *
+ * @param set The set, which may be NULL.
+ */
+void
+epoxy_extension_set_destroy(struct epoxy_extension_set *set)
+{
+    if (!set)
+        return;
+
+    free(set->slots);
+    free(set->names);
+    free(set->list);
+    free(set);
+}
+
+/**
+ * @brief Checks for an extension in a set.
+ *
+ * @param set The set made from the list of extensions, or NULL.
+ * @param ext The name of the extension.
+ *
+ * @return `true` if the name is one of the names in the list.
+ */
+bool
+epoxy_extension_set_has(const struct epoxy_extension_set *set, const char *ext)
+{
+    size_t len;
+
+    if (!set || !ext)
+        return false;
+
+    len = strlen(ext);
+    return find_slot(set, ext, len, epoxy_name_hash(ext, len, 0))->name != 0;
+}
+
+/**
+ * @brief Returns how many different extensions are in a set.
+ *
+ * @param set The set, or NULL.
+ */
+unsigned int
+epoxy_extension_set_count(const struct epoxy_extension_set *set)
+{
+    return set ? set->distinct : 0;
+}
+
+/**
+ * @brief Goes through the names in a set, in the order of the list.
+ *
+ * @param set The set, or NULL.
+ * @param iter Where the iteration is at, which starts out as 0.
+ * @param len Set to the length of the name.
+ *
+ * @return The next name, which points into the set's copy of the list
+ * and so isn't terminated, or NULL once there are no more.  Names that
+ * the list has more than once come up more than once.
+ */
+const char *
+epoxy_extension_set_next(const struct epoxy_extension_set *set,
+                         unsigned int *iter, size_t *len)
+{
+    const struct extension_name *name;
+
+    if (!set || *iter >= set->count)
+        return NULL;
+
+    name = &set->names[(*iter)++];
+    *len = name->len;
+    return set->list + name->offset;
+}
+
+/**
+ * Returns the set kept for a display, like a GLX display and screen or
+ * a WGL HDC, or NULL if there isn't one yet.
+ */
+const struct epoxy_extension_set *
+epoxy_find_extension_set(const void *key, int index)
+{
+    struct cached_extension_set *cached;
+
+    for (cached = epoxy_atomic_load_ptr(&cached_sets); cached; cached = cached->next) {
+        if (cached->key == key && cached->index == index &&
+            !epoxy_atomic_load_long(&cached->retired))
+            return cached->set;
+    }
+
+    return NULL;
+}
+
+/**
+ * Keeps a set of the extension list that the driver returned for a
+ * display, and returns it, or NULL if it couldn't, in which case the
+ * list has to be searched.  new_key gets set if nothing else was kept
+ * for key, so that the caller can arrange for it to be forgotten.
+ *
+ * A set that got forgotten, but was made from the same list for the
+ * same display, gets used again rather than kept twice, so that
+ * forgetting them over and over doesn't grow the list.
+ */
+const struct epoxy_extension_set *
+epoxy_add_extension_set(const void *key, int index, const char *extension_list,
+                        bool *new_key)
+{
+    struct cached_extension_set *head, *cached, *forgotten = NULL;
+    int count = 0;
+
+    *new_key = true;
+    if (!extension_list)
+        return NULL;
+
+    head = epoxy_atomic_load_ptr(&cached_sets);
+    for (cached = head; cached; cached = cached->next) {
+        if (epoxy_atomic_load_long(&cached->retired)) {
+            if (!forgotten && cached->key == key && cached->index == index &&
+                strcmp(cached->set->list, extension_list) == 0)
+                forgotten = cached;
+            continue;
+        }
+        if (cached->key == key)
+            *new_key = false;
+        count++;
+    }
+
+    if (count >= MAX_CACHED_SETS)
+        return NULL;
+
+    if (forgotten) {
+        epoxy_atomic_cas_long(&forgotten->retired, 1, 0);
+        return forgotten->set;
+    }
+
+    cached = calloc(1, sizeof(*cached));
+    if (!cached)
+        return NULL;
+    cached->key = key;
+    cached->index = index;
+    cached->set = epoxy_extension_set_create(extension_list);
+    if (!cached->set) {
+        free(cached);
+        return NULL;
+    }
+
+    /* Another thread may add a set for the same display meanwhile,
+     * which just goes unused.
+     */
+    while (true) {
+        cached->next = head;
+        if (epoxy_atomic_cas_ptr(&cached_sets, head, cached))
+            break;
+        head = epoxy_atomic_load_ptr(&cached_sets);
+    }
+
+    return cached->set;
+}
+
+/**
+ * Stops using the sets kept for a display, or for all of them if key is
+ * NULL, since another one may get its handle.  Other threads may still
+ * be reading them, so they're never freed.
+ */
+void
+epoxy_forget_extension_sets(const void *key)
+{
+    struct cached_extension_set *cached;
+
+    for (cached = epoxy_atomic_load_ptr(&cached_sets); cached; cached = cached->next) {
+        if (!key || cached->key == key)
+            epoxy_atomic_cas_long(&cached->retired, 0, 1);
+    }
+}
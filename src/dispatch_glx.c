@@ -21,7 +21,9 @@
  * IN THE SOFTWARE.
  */
 
+#define _GNU_SOURCE
 #include <assert.h>
+#include <dlfcn.h>
 #include <string.h>
 #include <stdio.h>
 
@@ -35,11 +37,10 @@
 int
 epoxy_conservative_glx_version(void)
 {
-    Display *dpy = glXGetCurrentDisplay();
-    GLXContext ctx = glXGetCurrentContext();
+    void *dpy, *ctx;
     int screen;
 
-    if (!dpy || !ctx)
+    if (!epoxy_current_context(EPOXY_CONTEXT_PLATFORM_GLX, &dpy, &ctx) || !dpy)
         return 14;
 
     glXQueryContext(dpy, ctx, GLX_SCREEN, &screen);
@@ -107,11 +108,10 @@ epoxy_glx_version(Display *dpy, int screen)
 bool
 epoxy_conservative_has_glx_extension(const char *ext)
 {
-    Display *dpy = glXGetCurrentDisplay();
-    GLXContext ctx = glXGetCurrentContext();
+    void *dpy, *ctx;
     int screen;
 
-    if (!dpy || !ctx)
+    if (!epoxy_current_context(EPOXY_CONTEXT_PLATFORM_GLX, &dpy, &ctx) || !dpy)
         return true;
 
     glXQueryContext(dpy, ctx, GLX_SCREEN, &screen);
@@ -119,6 +119,45 @@ epoxy_conservative_has_glx_extension(const char *ext)
     return epoxy_has_glx_extension(dpy, screen, ext);
 }
 
+typedef int (*close_display_proc)(Display *dpy, XExtCodes *codes);
+typedef XExtCodes *(*add_extension_proc)(Display *dpy);
+typedef close_display_proc (*set_close_display_proc)(Display *dpy, int extension,
+                                                     close_display_proc proc);
+
+static int
+forget_glx_display(Display *dpy, XExtCodes *codes)
+{
+    (void)codes;
+
+    epoxy_forget_extension_sets(dpy);
+    return 0;
+}
+
+/* Has what's known about a display forgotten when it gets closed, since
+ * another one may then be opened at the same address.  Epoxy doesn't
+ * link Xlib, so it's looked up in whatever the app loaded.  Returns
+ * false if that couldn't be arranged.
+ */
+static bool
+watch_glx_display(Display *dpy)
+{
+    add_extension_proc add_extension;
+    set_close_display_proc set_close_display;
+    XExtCodes *codes;
+
+    add_extension = (add_extension_proc)dlsym(RTLD_DEFAULT, "XAddExtension");
+    set_close_display = (set_close_display_proc)dlsym(RTLD_DEFAULT, "XESetCloseDisplay");
+    if (!add_extension || !set_close_display)
+        return false;
+
+    codes = add_extension(dpy);
+    if (!codes)
+        return false;
+
+    set_close_display(dpy, codes->extension, forget_glx_display);
+    return true;
+}
+
 /**
  * @brief Returns true if the given GLX extension is supported in the current context.
  *
@@ -134,13 +173,30 @@ epoxy_conservative_has_glx_extension(const char *ext)
 bool
 epoxy_has_glx_extension(Display *dpy, int screen, const char *ext)
 {
+    const struct epoxy_extension_set *set = epoxy_find_extension_set(dpy, screen);
+    const char *extensions;
+    bool new_display;
+
+    if (set)
+        return epoxy_extension_set_has(set, ext);
+
     /* No, you can't just use glXGetClientString or
      * glXGetServerString() here.  Those each tell you about one half
      * of what's needed for an extension to be supported, and
      * glXQueryExtensionsString() is what gives you the intersection
      * of the two.
      */
-    return epoxy_extension_in_string(glXQueryExtensionsString(dpy, screen), ext);
+    extensions = glXQueryExtensionsString(dpy, screen);
+    set = epoxy_add_extension_set(dpy, screen, extensions, &new_display);
+    /* A set that wouldn't get forgotten could outlive its display. */
+    if (set && new_display && !watch_glx_display(dpy)) {
+        epoxy_forget_extension_sets(dpy);
+        set = NULL;
+    }
+    if (!set)
+        return epoxy_extension_in_string(extensions, ext);
+
+    return epoxy_extension_set_has(set, ext);
 }
 
 /**
@@ -170,3 +226,52 @@ epoxy_has_glx(Display *dpy)
     return false;
 #endif /* !PLATFORM_HAS_GLX */
 }
+
+/**
+ * @brief Tells epoxy that glXMakeCurrent() or glXMakeContextCurrent()
+ * was called on this thread without going through epoxy.
+ *
+ * Epoxy keeps track of the GLX context that its own MakeCurrent calls
+ * made current, rather than asking the driver every time it needs to
+ * know.  Code that mixes those with calls straight to libGL on the
+ * same thread needs to call this afterwards.
+ */
+void
+epoxy_handle_external_glXMakeCurrent(void)
+{
+    epoxy_set_current_context(EPOXY_CONTEXT_PLATFORM_GLX, false, NULL, NULL);
+}
+
+WRAPPER_VISIBILITY (Bool)
+WRAPPER(epoxy_glXMakeCurrent)(Display *dpy, GLXDrawable drawable,
+                              GLXContext ctx)
+{
+    Bool ret = epoxy_glXMakeCurrent_unwrapped(dpy, drawable, ctx);
+
+    epoxy_set_current_context(EPOXY_CONTEXT_PLATFORM_GLX, ret, dpy, ctx);
+
+    return ret;
+}
+
+WRAPPER_VISIBILITY (Bool)
+WRAPPER(epoxy_glXMakeContextCurrent)(Display *dpy, GLXDrawable draw,
+                                     GLXDrawable read, GLXContext ctx)
+{
+    Bool ret = epoxy_glXMakeContextCurrent_unwrapped(dpy, draw, read, ctx);
+
+    epoxy_set_current_context(EPOXY_CONTEXT_PLATFORM_GLX, ret, dpy, ctx);
+
+    return ret;
+}
+
+WRAPPER_VISIBILITY (void)
+WRAPPER(epoxy_glXDestroyContext)(Display *dpy, GLXContext ctx)
+{
+    epoxy_glXDestroyContext_unwrapped(dpy, ctx);
+
+    epoxy_forget_context_states(EPOXY_CONTEXT_PLATFORM_GLX, dpy, ctx);
+}
+
+PFNGLXMAKECURRENTPROC epoxy_glXMakeCurrent = epoxy_glXMakeCurrent_wrapped;
+PFNGLXMAKECONTEXTCURRENTPROC epoxy_glXMakeContextCurrent = epoxy_glXMakeContextCurrent_wrapped;
+PFNGLXDESTROYCONTEXTPROC epoxy_glXDestroyContext = epoxy_glXDestroyContext_wrapped;
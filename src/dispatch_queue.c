@@ -0,0 +1,531 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * @file dispatch_queue.c
+ *
+ * Implements the command queue, which moves the GL calls of the thread
+ * that starts it onto a thread of epoxy's own, so that the time the
+ * driver spends in them overlaps with the app's.
+ *
+ * Starting the queue moves the thread's context over to the queue's
+ * thread and puts the queued thunks in the GL function pointers, and
+ * in those of the buffer swaps.  On the thread that started it, each
+ * call then gets copied into a ring buffer, as the function replaying
+ * it followed by its arguments, and the queue's thread makes the
+ * calls in order.  The calls that return something or pass pointers to
+ * memory that the app may reuse as soon as they return get a pointer
+ * to their arguments queued instead, and wait for the queue to get
+ * through them.
+ *
+ * The ring only has the one producer and the one consumer, which each
+ * own their end.  The producer makes what it queued visible every few
+ * kilobytes, and at each call that waits or flushes, and either side
+ * only takes the mutex to sleep once it's been spinning for a while.
+ */
+
+#define _GNU_SOURCE
+#include "config.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dispatch_common.h"
+
+#if USING_QUEUE
+
+#define ARRAY_SIZE(arr) (sizeof(arr) / sizeof(arr[0]))
+
+/* 1 MiB of calls can be queued, unless EPOXY_QUEUE_SIZE says otherwise. */
+#define DEFAULT_QUEUE_SIZE (1 << 20)
+#define MIN_QUEUE_SIZE (1 << 16)
+
+/* The producer makes its calls visible at least every this many bytes. */
+#define PUBLISH_BYTES 4096
+
+/* How many times either side checks on the other before sleeping. */
+#define SPIN_COUNT 2048
+
+/* Besides the flags of the queued thunks: the rest of the ring up to
+ * its end is unused, and the queue's thread stops after this call.
+ */
+#define QUEUE_WRAP 4
+#define QUEUE_STOP 8
+
+struct queue_command {
+    void (*replay)(void *data);
+    /* The size of the whole command, a multiple of the header's. */
+    uint32_t size;
+    uint32_t flags;
+};
+
+struct queue_context {
+    epoxy_context_platform_t platform;
+    void *display;
+    void *context;
+#if PLATFORM_HAS_EGL
+    EGLenum api;
+    EGLSurface egl_draw;
+    EGLSurface egl_read;
+#endif
+#if PLATFORM_HAS_GLX
+    GLXDrawable glx_draw;
+    GLXDrawable glx_read;
+#endif
+    bool made_current;
+};
+
+static struct {
+    char *buffer;
+    uint64_t size;
+
+    /* Where the producer queues its next call, only touched by it. */
+    uint64_t head;
+    /* How much of the ring the queue's thread may replay. */
+    uint64_t published;
+    /* How much of it the queue's thread has replayed. */
+    uint64_t tail;
+
+    /* Whether either side is sleeping, or about to. */
+    bool consumer_waiting;
+    bool producer_waiting;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+
+    pthread_t thread;
+    struct queue_context context;
+} queue = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+};
+
+EPOXY_THREAD_LOCAL_FAST bool epoxy_queue_producer;
+
+/* Serializes starting and stopping. */
+static pthread_mutex_t queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static bool queue_running;
+
+static bool (*const queue_interposers[])(enum epoxy_interposer from,
+                                         enum epoxy_interposer to) = {
+    gl_interpose,
+#if PLATFORM_HAS_EGL
+    egl_interpose,
+#endif
+#if PLATFORM_HAS_GLX
+    glx_interpose,
+#endif
+};
+
+static inline void
+cpu_relax(void)
+{
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+/* Wakes up the other side if it's sleeping.  The flags and positions
+ * are all accessed sequentially consistently, so that a side going to
+ * sleep either sees the other's progress or gets woken up.
+ */
+static void
+wake(bool *waiting)
+{
+    if (__atomic_load_n(waiting, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&queue.mutex);
+        pthread_cond_broadcast(&queue.cond);
+        pthread_mutex_unlock(&queue.mutex);
+    }
+}
+
+static void
+publish(void)
+{
+    __atomic_store_n(&queue.published, queue.head, __ATOMIC_SEQ_CST);
+    wake(&queue.consumer_waiting);
+}
+
+/* Waits for the queue's thread to get through the ring up to position. */
+static void
+wait_for_tail(uint64_t position)
+{
+    int i;
+
+    for (i = 0; i < SPIN_COUNT; i++) {
+        if (__atomic_load_n(&queue.tail, __ATOMIC_ACQUIRE) >= position)
+            return;
+        cpu_relax();
+    }
+
+    pthread_mutex_lock(&queue.mutex);
+    __atomic_store_n(&queue.producer_waiting, true, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&queue.tail, __ATOMIC_SEQ_CST) < position)
+        pthread_cond_wait(&queue.cond, &queue.mutex);
+    __atomic_store_n(&queue.producer_waiting, false, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&queue.mutex);
+}
+
+/* Waits for the ring to have room for size more bytes at the head. */
+static void
+make_room(uint32_t size)
+{
+    uint64_t end = queue.head + size;
+
+    if (end - __atomic_load_n(&queue.tail, __ATOMIC_ACQUIRE) > queue.size) {
+        publish();
+        wait_for_tail(end - queue.size);
+    }
+}
+
+void
+epoxy_queue_call(void (*replay)(void *data), void *data, size_t size,
+                 unsigned flags)
+{
+    struct queue_command *command;
+    size_t payload = flags & EPOXY_QUEUE_SYNC ? sizeof(data) : size;
+    uint32_t total = sizeof(*command) +
+        (payload + sizeof(*command) - 1) / sizeof(*command) * sizeof(*command);
+    uint64_t offset = queue.head & (queue.size - 1);
+
+    /* Commands don't wrap around, so if this one doesn't fit before the
+     * end of the ring, the rest of it gets skipped.
+     */
+    if (offset + total > queue.size) {
+        uint32_t skip = queue.size - offset;
+
+        make_room(skip);
+        command = (struct queue_command *)(queue.buffer + offset);
+        command->size = skip;
+        command->flags = QUEUE_WRAP;
+        queue.head += skip;
+        offset = 0;
+    }
+
+    make_room(total);
+    command = (struct queue_command *)(queue.buffer + offset);
+    command->replay = replay;
+    command->size = total;
+    command->flags = flags;
+    if (flags & EPOXY_QUEUE_SYNC)
+        memcpy(command + 1, &data, sizeof(data));
+    else
+        memcpy(command + 1, data, size);
+    queue.head += total;
+
+    if (flags & (EPOXY_QUEUE_SYNC | EPOXY_QUEUE_FLUSH) ||
+        queue.head - queue.published >= PUBLISH_BYTES)
+        publish();
+    if (flags & EPOXY_QUEUE_SYNC)
+        wait_for_tail(queue.head);
+}
+
+/* Waits for the producer to publish more than the ring up to tail. */
+static uint64_t
+wait_for_calls(uint64_t tail)
+{
+    uint64_t published;
+    int i;
+
+    for (i = 0; i < SPIN_COUNT; i++) {
+        published = __atomic_load_n(&queue.published, __ATOMIC_ACQUIRE);
+        if (published != tail)
+            return published;
+        cpu_relax();
+    }
+
+    pthread_mutex_lock(&queue.mutex);
+    __atomic_store_n(&queue.consumer_waiting, true, __ATOMIC_SEQ_CST);
+    while ((published = __atomic_load_n(&queue.published,
+                                        __ATOMIC_SEQ_CST)) == tail)
+        pthread_cond_wait(&queue.cond, &queue.mutex);
+    __atomic_store_n(&queue.consumer_waiting, false, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&queue.mutex);
+
+    return published;
+}
+
+static void *
+queue_thread(void *data)
+{
+    uint64_t tail = 0;
+
+    (void)data;
+
+    for (;;) {
+        uint64_t published = wait_for_calls(tail);
+
+        while (tail != published) {
+            struct queue_command *command =
+                (struct queue_command *)(queue.buffer + (tail & (queue.size - 1)));
+            uint32_t flags = command->flags;
+
+            if (flags & EPOXY_QUEUE_SYNC)
+                command->replay(*(void **)(command + 1));
+            else if (!(flags & QUEUE_WRAP))
+                command->replay(command + 1);
+
+            tail += command->size;
+            __atomic_store_n(&queue.tail, tail, __ATOMIC_SEQ_CST);
+            wake(&queue.producer_waiting);
+
+            if (flags & QUEUE_STOP)
+                return NULL;
+        }
+    }
+}
+
+/* Finds out what the current context and its drawables are. */
+static bool
+get_current_context(struct queue_context *context)
+{
+    struct epoxy_context_info info;
+
+    if (!epoxy_get_context_info(&info))
+        return false;
+
+    context->platform = info.platform;
+    context->display = info.display;
+    context->context = info.context;
+
+    switch (info.platform) {
+#if PLATFORM_HAS_EGL
+    case EPOXY_CONTEXT_PLATFORM_EGL:
+        context->api = eglQueryAPI();
+        context->egl_draw = eglGetCurrentSurface(EGL_DRAW);
+        context->egl_read = eglGetCurrentSurface(EGL_READ);
+        return true;
+#endif
+#if PLATFORM_HAS_GLX
+    case EPOXY_CONTEXT_PLATFORM_GLX:
+        context->glx_draw = glXGetCurrentDrawable();
+        context->glx_read = glXGetCurrentReadDrawable();
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+/* Makes the context current on the calling thread, or releases it,
+ * through epoxy so that it keeps track.
+ */
+static bool
+make_current(const struct queue_context *context, bool bind)
+{
+    switch (context->platform) {
+#if PLATFORM_HAS_EGL
+    case EPOXY_CONTEXT_PLATFORM_EGL:
+        if (!bind)
+            return eglMakeCurrent(context->display, EGL_NO_SURFACE,
+                                  EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        return eglBindAPI(context->api) &&
+            eglMakeCurrent(context->display, context->egl_draw,
+                           context->egl_read, context->context);
+#endif
+#if PLATFORM_HAS_GLX
+    case EPOXY_CONTEXT_PLATFORM_GLX:
+        if (!bind)
+            return glXMakeContextCurrent(context->display, None, None, NULL);
+        return glXMakeContextCurrent(context->display, context->glx_draw,
+                                     context->glx_read, context->context);
+#endif
+    default:
+        return false;
+    }
+}
+
+static void
+replay_make_current(void *data)
+{
+    struct queue_context *context = data;
+
+    context->made_current = make_current(context, true);
+}
+
+static void
+replay_release(void *data)
+{
+    make_current(data, false);
+}
+
+/* Stops the queue's thread once it's through the calls queued so far,
+ * releasing the context on it.
+ */
+static void
+stop_thread(void)
+{
+    epoxy_queue_call(replay_release, &queue.context, 0,
+                     EPOXY_QUEUE_SYNC | QUEUE_STOP);
+    pthread_join(queue.thread, NULL);
+    free(queue.buffer);
+    queue.buffer = NULL;
+}
+
+static bool
+interpose(enum epoxy_interposer from, enum epoxy_interposer to)
+{
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(queue_interposers); i++) {
+        if (!queue_interposers[i](from, to)) {
+            while (i--)
+                queue_interposers[i](to, from);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool
+start_queue(void)
+{
+    const char *env = getenv("EPOXY_QUEUE_SIZE");
+
+    queue.size = DEFAULT_QUEUE_SIZE;
+    if (env && atoi(env) > 0) {
+        unsigned size = atoi(env);
+
+        /* Rounded up to a power of two, so that offsets just wrap. */
+        queue.size = MIN_QUEUE_SIZE;
+        while (queue.size < size && queue.size < (1u << 30))
+            queue.size <<= 1;
+    }
+
+    /* Calls through PLT slots bound to the driver would skip the queue,
+     * and be made on a thread without the context current.
+     */
+    if (epoxy_ifunc_bound())
+        return false;
+
+    if (!get_current_context(&queue.context))
+        return false;
+
+    queue.buffer = aligned_alloc(sizeof(struct queue_command), queue.size);
+    if (!queue.buffer)
+        return false;
+    queue.head = queue.published = queue.tail = 0;
+
+    if (!make_current(&queue.context, false)) {
+        free(queue.buffer);
+        return false;
+    }
+
+    if (pthread_create(&queue.thread, NULL, queue_thread, NULL) != 0) {
+        free(queue.buffer);
+        make_current(&queue.context, true);
+        return false;
+    }
+
+    epoxy_queue_call(replay_make_current, &queue.context, 0, EPOXY_QUEUE_SYNC);
+    if (!queue.context.made_current ||
+        !interpose(EPOXY_INTERPOSER_NONE, EPOXY_INTERPOSER_QUEUE)) {
+        stop_thread();
+        make_current(&queue.context, true);
+        return false;
+    }
+
+    epoxy_queue_producer = true;
+    return true;
+}
+
+#endif /* USING_QUEUE */
+
+/**
+ * @brief Starts queueing the GL calls of the current thread, to be
+ * made by a thread of epoxy's own.
+ *
+ * The context current on the calling thread becomes current on the
+ * queue's thread instead, until epoxy_queue_stop().  Calls to GL and to
+ * the buffer swap functions made on the calling thread meanwhile
+ * return as soon as they're queued, except for the ones that return
+ * something or pass pointers, and the draws, which wait for the queue
+ * to get through them.  Calls made on other threads aren't queued.
+ *
+ * While the queue runs, the calling thread has no context current as
+ * far as the window system is concerned, so it mustn't make contexts
+ * current, or ask for the current one, until the queue is stopped.
+ *
+ * @return Whether the queue started, which it can't without an EGL or
+ * GLX context current, if epoxy was built without it, while the
+ * statistics or tracing modes or the shadow state run, once IFUNC
+ * entrypoints got bound to the driver, or if it's already running.
+ */
+bool
+epoxy_queue_start(void)
+{
+#if USING_QUEUE
+    bool started = false;
+
+    pthread_mutex_lock(&queue_mutex);
+    if (!queue_running)
+        started = queue_running = start_queue();
+    pthread_mutex_unlock(&queue_mutex);
+
+    return started;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Waits for the queue to get through the calls queued so far.
+ *
+ * Does nothing on threads other than the one that started the queue.
+ */
+void
+epoxy_queue_finish(void)
+{
+#if USING_QUEUE
+    if (epoxy_queue_producer) {
+        publish();
+        wait_for_tail(queue.head);
+    }
+#endif
+}
+
+/**
+ * @brief Stops queueing calls, once the queue got through the ones
+ * queued so far, and makes the context current on the calling thread
+ * again.
+ *
+ * Must be called on the thread that started the queue.
+ */
+void
+epoxy_queue_stop(void)
+{
+#if USING_QUEUE
+    pthread_mutex_lock(&queue_mutex);
+    if (queue_running && epoxy_queue_producer) {
+        interpose(EPOXY_INTERPOSER_QUEUE, EPOXY_INTERPOSER_NONE);
+        stop_thread();
+        epoxy_queue_producer = false;
+        make_current(&queue.context, true);
+        queue_running = false;
+    }
+    pthread_mutex_unlock(&queue_mutex);
+#endif
+}
@@ -0,0 +1,318 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * @file dispatch_report.c
+ *
+ * Reports what resolving each function involved: which provider got
+ * chosen, what looked the function up, which libraries had to be
+ * opened for it, and how long deciding on the provider and loading
+ * the function took.  The reports go to the listener set with
+ * epoxy_set_resolve_listener(), and with EPOXY_DEBUG_RESOLVE=1, to
+ * stderr along with the totals at exit.
+ *
+ * Deciding on a provider may resolve other functions, such as
+ * glGetString(), which get reports of their own, nested in the one
+ * that needed them.  The totals only count the outermost ones, whose
+ * times include the nested ones.
+ */
+
+#define _GNU_SOURCE
+#include "config.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "dispatch_common.h"
+
+struct resolve_totals {
+    uint64_t resolved;
+    uint64_t failed;
+    uint64_t libraries;
+    uint64_t elapsed_ns;
+    uint64_t condition_ns;
+    uint64_t load_ns;
+    uint64_t dlopen_ns;
+};
+
+/* A listener and its data, which get published together so that a
+ * resolve never calls one listener with the other's data.
+ */
+struct resolve_listener {
+    epoxy_resolve_listener_t func;
+    void *data;
+    struct resolve_listener *next_retired;
+};
+
+static struct resolve_listener *resolve_listener;
+
+/* The listeners that got replaced, which other threads may still be
+ * calling, so they're never freed.
+ */
+static struct resolve_listener *retired_listeners;
+static bool debug_resolve;
+static struct resolve_totals totals;
+
+/* The innermost resolve going on in this thread. */
+static EPOXY_THREAD_LOCAL struct epoxy_resolve_report *current_report;
+
+static uint64_t
+now_ns(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER count, frequency;
+
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&frequency);
+    return (uint64_t)(count.QuadPart * (1000000000.0 / frequency.QuadPart));
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+static double
+ms(uint64_t ns)
+{
+    return ns / 1000000.0;
+}
+
+void
+epoxy_resolve_report_begin(struct epoxy_resolve_report *report,
+                           const char *name)
+{
+    report->active = debug_resolve || epoxy_atomic_load_ptr(&resolve_listener);
+    if (!report->active)
+        return;
+
+    report->loading = false;
+    report->name = name;
+    report->provider = NULL;
+    report->loader = NULL;
+    report->library_count = 0;
+    report->condition_ns = 0;
+    report->dlopen_ns = 0;
+    report->outer = current_report;
+    current_report = report;
+
+    report->start_ns = now_ns();
+}
+
+void
+epoxy_resolve_report_provider(struct epoxy_resolve_report *report,
+                              const char *provider, const char *loader)
+{
+    if (!report->active)
+        return;
+
+    report->load_start_ns = now_ns();
+    report->condition_ns = report->load_start_ns - report->start_ns;
+    report->provider = provider;
+    report->loader = loader;
+    report->loading = true;
+}
+
+static void
+print_report(const struct epoxy_resolve_event *event, int depth)
+{
+    int i;
+
+    fprintf(stderr, "epoxy: %*s%s: ", 2 * depth, "", event->name);
+    if (event->provider)
+        fprintf(stderr, "%s via %s", event->provider, event->loader);
+    else
+        fputs("no provider", stderr);
+    if (event->provider && !event->function)
+        fputs(", not found", stderr);
+
+    fprintf(stderr, ", %.3f ms (%.3f ms deciding, %.3f ms loading)",
+            ms(event->elapsed_ns), ms(event->condition_ns), ms(event->load_ns));
+
+    for (i = 0; i < event->library_count; i++)
+        fprintf(stderr, "%s%s", i ? ", " : ", opened ", event->libraries[i]);
+    if (event->dlopen_ns)
+        fprintf(stderr, " (%.3f ms in dlopen)", ms(event->dlopen_ns));
+    fputc('\n', stderr);
+}
+
+void
+epoxy_resolve_report_end(struct epoxy_resolve_report *report, void *function)
+{
+    struct epoxy_resolve_event event;
+    struct resolve_listener *listener;
+    struct epoxy_resolve_report *outer;
+    uint64_t end;
+    int depth = 0;
+
+    if (!report->active)
+        return;
+
+    end = now_ns();
+    current_report = report->outer;
+
+    event.name = report->name;
+    event.provider = report->provider;
+    event.loader = report->loader;
+    event.libraries = report->libraries;
+    event.library_count = report->library_count;
+    event.function = function;
+    event.elapsed_ns = end - report->start_ns;
+    event.condition_ns = report->loading ? report->condition_ns : event.elapsed_ns;
+    event.load_ns = report->loading ? end - report->load_start_ns : 0;
+    event.dlopen_ns = report->dlopen_ns;
+
+    listener = epoxy_atomic_load_ptr(&resolve_listener);
+    if (listener)
+        listener->func(&event, listener->data);
+
+    for (outer = report->outer; outer; outer = outer->outer)
+        depth++;
+    if (debug_resolve)
+        print_report(&event, depth);
+
+    /* What the nested resolve opened was needed for the outer one. */
+    outer = report->outer;
+    if (outer) {
+        int i;
+
+        outer->dlopen_ns += report->dlopen_ns;
+        for (i = 0; i < report->library_count; i++) {
+            if (outer->library_count < EPOXY_RESOLVE_MAX_LIBRARIES)
+                outer->libraries[outer->library_count++] = report->libraries[i];
+        }
+        return;
+    }
+
+    epoxy_atomic_add_u64(&totals.resolved, 1);
+    if (!function)
+        epoxy_atomic_add_u64(&totals.failed, 1);
+    epoxy_atomic_add_u64(&totals.libraries, event.library_count);
+    epoxy_atomic_add_u64(&totals.elapsed_ns, event.elapsed_ns);
+    epoxy_atomic_add_u64(&totals.condition_ns, event.condition_ns);
+    epoxy_atomic_add_u64(&totals.load_ns, event.load_ns);
+    epoxy_atomic_add_u64(&totals.dlopen_ns, event.dlopen_ns);
+}
+
+/**
+ * Records what a provider's function got looked up with, when it's
+ * only known once epoxy's own lookups decide.
+ */
+void
+epoxy_resolve_report_loader(const char *loader)
+{
+    struct epoxy_resolve_report *report = current_report;
+
+    if (report && report->loading)
+        report->loader = loader;
+}
+
+/**
+ * Returns the timestamp for epoxy_resolve_report_dlopen(), or 0 if
+ * no resolve is being reported on this thread.
+ */
+uint64_t
+epoxy_resolve_report_dlopen_start(void)
+{
+    return current_report ? now_ns() : 0;
+}
+
+void
+epoxy_resolve_report_dlopen(const char *library, uint64_t start_ns,
+                            bool opened)
+{
+    struct epoxy_resolve_report *report = current_report;
+
+    if (!report || !start_ns)
+        return;
+
+    report->dlopen_ns += now_ns() - start_ns;
+    if (opened && report->library_count < EPOXY_RESOLVE_MAX_LIBRARIES)
+        report->libraries[report->library_count++] = library;
+}
+
+void
+epoxy_resolve_report_init(void)
+{
+    const char *env = getenv("EPOXY_DEBUG_RESOLVE");
+
+    debug_resolve = env && atoi(env);
+}
+
+void
+epoxy_resolve_report_fini(void)
+{
+    if (!debug_resolve || !totals.resolved)
+        return;
+
+    fprintf(stderr,
+            "epoxy: resolved %llu functions (%llu not found) in "
+            "%.3f ms: %.3f ms deciding on providers, %.3f ms loading, "
+            "%.3f ms in dlopen of %llu libraries\n",
+            (unsigned long long)totals.resolved,
+            (unsigned long long)totals.failed,
+            ms(totals.elapsed_ns), ms(totals.condition_ns),
+            ms(totals.load_ns), ms(totals.dlopen_ns),
+            (unsigned long long)totals.libraries);
+}
+
+/**
+ * @brief Sets a function to be called every time epoxy resolves a
+ * function, with what resolving it involved.
+ *
+ * The listener gets called on the thread that resolved the function,
+ * possibly while other threads are resolving functions too, and must
+ * not call through epoxy itself.  Functions resolved while deciding on
+ * the provider of another one, such as glGetString(), get reported
+ * before it.
+ *
+ * @param listener The listener, or NULL to stop listening.
+ * @param data Passed to the listener.
+ */
+void
+epoxy_set_resolve_listener(epoxy_resolve_listener_t listener, void *data)
+{
+    struct resolve_listener *new_listener = NULL;
+    struct resolve_listener *old_listener;
+
+    if (listener) {
+        new_listener = calloc(1, sizeof(*new_listener));
+        if (!new_listener) {
+            fputs("epoxy: out of memory for the resolve listener\n", stderr);
+            return;
+        }
+        new_listener->func = listener;
+        new_listener->data = data;
+    }
+
+    old_listener = epoxy_atomic_exchange_ptr(&resolve_listener, new_listener);
+    if (!old_listener)
+        return;
+
+    do {
+        old_listener->next_retired = epoxy_atomic_load_ptr(&retired_listeners);
+    } while (!epoxy_atomic_cas_ptr(&retired_listeners, old_listener->next_retired,
+                                   old_listener));
+}
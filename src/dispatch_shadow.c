@@ -0,0 +1,1061 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * @file dispatch_shadow.c
+ *
+ * Implements the shadow state, which drops the calls to glEnable(),
+ * glDisable(), glActiveTexture(), glBindTexture(), glBindBuffer(),
+ * glUseProgram() and glBlendFunc() that wouldn't change anything.
+ *
+ * While it runs, the generated code puts shadowed thunks in the
+ * pointers of those functions, and of the ones that change the same
+ * state in ways it doesn't model, such as the indexed variants,
+ * glPopAttrib() or the deletion of bound objects.  Each thread keeps
+ * what it knows about the state of its current context, starting out
+ * knowing nothing, and forgets all of it whenever it finds another
+ * context current, or one gets made current through epoxy, or after a
+ * call it can't model.  Creating, linking or deleting textures, buffers
+ * or programs makes every thread forget, since contexts sharing them
+ * may now bind their names differently.
+ *
+ * It can't tell whether a call failed, so it only remembers what a
+ * call asked for if a call asking for the same would fail the same way
+ * for as long as it's remembered: binding a name that can't be bound
+ * until it's created, or a program until it's linked, or setting a
+ * capability or a factor the context doesn't have.  Dropping such a
+ * call only loses the error.  The texture units past the context's
+ * last one are left out, since binding textures goes on to change the
+ * unit that stayed active.
+ *
+ * The query cache puts thunks of its own in the pointers of
+ * glGetString(), glGetStringi() and glGetIntegerv() (and glIsEnabled(),
+ * for the shadow state), alongside the shadowed ones: the thunks of
+ * both are in while either runs, and do nothing for the one that
+ * doesn't.  It answers the queries of values that can't change over
+ * the life of a context, such as the versions, the limits and the
+ * extensions, from what it got the first time they were asked on that
+ * context, which it keeps along with epoxy's other per-context state.
+ * While the shadow state runs, the queries of the bindings it knows
+ * get answered from it too.
+ */
+
+#define _GNU_SOURCE
+#include "config.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "dispatch_common.h"
+
+#if USING_SHADOW_STATE
+
+/* What's bound to the texture units past these isn't kept track of. */
+#define SHADOW_TEXTURE_UNITS 32
+
+#define SHADOW_CAPS 34
+#define SHADOW_TEXTURE_TARGETS 12
+#define SHADOW_BUFFER_TARGETS 15
+
+/* Every name and value starts out as this, and so do the capabilities,
+ * being bytes.
+ */
+#define UNKNOWN UINT32_MAX
+
+#define ARRAY_SIZE(arr) (sizeof(arr) / sizeof(arr[0]))
+#define UNKNOWN_CAP 0xff
+
+struct shadow_known {
+    uint8_t caps[SHADOW_CAPS];
+    uint32_t active_texture;
+    uint32_t textures[SHADOW_TEXTURE_UNITS][SHADOW_TEXTURE_TARGETS];
+    uint32_t buffers[SHADOW_BUFFER_TARGETS];
+    uint32_t program;
+    uint32_t blend_func[4];
+};
+
+struct shadow_thread {
+    struct shadow_known known;
+    /* The generation that the known state dates from. */
+    uint32_t generation;
+    /* The epoxy_current_context_id() of the context it's the state of. */
+    uint64_t context;
+    /* How many texture units the context has, once it has been asked. */
+    uint32_t texture_units;
+    /* Whether a display list is being compiled, which the calls go
+     * into rather than changing the state.
+     */
+    bool compiling;
+
+    uint64_t calls;
+    uint64_t dropped;
+    uint64_t invalidations;
+    uint64_t queries;
+    uint64_t answered;
+    struct shadow_thread *next;
+};
+
+/* The immutable values of a context that have been queried.  The strings
+ * are copies, since the driver's go away with the context, while the
+ * cache of a context stays around until no thread has it current.
+ */
+struct query_cache {
+    const GLubyte *strings[5];
+    uint64_t known_integers;
+    GLint integers[64];
+    /* glGetStringi(GL_EXTENSIONS), once the count of them is known. */
+    const GLubyte **extensions;
+    GLint extension_count;
+};
+
+/* Only the thread itself updates its counters, so they just need to be
+ * read and written whole.
+ */
+#define SHADOW_ADD(counter, value) \
+    __atomic_store_n(&(counter), (counter) + (value), __ATOMIC_RELAXED)
+#define SHADOW_READ(counter) __atomic_load_n(&(counter), __ATOMIC_RELAXED)
+
+/* Bumped whenever every thread has to forget what it knows. */
+static uint32_t shadow_generation;
+
+/* Serializes starting and stopping either of them. */
+static pthread_mutex_t shadow_mutex = PTHREAD_MUTEX_INITIALIZER;
+static bool shadow_running;
+static bool query_cache_running;
+static bool shadow_interposed;
+
+/* Every thread that ever made a shadowed call, newest first. */
+static struct shadow_thread *shadow_threads;
+
+static EPOXY_THREAD_LOCAL_FAST struct shadow_thread *current_thread;
+
+static int
+cap_index(uint32_t cap)
+{
+    switch (cap) {
+    case GL_BLEND: return 0;
+    case GL_CULL_FACE: return 1;
+    case GL_DEPTH_TEST: return 2;
+    case GL_STENCIL_TEST: return 3;
+    case GL_SCISSOR_TEST: return 4;
+    case GL_POLYGON_OFFSET_FILL: return 5;
+    case GL_POLYGON_OFFSET_LINE: return 6;
+    case GL_POLYGON_OFFSET_POINT: return 7;
+    case GL_SAMPLE_ALPHA_TO_COVERAGE: return 8;
+    case GL_SAMPLE_ALPHA_TO_ONE: return 9;
+    case GL_SAMPLE_COVERAGE: return 10;
+    case GL_SAMPLE_SHADING: return 11;
+    case GL_SAMPLE_MASK: return 12;
+    case GL_DITHER: return 13;
+    case GL_MULTISAMPLE: return 14;
+    case GL_RASTERIZER_DISCARD: return 15;
+    case GL_PRIMITIVE_RESTART: return 16;
+    case GL_PRIMITIVE_RESTART_FIXED_INDEX: return 17;
+    case GL_FRAMEBUFFER_SRGB: return 18;
+    case GL_DEPTH_CLAMP: return 19;
+    case GL_TEXTURE_CUBE_MAP_SEAMLESS: return 20;
+    case GL_PROGRAM_POINT_SIZE: return 21;
+    case GL_LINE_SMOOTH: return 22;
+    case GL_POLYGON_SMOOTH: return 23;
+    case GL_COLOR_LOGIC_OP: return 24;
+    case GL_DEBUG_OUTPUT: return 25;
+    case GL_CLIP_DISTANCE0: return 26;
+    case GL_CLIP_DISTANCE1: return 27;
+    case GL_CLIP_DISTANCE2: return 28;
+    case GL_CLIP_DISTANCE3: return 29;
+    case GL_CLIP_DISTANCE4: return 30;
+    case GL_CLIP_DISTANCE5: return 31;
+    case GL_CLIP_DISTANCE6: return 32;
+    case GL_CLIP_DISTANCE7: return 33;
+    default: return -1;
+    }
+}
+
+static int
+texture_target_index(uint32_t target)
+{
+    switch (target) {
+    case GL_TEXTURE_1D: return 0;
+    case GL_TEXTURE_2D: return 1;
+    case GL_TEXTURE_3D: return 2;
+    case GL_TEXTURE_1D_ARRAY: return 3;
+    case GL_TEXTURE_2D_ARRAY: return 4;
+    case GL_TEXTURE_RECTANGLE: return 5;
+    case GL_TEXTURE_CUBE_MAP: return 6;
+    case GL_TEXTURE_CUBE_MAP_ARRAY: return 7;
+    case GL_TEXTURE_BUFFER: return 8;
+    case GL_TEXTURE_2D_MULTISAMPLE: return 9;
+    case GL_TEXTURE_2D_MULTISAMPLE_ARRAY: return 10;
+    case GL_TEXTURE_EXTERNAL_OES: return 11;
+    default: return -1;
+    }
+}
+
+static int
+buffer_target_index(uint32_t target)
+{
+    switch (target) {
+    case GL_ARRAY_BUFFER: return 0;
+    case GL_ELEMENT_ARRAY_BUFFER: return 1;
+    case GL_COPY_READ_BUFFER: return 2;
+    case GL_COPY_WRITE_BUFFER: return 3;
+    case GL_PIXEL_PACK_BUFFER: return 4;
+    case GL_PIXEL_UNPACK_BUFFER: return 5;
+    case GL_UNIFORM_BUFFER: return 6;
+    case GL_TEXTURE_BUFFER: return 7;
+    case GL_TRANSFORM_FEEDBACK_BUFFER: return 8;
+    case GL_DRAW_INDIRECT_BUFFER: return 9;
+    case GL_DISPATCH_INDIRECT_BUFFER: return 10;
+    case GL_SHADER_STORAGE_BUFFER: return 11;
+    case GL_ATOMIC_COUNTER_BUFFER: return 12;
+    case GL_QUERY_BUFFER: return 13;
+    case GL_PARAMETER_BUFFER: return 14;
+    default: return -1;
+    }
+}
+
+static void
+forget(struct shadow_thread *thread)
+{
+    memset(&thread->known, 0xff, sizeof(thread->known));
+    thread->generation = __atomic_load_n(&shadow_generation, __ATOMIC_RELAXED);
+    SHADOW_ADD(thread->invalidations, 1);
+}
+
+static EPOXY_COLD struct shadow_thread *
+add_thread(uint64_t context)
+{
+    struct shadow_thread *thread = calloc(1, sizeof(*thread));
+
+    if (!thread)
+        return NULL;
+
+    memset(&thread->known, 0xff, sizeof(thread->known));
+    thread->generation = __atomic_load_n(&shadow_generation, __ATOMIC_RELAXED);
+    thread->context = context;
+    thread->texture_units = UNKNOWN;
+    do {
+        thread->next = epoxy_atomic_load_ptr(&shadow_threads);
+    } while (!epoxy_atomic_cas_ptr(&shadow_threads, thread->next, thread));
+    current_thread = thread;
+
+    return thread;
+}
+
+/* Returns the calling thread's shadow, forgetting what it knew if it
+ * had to, or NULL if it couldn't get one.  Its context is 0 while none
+ * that epoxy can tell apart is current.
+ */
+static struct shadow_thread *
+get_thread(void)
+{
+    struct shadow_thread *thread = current_thread;
+    uint64_t context = epoxy_current_context_id();
+
+    if (!thread) {
+        thread = add_thread(context);
+        if (!thread)
+            return NULL;
+    }
+
+    if (thread->context != context) {
+        /* Another context, or none, got made current behind epoxy's back. */
+        thread->context = context;
+        thread->texture_units = UNKNOWN;
+        thread->compiling = false;
+        forget(thread);
+    } else if (thread->generation != __atomic_load_n(&shadow_generation,
+                                                     __ATOMIC_RELAXED)) {
+        forget(thread);
+    }
+
+    return thread;
+}
+
+/* Returns how many texture units the current context has, or 0 if that
+ * can't be asked.
+ */
+static uint32_t
+texture_units(struct shadow_thread *thread)
+{
+    GLint units = 0;
+
+    if (thread->texture_units == UNKNOWN) {
+        /* Only GL 2.0 and GLES 2.0 have shaders, and only the fixed
+         * function pipeline has GL_MAX_TEXTURE_UNITS.
+         */
+        glGetIntegerv(epoxy_gl_version() >= 20 ?
+                      GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS : GL_MAX_TEXTURE_UNITS,
+                      &units);
+        thread->texture_units = units > 0 ? units : 0;
+    }
+
+    return thread->texture_units;
+}
+
+/* Records that the state is now value, returning whether it wasn't. */
+static bool
+update(struct shadow_thread *thread, uint32_t *known, uint32_t value)
+{
+    if (*known == value) {
+        SHADOW_ADD(thread->dropped, 1);
+        return false;
+    }
+
+    *known = value;
+    return true;
+}
+
+static bool
+update_blend_func(struct shadow_thread *thread, const uint32_t *factors)
+{
+    uint32_t *known = thread->known.blend_func;
+
+    if (memcmp(known, factors, sizeof(thread->known.blend_func)) == 0) {
+        SHADOW_ADD(thread->dropped, 1);
+        return false;
+    }
+
+    memcpy(known, factors, sizeof(thread->known.blend_func));
+    return true;
+}
+
+static uint32_t *
+bound_texture(struct shadow_thread *thread, uint32_t target)
+{
+    uint32_t unit = thread->known.active_texture - GL_TEXTURE0;
+    int index = texture_target_index(target);
+
+    if (thread->known.active_texture == UNKNOWN ||
+        unit >= SHADOW_TEXTURE_UNITS || index < 0)
+        return NULL;
+
+    return &thread->known.textures[unit][index];
+}
+
+/**
+ * Returns whether a call needs to be made, keeping track of what it
+ * changes.
+ */
+bool
+epoxy_shadow_state_filter(enum epoxy_shadow_call call, const uint32_t *args)
+{
+    struct shadow_thread *thread;
+    struct shadow_known *known;
+    uint32_t *binding;
+    int index;
+
+    if (!__atomic_load_n(&shadow_running, __ATOMIC_RELAXED))
+        return true;
+
+    thread = get_thread();
+    if (!thread || !thread->context)
+        return true;
+    known = &thread->known;
+
+    SHADOW_ADD(thread->calls, 1);
+
+    if (thread->compiling) {
+        if (call == EPOXY_SHADOW_END_LIST) {
+            thread->compiling = false;
+            forget(thread);
+        }
+        return true;
+    }
+
+    switch (call) {
+    case EPOXY_SHADOW_ENABLE:
+    case EPOXY_SHADOW_DISABLE:
+        index = cap_index(args[0]);
+        if (index < 0)
+            return true;
+        if (known->caps[index] == (call == EPOXY_SHADOW_ENABLE)) {
+            SHADOW_ADD(thread->dropped, 1);
+            return false;
+        }
+        known->caps[index] = call == EPOXY_SHADOW_ENABLE;
+        return true;
+
+    case EPOXY_SHADOW_ACTIVE_TEXTURE:
+        if (args[0] - GL_TEXTURE0 >= texture_units(thread)) {
+            known->active_texture = UNKNOWN;
+            break;
+        }
+        return update(thread, &known->active_texture, args[0]);
+
+    case EPOXY_SHADOW_BIND_TEXTURE:
+        binding = bound_texture(thread, args[0]);
+        return !binding || update(thread, binding, args[1]);
+
+    case EPOXY_SHADOW_BIND_BUFFER:
+        index = buffer_target_index(args[0]);
+        return index < 0 || update(thread, &known->buffers[index], args[1]);
+
+    case EPOXY_SHADOW_USE_PROGRAM:
+        return update(thread, &known->program, args[0]);
+
+    case EPOXY_SHADOW_BLEND_FUNC:
+        return update_blend_func(thread, (const uint32_t[]) {
+                args[0], args[1], args[0], args[1] });
+
+    case EPOXY_SHADOW_BLEND_FUNC_SEPARATE:
+        return update_blend_func(thread, args);
+
+    case EPOXY_SHADOW_INDEXED_CAP:
+        index = cap_index(args[0]);
+        if (index >= 0)
+            known->caps[index] = UNKNOWN_CAP;
+        break;
+
+    case EPOXY_SHADOW_INDEXED_BLEND_FUNC:
+        memset(known->blend_func, 0xff, sizeof(known->blend_func));
+        break;
+
+    case EPOXY_SHADOW_TEXTURES:
+        memset(known->textures, 0xff, sizeof(known->textures));
+        break;
+
+    case EPOXY_SHADOW_BUFFERS:
+        index = buffer_target_index(args[0]);
+        if (index >= 0)
+            known->buffers[index] = UNKNOWN;
+        break;
+
+    case EPOXY_SHADOW_VERTEX_ARRAY:
+        /* The element array buffer binding belongs to the vertex array. */
+        known->buffers[buffer_target_index(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN;
+        break;
+
+    case EPOXY_SHADOW_PROGRAM:
+        known->program = UNKNOWN;
+        break;
+
+    case EPOXY_SHADOW_OBJECTS:
+        __atomic_fetch_add(&shadow_generation, 1, __ATOMIC_RELAXED);
+        forget(thread);
+        return true;
+
+    case EPOXY_SHADOW_NEW_LIST:
+        thread->compiling = true;
+        return true;
+
+    case EPOXY_SHADOW_END_LIST:
+    case EPOXY_SHADOW_ALL:
+        forget(thread);
+        return true;
+    }
+
+    SHADOW_ADD(thread->invalidations, 1);
+    return true;
+}
+
+/* Finds the value that glGetIntegerv() would return for a binding
+ * that the shadow state knows.
+ */
+static bool
+shadowed_integer(struct shadow_thread *thread, GLenum pname, GLint *value)
+{
+    const struct shadow_known *known = &thread->known;
+    const uint32_t *binding = NULL;
+    int index = -1;
+
+    switch (pname) {
+    case GL_ACTIVE_TEXTURE:
+        binding = &known->active_texture;
+        break;
+    case GL_CURRENT_PROGRAM:
+        binding = &known->program;
+        break;
+    case GL_BLEND_SRC_RGB:
+        binding = &known->blend_func[0];
+        break;
+    case GL_BLEND_DST_RGB:
+        binding = &known->blend_func[1];
+        break;
+    case GL_BLEND_SRC_ALPHA:
+        binding = &known->blend_func[2];
+        break;
+    case GL_BLEND_DST_ALPHA:
+        binding = &known->blend_func[3];
+        break;
+
+    case GL_TEXTURE_BINDING_1D:
+        binding = bound_texture(thread, GL_TEXTURE_1D);
+        break;
+    case GL_TEXTURE_BINDING_2D:
+        binding = bound_texture(thread, GL_TEXTURE_2D);
+        break;
+    case GL_TEXTURE_BINDING_3D:
+        binding = bound_texture(thread, GL_TEXTURE_3D);
+        break;
+    case GL_TEXTURE_BINDING_1D_ARRAY:
+        binding = bound_texture(thread, GL_TEXTURE_1D_ARRAY);
+        break;
+    case GL_TEXTURE_BINDING_2D_ARRAY:
+        binding = bound_texture(thread, GL_TEXTURE_2D_ARRAY);
+        break;
+    case GL_TEXTURE_BINDING_RECTANGLE:
+        binding = bound_texture(thread, GL_TEXTURE_RECTANGLE);
+        break;
+    case GL_TEXTURE_BINDING_CUBE_MAP:
+        binding = bound_texture(thread, GL_TEXTURE_CUBE_MAP);
+        break;
+    case GL_TEXTURE_BINDING_CUBE_MAP_ARRAY:
+        binding = bound_texture(thread, GL_TEXTURE_CUBE_MAP_ARRAY);
+        break;
+    case GL_TEXTURE_BINDING_2D_MULTISAMPLE:
+        binding = bound_texture(thread, GL_TEXTURE_2D_MULTISAMPLE);
+        break;
+    case GL_TEXTURE_BINDING_2D_MULTISAMPLE_ARRAY:
+        binding = bound_texture(thread, GL_TEXTURE_2D_MULTISAMPLE_ARRAY);
+        break;
+
+    case GL_ARRAY_BUFFER_BINDING:
+        index = buffer_target_index(GL_ARRAY_BUFFER);
+        break;
+    case GL_ELEMENT_ARRAY_BUFFER_BINDING:
+        index = buffer_target_index(GL_ELEMENT_ARRAY_BUFFER);
+        break;
+    case GL_COPY_READ_BUFFER_BINDING:
+        index = buffer_target_index(GL_COPY_READ_BUFFER);
+        break;
+    case GL_COPY_WRITE_BUFFER_BINDING:
+        index = buffer_target_index(GL_COPY_WRITE_BUFFER);
+        break;
+    case GL_PIXEL_PACK_BUFFER_BINDING:
+        index = buffer_target_index(GL_PIXEL_PACK_BUFFER);
+        break;
+    case GL_PIXEL_UNPACK_BUFFER_BINDING:
+        index = buffer_target_index(GL_PIXEL_UNPACK_BUFFER);
+        break;
+    case GL_UNIFORM_BUFFER_BINDING:
+        index = buffer_target_index(GL_UNIFORM_BUFFER);
+        break;
+    case GL_TRANSFORM_FEEDBACK_BUFFER_BINDING:
+        index = buffer_target_index(GL_TRANSFORM_FEEDBACK_BUFFER);
+        break;
+    case GL_DRAW_INDIRECT_BUFFER_BINDING:
+        index = buffer_target_index(GL_DRAW_INDIRECT_BUFFER);
+        break;
+    case GL_DISPATCH_INDIRECT_BUFFER_BINDING:
+        index = buffer_target_index(GL_DISPATCH_INDIRECT_BUFFER);
+        break;
+    case GL_SHADER_STORAGE_BUFFER_BINDING:
+        index = buffer_target_index(GL_SHADER_STORAGE_BUFFER);
+        break;
+    case GL_ATOMIC_COUNTER_BUFFER_BINDING:
+        index = buffer_target_index(GL_ATOMIC_COUNTER_BUFFER);
+        break;
+    case GL_QUERY_BUFFER_BINDING:
+        index = buffer_target_index(GL_QUERY_BUFFER);
+        break;
+    case GL_PARAMETER_BUFFER_BINDING:
+        index = buffer_target_index(GL_PARAMETER_BUFFER);
+        break;
+    default:
+        return false;
+    }
+
+    if (index >= 0)
+        binding = &known->buffers[index];
+    if (!binding || *binding == UNKNOWN)
+        return false;
+
+    *value = *binding;
+    return true;
+}
+
+GLboolean
+epoxy_shadow_state_is_enabled(GLboolean (GLAPIENTRY *is_enabled)(GLenum cap),
+                              GLenum cap)
+{
+    struct shadow_thread *thread;
+    int index;
+
+    if (!__atomic_load_n(&shadow_running, __ATOMIC_RELAXED))
+        return is_enabled(cap);
+
+    thread = get_thread();
+    if (!thread)
+        return is_enabled(cap);
+
+    SHADOW_ADD(thread->queries, 1);
+    index = cap_index(cap);
+    if (thread->compiling || index < 0 || thread->known.caps[index] == UNKNOWN_CAP)
+        return is_enabled(cap);
+
+    SHADOW_ADD(thread->answered, 1);
+    return thread->known.caps[index];
+}
+
+static int
+string_index(GLenum name)
+{
+    switch (name) {
+    case GL_VENDOR: return 0;
+    case GL_RENDERER: return 1;
+    case GL_VERSION: return 2;
+    case GL_SHADING_LANGUAGE_VERSION: return 3;
+    case GL_EXTENSIONS: return 4;
+    default: return -1;
+    }
+}
+
+/* The integers that can't change over the life of a context, and only
+ * have the one value.
+ */
+static int
+integer_index(GLenum pname)
+{
+    switch (pname) {
+    case GL_MAJOR_VERSION: return 0;
+    case GL_MINOR_VERSION: return 1;
+    case GL_NUM_EXTENSIONS: return 2;
+    case GL_CONTEXT_FLAGS: return 3;
+    case GL_CONTEXT_PROFILE_MASK: return 4;
+    case GL_NUM_SHADING_LANGUAGE_VERSIONS: return 5;
+    case GL_MAX_TEXTURE_SIZE: return 6;
+    case GL_MAX_3D_TEXTURE_SIZE: return 7;
+    case GL_MAX_CUBE_MAP_TEXTURE_SIZE: return 8;
+    case GL_MAX_RECTANGLE_TEXTURE_SIZE: return 9;
+    case GL_MAX_ARRAY_TEXTURE_LAYERS: return 10;
+    case GL_MAX_TEXTURE_BUFFER_SIZE: return 11;
+    case GL_MAX_RENDERBUFFER_SIZE: return 12;
+    case GL_MAX_TEXTURE_UNITS: return 13;
+    case GL_MAX_TEXTURE_IMAGE_UNITS: return 14;
+    case GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS: return 15;
+    case GL_MAX_VERTEX_TEXTURE_IMAGE_UNITS: return 16;
+    case GL_MAX_VERTEX_ATTRIBS: return 17;
+    case GL_MAX_VERTEX_UNIFORM_COMPONENTS: return 18;
+    case GL_MAX_FRAGMENT_UNIFORM_COMPONENTS: return 19;
+    case GL_MAX_VERTEX_UNIFORM_VECTORS: return 20;
+    case GL_MAX_FRAGMENT_UNIFORM_VECTORS: return 21;
+    case GL_MAX_VARYING_VECTORS: return 22;
+    case GL_MAX_VARYING_COMPONENTS: return 23;
+    case GL_MAX_UNIFORM_BUFFER_BINDINGS: return 24;
+    case GL_MAX_UNIFORM_BLOCK_SIZE: return 25;
+    case GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT: return 26;
+    case GL_MAX_SHADER_STORAGE_BUFFER_BINDINGS: return 27;
+    case GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT: return 28;
+    case GL_MAX_COLOR_ATTACHMENTS: return 29;
+    case GL_MAX_DRAW_BUFFERS: return 30;
+    case GL_MAX_SAMPLES: return 31;
+    case GL_MAX_ELEMENTS_VERTICES: return 32;
+    case GL_MAX_ELEMENTS_INDICES: return 33;
+    case GL_MAX_CLIP_DISTANCES: return 34;
+    case GL_MAX_VIEWPORTS: return 35;
+    case GL_SUBPIXEL_BITS: return 36;
+    case GL_MAX_COMPUTE_SHARED_MEMORY_SIZE: return 37;
+    case GL_MAX_COMBINED_UNIFORM_BLOCKS: return 38;
+    case GL_MAX_VERTEX_UNIFORM_BLOCKS: return 39;
+    case GL_MAX_FRAGMENT_UNIFORM_BLOCKS: return 40;
+    case GL_MAX_IMAGE_UNITS: return 41;
+    case GL_MAX_ATOMIC_COUNTER_BUFFER_BINDINGS: return 42;
+    case GL_MAX_TRANSFORM_FEEDBACK_BUFFERS: return 43;
+    case GL_MAX_VERTEX_ATTRIB_BINDINGS: return 44;
+    case GL_MAX_INTEGER_SAMPLES: return 45;
+    case GL_MAX_SAMPLE_MASK_WORDS: return 46;
+    case GL_MAX_LABEL_LENGTH: return 47;
+    default: return -1;
+    }
+}
+
+/* Returns the calling thread's shadow for counting a query, and the
+ * query cache of its current context, if the query cache runs.
+ */
+static struct shadow_thread *
+get_query_cache(struct query_cache **cache)
+{
+    struct shadow_thread *thread = get_thread();
+    void **slot;
+
+    *cache = NULL;
+    if (!thread)
+        return NULL;
+    SHADOW_ADD(thread->queries, 1);
+
+    if (!__atomic_load_n(&query_cache_running, __ATOMIC_RELAXED))
+        return thread;
+
+    slot = epoxy_current_query_cache();
+    if (!slot)
+        return thread;
+
+    *cache = epoxy_atomic_load_ptr(slot);
+    if (!*cache) {
+        struct query_cache *fresh = calloc(1, sizeof(*fresh));
+
+        if (fresh && !epoxy_atomic_cas_ptr(slot, NULL, fresh))
+            free(fresh);
+        *cache = epoxy_atomic_load_ptr(slot);
+    }
+
+    return thread;
+}
+
+/**
+ * Frees the query cache of a context that's gone, along with the
+ * strings handed out from it.
+ */
+void
+epoxy_query_cache_free(void *data)
+{
+    struct query_cache *cache = data;
+    int i;
+
+    if (!cache)
+        return;
+
+    for (i = 0; i < (int)ARRAY_SIZE(cache->strings); i++)
+        free((void *)cache->strings[i]);
+    if (cache->extensions) {
+        for (i = 0; i < cache->extension_count; i++)
+            free((void *)cache->extensions[i]);
+        free(cache->extensions);
+    }
+    free(cache);
+}
+
+const GLubyte *
+epoxy_query_cache_get_string(const GLubyte *(GLAPIENTRY *get_string)(GLenum name),
+                             GLenum name)
+{
+    struct query_cache *cache;
+    struct shadow_thread *thread = get_query_cache(&cache);
+    int index = string_index(name);
+
+    if (!cache || index < 0)
+        return get_string(name);
+
+    if (!cache->strings[index]) {
+        const GLubyte *string = get_string(name);
+
+        if (string)
+            cache->strings[index] = (const GLubyte *)strdup((const char *)string);
+        return cache->strings[index] ? cache->strings[index] : string;
+    }
+
+    SHADOW_ADD(thread->answered, 1);
+    return cache->strings[index];
+}
+
+const GLubyte *
+epoxy_query_cache_get_stringi(const GLubyte *(GLAPIENTRY *get_stringi)(GLenum name,
+                                                                       GLuint index),
+                              GLenum name, GLuint index)
+{
+    struct query_cache *cache;
+    struct shadow_thread *thread = get_query_cache(&cache);
+
+    /* Only the extensions are kept, once it's known how many there are. */
+    if (!cache || name != GL_EXTENSIONS ||
+        !(cache->known_integers & (1ull << integer_index(GL_NUM_EXTENSIONS))) ||
+        index >= (GLuint)cache->extension_count)
+        return get_stringi(name, index);
+
+    if (!cache->extensions) {
+        cache->extensions = calloc(cache->extension_count, sizeof(*cache->extensions));
+        if (!cache->extensions)
+            return get_stringi(name, index);
+    }
+
+    if (!cache->extensions[index]) {
+        const GLubyte *string = get_stringi(name, index);
+
+        if (string)
+            cache->extensions[index] = (const GLubyte *)strdup((const char *)string);
+        return cache->extensions[index] ? cache->extensions[index] : string;
+    }
+
+    SHADOW_ADD(thread->answered, 1);
+    return cache->extensions[index];
+}
+
+/* What the query cache's glGetIntegerv() starts its value out as, to
+ * find out whether the driver set it.
+ */
+#define UNSET_INTEGER INT32_MIN
+
+void
+epoxy_query_cache_get_integerv(void (GLAPIENTRY *get_integerv)(GLenum pname,
+                                                               GLint *data),
+                               GLenum pname, GLint *data)
+{
+    struct query_cache *cache;
+    struct shadow_thread *thread = get_query_cache(&cache);
+    int index;
+    GLint value;
+
+    if (thread && !thread->compiling &&
+        __atomic_load_n(&shadow_running, __ATOMIC_RELAXED) &&
+        shadowed_integer(thread, pname, data)) {
+        SHADOW_ADD(thread->answered, 1);
+        return;
+    }
+
+    index = integer_index(pname);
+    if (!cache || index < 0) {
+        get_integerv(pname, data);
+        return;
+    }
+
+    if (cache->known_integers & (1ull << index)) {
+        SHADOW_ADD(thread->answered, 1);
+        *data = cache->integers[index];
+        return;
+    }
+
+    /* Errors, such as asking GL 2 for its major version, leave the
+     * value alone, and don't get cached.
+     */
+    value = UNSET_INTEGER;
+    get_integerv(pname, &value);
+    if (value == UNSET_INTEGER)
+        return;
+
+    cache->integers[index] = value;
+    cache->known_integers |= 1ull << index;
+    if (pname == GL_NUM_EXTENSIONS)
+        cache->extension_count = value;
+    *data = value;
+}
+
+void
+epoxy_shadow_state_reset(void)
+{
+    struct shadow_thread *thread = current_thread;
+
+    if (thread) {
+        thread->compiling = false;
+        forget(thread);
+    }
+}
+
+void
+epoxy_shadow_state_init(void)
+{
+    const char *env = getenv("EPOXY_SHADOW_STATE");
+
+    if (env && atoi(env))
+        epoxy_shadow_state_start();
+
+    env = getenv("EPOXY_QUERY_CACHE");
+    if (env && atoi(env))
+        epoxy_query_cache_start();
+}
+
+/* Puts the thunks in while either of them runs, and takes them out once
+ * neither does.  Called with shadow_mutex held.
+ */
+static bool
+interpose(void)
+{
+    bool wanted = shadow_running || query_cache_running;
+
+    /* Calls through PLT slots bound to the driver would get past the
+     * thunks.
+     */
+    if (wanted && !shadow_interposed && !epoxy_ifunc_bound()) {
+        shadow_interposed = gl_interpose(EPOXY_INTERPOSER_NONE,
+                                         EPOXY_INTERPOSER_SHADOW_STATE);
+    } else if (!wanted && shadow_interposed) {
+        gl_interpose(EPOXY_INTERPOSER_SHADOW_STATE, EPOXY_INTERPOSER_NONE);
+        shadow_interposed = false;
+    }
+
+    return shadow_interposed;
+}
+
+#else
+
+void
+epoxy_shadow_state_reset(void)
+{
+}
+
+void
+epoxy_shadow_state_init(void)
+{
+    const char *env = getenv("EPOXY_SHADOW_STATE");
+
+    if (env && atoi(env))
+        fputs("EPOXY_SHADOW_STATE isn't supported by this build of epoxy\n", stderr);
+
+    env = getenv("EPOXY_QUERY_CACHE");
+    if (env && atoi(env))
+        fputs("EPOXY_QUERY_CACHE isn't supported by this build of epoxy\n", stderr);
+}
+
+#endif /* USING_SHADOW_STATE */
+
+/**
+ * @brief Starts dropping the calls to glEnable(), glDisable(),
+ * glActiveTexture(), glBindTexture(), glBindBuffer(), glUseProgram()
+ * and glBlendFunc() that wouldn't change anything, on every thread.
+ *
+ * This only knows about the calls made through epoxy: code that changes
+ * the same state by calling the driver directly has to make a context
+ * current through epoxy afterwards, or stop the shadow state.  A call
+ * that failed may get dropped when it's made again, without the error
+ * it would raise again.  Running with EPOXY_SHADOW_STATE=1 starts it
+ * when epoxy gets loaded.
+ *
+ * @return Whether this build of epoxy has the shadow state, which it
+ * can't run while the statistics or tracing modes or the command queue
+ * run, or once IFUNC entrypoints got bound to the driver.
+ */
+bool
+epoxy_shadow_state_start(void)
+{
+#if USING_SHADOW_STATE
+    bool started;
+
+    pthread_mutex_lock(&shadow_mutex);
+    if (!shadow_running) {
+        /* What was known before it stopped is stale by now. */
+        __atomic_fetch_add(&shadow_generation, 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&shadow_running, true, __ATOMIC_RELAXED);
+        if (!interpose())
+            __atomic_store_n(&shadow_running, false, __ATOMIC_RELAXED);
+    }
+    started = shadow_running;
+    pthread_mutex_unlock(&shadow_mutex);
+
+    return started;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Stops dropping calls, leaving the function pointers as they
+ * were before epoxy_shadow_state_start().
+ */
+void
+epoxy_shadow_state_stop(void)
+{
+#if USING_SHADOW_STATE
+    pthread_mutex_lock(&shadow_mutex);
+    if (shadow_running) {
+        __atomic_store_n(&shadow_running, false, __ATOMIC_RELAXED);
+        interpose();
+    }
+    pthread_mutex_unlock(&shadow_mutex);
+#endif
+}
+
+/**
+ * @brief Starts answering glGetString(), glGetStringi(GL_EXTENSIONS)
+ * and glGetIntegerv() queries of the values that can't change over the
+ * life of a context, such as its versions, extensions and limits, from
+ * what the driver answered the first time, on every thread.
+ *
+ * While the shadow state runs too, the queries of the bindings and
+ * capabilities it knows (glGetIntegerv(GL_CURRENT_PROGRAM),
+ * glIsEnabled(), ...) get answered from it as well.  Only contexts
+ * that epoxy can tell apart get a cache.  Running with
+ * EPOXY_QUERY_CACHE=1 starts it when epoxy gets loaded.
+ *
+ * @return Whether this build of epoxy has the query cache, which it
+ * can't run while the statistics or tracing modes or the command queue
+ * run, or once IFUNC entrypoints got bound to the driver.
+ */
+bool
+epoxy_query_cache_start(void)
+{
+#if USING_SHADOW_STATE
+    bool started;
+
+    pthread_mutex_lock(&shadow_mutex);
+    if (!query_cache_running) {
+        __atomic_store_n(&query_cache_running, true, __ATOMIC_RELAXED);
+        if (!interpose())
+            __atomic_store_n(&query_cache_running, false, __ATOMIC_RELAXED);
+    }
+    started = query_cache_running;
+    pthread_mutex_unlock(&shadow_mutex);
+
+    return started;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Stops answering queries from the query cache, leaving the
+ * function pointers as they were before epoxy_query_cache_start() if
+ * the shadow state doesn't run either.
+ *
+ * What got cached is kept, and used again if the query cache starts
+ * again.
+ */
+void
+epoxy_query_cache_stop(void)
+{
+#if USING_SHADOW_STATE
+    pthread_mutex_lock(&shadow_mutex);
+    if (query_cache_running) {
+        __atomic_store_n(&query_cache_running, false, __ATOMIC_RELAXED);
+        interpose();
+    }
+    pthread_mutex_unlock(&shadow_mutex);
+#endif
+}
+
+/**
+ * @brief Reads the counters of the shadow state, summed over every
+ * thread.
+ *
+ * @param stats Filled in with the calls made to the functions that the
+ * shadow state keeps track of, how many of them got dropped, how many
+ * times a thread forgot what it knew, and the queries made to the
+ * functions that the query cache and the shadow state answer, along
+ * with how many of them they answered without the driver.
+ *
+ * @return Whether this build of epoxy has the shadow state.
+ */
+bool
+epoxy_shadow_state_snapshot(struct epoxy_shadow_state_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+
+#if USING_SHADOW_STATE
+    {
+        struct shadow_thread *thread;
+
+        for (thread = epoxy_atomic_load_ptr(&shadow_threads); thread;
+             thread = thread->next) {
+            stats->calls += SHADOW_READ(thread->calls);
+            stats->dropped += SHADOW_READ(thread->dropped);
+            stats->invalidations += SHADOW_READ(thread->invalidations);
+            stats->queries += SHADOW_READ(thread->queries);
+            stats->queries_answered += SHADOW_READ(thread->answered);
+        }
+    }
+    return true;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,459 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * @file dispatch_stats.c
+ *
+ * Implements EPOXY_STATS, which counts the calls made through epoxy's
+ * function pointers and times a sample of them, along with the hooks
+ * that the instrumented thunks call for it and for tracing.
+ *
+ * When it's enabled at startup, the generated code puts an instrumented
+ * thunk in each function pointer, in front of whatever the pointer
+ * held.  Otherwise the pointers are left alone until tracing starts,
+ * so the calls cost what they always do.
+ *
+ * Each thread counts into counters of its own, which are cache line
+ * aligned so that threads don't share lines, and times every Nth call
+ * it makes.  The buffer swaps count the frames.  The counters of all
+ * the threads are summed when they're read, and stay around when the
+ * threads exit.
+ */
+
+#define _GNU_SOURCE
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "dispatch_common.h"
+
+#if USING_INSTRUMENTATION
+
+#define CACHE_LINE_SIZE 64
+
+/* Every 64th call gets timed, unless EPOXY_STATS_SAMPLE says otherwise. */
+#define DEFAULT_SAMPLE_INTERVAL 64
+
+struct stats_counter {
+    uint64_t calls;
+    uint64_t sampled_calls;
+    uint64_t sampled_ns;
+};
+
+struct stats_thread {
+    struct stats_counter *counters[EPOXY_TARGET_COUNT];
+    uint64_t frames;
+    struct stats_thread *next;
+};
+
+static const struct stats_target {
+    const int *count;
+    const char *(*name)(int function);
+    bool (*interpose)(enum epoxy_interposer from, enum epoxy_interposer to);
+} stats_targets[EPOXY_TARGET_COUNT] = {
+    [EPOXY_TARGET_GL] = { &gl_function_count, gl_function_name, gl_interpose },
+#if PLATFORM_HAS_EGL
+    [EPOXY_TARGET_EGL] = { &egl_function_count, egl_function_name, egl_interpose },
+#endif
+#if PLATFORM_HAS_GLX
+    [EPOXY_TARGET_GLX] = { &glx_function_count, glx_function_name, glx_interpose },
+#endif
+};
+
+/* The timestamps that the hooks hand the thunks have their low bit set
+ * for the calls that got sampled, so that calls made while resolving
+ * another one can't get them confused.
+ */
+#define SAMPLED 1
+
+/* The counters are only written by their own thread, and other
+ * threads only read them, so an add just must not get torn.
+ */
+#define STATS_ADD(counter, value) \
+    __atomic_store_n(&(counter), (counter) + (value), __ATOMIC_RELAXED)
+#define STATS_READ(counter) __atomic_load_n(&(counter), __ATOMIC_RELAXED)
+
+bool epoxy_stats_enabled;
+static unsigned sample_interval = DEFAULT_SAMPLE_INTERVAL;
+static char *stats_out;
+
+/* Every thread that ever made a call, newest first. */
+static struct stats_thread *stats_threads;
+
+static EPOXY_THREAD_LOCAL_FAST struct stats_thread *current_thread;
+static EPOXY_THREAD_LOCAL_FAST unsigned sample_countdown;
+
+static void *
+alloc_cache_lines(size_t size)
+{
+    void *ptr;
+
+    size = (size + CACHE_LINE_SIZE - 1) & ~(size_t)(CACHE_LINE_SIZE - 1);
+    if (posix_memalign(&ptr, CACHE_LINE_SIZE, size) != 0)
+        return NULL;
+
+    memset(ptr, 0, size);
+    return ptr;
+}
+
+static EPOXY_COLD struct stats_thread *
+add_thread_counters(enum epoxy_dispatch_target target)
+{
+    struct stats_thread *thread = current_thread;
+
+    if (!thread) {
+        thread = alloc_cache_lines(sizeof(*thread));
+        if (!thread)
+            return NULL;
+
+        do {
+            thread->next = epoxy_atomic_load_ptr(&stats_threads);
+        } while (!epoxy_atomic_cas_ptr(&stats_threads, thread->next, thread));
+        current_thread = thread;
+    }
+
+    if (!thread->counters[target]) {
+        struct stats_counter *counters =
+            alloc_cache_lines(*stats_targets[target].count * sizeof(*counters));
+
+        if (!counters)
+            return NULL;
+        epoxy_atomic_store_ptr(&thread->counters[target], counters);
+    }
+
+    return thread;
+}
+
+uint64_t
+epoxy_instrument_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+uint64_t
+epoxy_instrument_enter(enum epoxy_dispatch_target target, int function)
+{
+    struct stats_thread *thread = current_thread;
+
+    if (epoxy_stats_enabled) {
+        if (!thread || !thread->counters[target])
+            thread = add_thread_counters(target);
+
+        if (thread) {
+            STATS_ADD(thread->counters[target][function].calls, 1);
+
+            if (sample_countdown > 1) {
+                sample_countdown--;
+            } else {
+                sample_countdown = sample_interval;
+                return epoxy_instrument_now() | SAMPLED;
+            }
+        }
+    }
+
+    return epoxy_tracing ? epoxy_instrument_now() & ~(uint64_t)SAMPLED : 0;
+}
+
+void
+epoxy_instrument_leave(enum epoxy_dispatch_target target, int function,
+                       uint64_t start, unsigned flags, const int64_t *args)
+{
+    struct stats_thread *thread = current_thread;
+    uint64_t end;
+
+    if ((flags & EPOXY_INSTRUMENT_FRAME) && thread)
+        STATS_ADD(thread->frames, 1);
+
+    if (!start)
+        return;
+
+    end = epoxy_instrument_now();
+
+    if (start & SAMPLED) {
+        struct stats_counter *counter = &thread->counters[target][function];
+
+        STATS_ADD(counter->sampled_ns, end - start);
+        STATS_ADD(counter->sampled_calls, 1);
+    }
+
+    if (epoxy_tracing)
+        epoxy_trace_record(target, function, start, end, flags, args);
+}
+
+const char *
+epoxy_instrument_function_name(enum epoxy_dispatch_target target, int function)
+{
+    return stats_targets[target].name(function);
+}
+
+/**
+ * Puts the instrumented thunks in front of the function pointers of
+ * every target, or takes them back out, failing if the command queue
+ * has its thunks in there.
+ */
+bool
+epoxy_instrument(bool enable)
+{
+    enum epoxy_interposer from = EPOXY_INTERPOSER_NONE;
+    enum epoxy_interposer to = EPOXY_INTERPOSER_INSTRUMENTATION;
+    int target;
+
+    if (!enable) {
+        from = EPOXY_INTERPOSER_INSTRUMENTATION;
+        to = EPOXY_INTERPOSER_NONE;
+    }
+
+    for (target = 0; target < EPOXY_TARGET_COUNT; target++) {
+        if (stats_targets[target].interpose &&
+            !stats_targets[target].interpose(from, to)) {
+            while (target--) {
+                if (stats_targets[target].interpose)
+                    stats_targets[target].interpose(to, from);
+            }
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool
+collect_stats(struct epoxy_stats *stats)
+{
+    struct stats_counter *sums[EPOXY_TARGET_COUNT] = { NULL };
+    struct stats_thread *thread;
+    int target, function;
+    int count = 0;
+    bool ok = true;
+
+    stats->frames = 0;
+    for (thread = epoxy_atomic_load_ptr(&stats_threads); thread; thread = thread->next)
+        stats->frames += STATS_READ(thread->frames);
+
+    for (target = 0; target < EPOXY_TARGET_COUNT; target++) {
+        if (!stats_targets[target].count)
+            continue;
+
+        sums[target] = calloc(*stats_targets[target].count, sizeof(*sums[target]));
+        if (!sums[target]) {
+            ok = false;
+            break;
+        }
+
+        for (thread = epoxy_atomic_load_ptr(&stats_threads); thread; thread = thread->next) {
+            struct stats_counter *counters =
+                epoxy_atomic_load_ptr(&thread->counters[target]);
+
+            if (!counters)
+                continue;
+
+            for (function = 0; function < *stats_targets[target].count; function++) {
+                sums[target][function].calls += STATS_READ(counters[function].calls);
+                sums[target][function].sampled_calls +=
+                    STATS_READ(counters[function].sampled_calls);
+                sums[target][function].sampled_ns +=
+                    STATS_READ(counters[function].sampled_ns);
+            }
+        }
+
+        for (function = 0; function < *stats_targets[target].count; function++) {
+            if (sums[target][function].calls)
+                count++;
+        }
+    }
+
+    if (ok) {
+        stats->entries = calloc(count ? count : 1, sizeof(*stats->entries));
+        ok = stats->entries != NULL;
+    }
+
+    for (target = 0; target < EPOXY_TARGET_COUNT && ok; target++) {
+        if (!sums[target])
+            continue;
+
+        for (function = 0; function < *stats_targets[target].count; function++) {
+            struct epoxy_stats_entry *entry;
+
+            if (!sums[target][function].calls)
+                continue;
+
+            entry = &stats->entries[stats->entry_count++];
+            entry->name = stats_targets[target].name(function);
+            entry->calls = sums[target][function].calls;
+            entry->sampled_calls = sums[target][function].sampled_calls;
+            entry->sampled_ns = sums[target][function].sampled_ns;
+        }
+    }
+
+    for (target = 0; target < EPOXY_TARGET_COUNT; target++)
+        free(sums[target]);
+
+    return ok;
+}
+
+static int
+compare_calls(const void *a, const void *b)
+{
+    const struct epoxy_stats_entry *entry_a = a, *entry_b = b;
+
+    if (entry_a->calls != entry_b->calls)
+        return entry_a->calls < entry_b->calls ? 1 : -1;
+    return strcmp(entry_a->name, entry_b->name);
+}
+
+static void
+write_report(FILE *file, struct epoxy_stats *stats)
+{
+    int i;
+
+    qsort(stats->entries, stats->entry_count, sizeof(*stats->entries),
+          compare_calls);
+
+    fprintf(file, "# %llu frames, 1 in %u calls timed\n",
+            (unsigned long long)stats->frames, sample_interval);
+    fprintf(file, "# %-38s %12s %10s %10s\n",
+            "function", "calls", "per frame", "ns/call");
+    for (i = 0; i < stats->entry_count; i++) {
+        const struct epoxy_stats_entry *entry = &stats->entries[i];
+
+        fprintf(file, "%-40s %12llu %10.2f", entry->name,
+                (unsigned long long)entry->calls,
+                stats->frames ? (double)entry->calls / stats->frames : 0.0);
+        if (entry->sampled_calls)
+            fprintf(file, " %10.1f\n", (double)entry->sampled_ns / entry->sampled_calls);
+        else
+            fprintf(file, " %10s\n", "-");
+    }
+}
+
+void
+epoxy_stats_init(void)
+{
+    const char *env;
+
+    env = getenv("EPOXY_STATS_OUT");
+    if (env && env[0]) {
+        stats_out = strdup(env);
+    } else {
+        env = getenv("EPOXY_STATS");
+        if (!env || !atoi(env))
+            return;
+    }
+
+    env = getenv("EPOXY_STATS_SAMPLE");
+    if (env && atoi(env) > 0)
+        sample_interval = atoi(env);
+
+    epoxy_stats_enabled = true;
+    epoxy_instrument(true);
+}
+
+void
+epoxy_stats_fini(void)
+{
+    struct epoxy_stats stats;
+    FILE *file;
+
+    if (!stats_out || !epoxy_stats_snapshot(&stats))
+        return;
+
+    file = fopen(stats_out, "w");
+    if (file) {
+        write_report(file, &stats);
+        fclose(file);
+    } else {
+        fprintf(stderr, "Couldn't write the epoxy stats to %s\n", stats_out);
+    }
+
+    epoxy_stats_release(&stats);
+}
+
+#else
+
+void
+epoxy_stats_init(void)
+{
+    const char *env = getenv("EPOXY_STATS_OUT");
+
+    if ((env && env[0]) || ((env = getenv("EPOXY_STATS")) && atoi(env)))
+        fputs("EPOXY_STATS isn't supported by this build of epoxy\n", stderr);
+}
+
+void
+epoxy_stats_fini(void)
+{
+}
+
+#endif /* USING_INSTRUMENTATION */
+
+/**
+ * @brief Reads the counters of the statistics mode.
+ *
+ * Running an app with `EPOXY_STATS=1` in the environment has epoxy
+ * count the calls made to each function through its function
+ * pointers, and time one in every 64 of the calls each thread makes
+ * (or one in every `EPOXY_STATS_SAMPLE`).  The buffer swaps of EGL and
+ * GLX are counted as frames.  With `EPOXY_STATS_OUT` set to a file
+ * name instead, a report of the counters also gets written to the file
+ * when the app exits.
+ *
+ * The calls of every thread are summed up, and functions that haven't
+ * been called are left out.  The durations include epoxy's own
+ * overhead, and are only summed up for the timed calls, so dividing
+ * them by the number of timed calls gives the average duration.
+ *
+ * @param stats Filled in with the counters, whose entries have to be
+ * freed with epoxy_stats_release().
+ *
+ * @return Whether the statistics mode is enabled, and the counters
+ * could be read.
+ */
+bool
+epoxy_stats_snapshot(struct epoxy_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+
+#if USING_INSTRUMENTATION
+    if (epoxy_stats_enabled && collect_stats(stats))
+        return true;
+
+    epoxy_stats_release(stats);
+#endif
+    return false;
+}
+
+/**
+ * @brief Frees what epoxy_stats_snapshot() allocated.
+ */
+void
+epoxy_stats_release(struct epoxy_stats *stats)
+{
+    free(stats->entries);
+    memset(stats, 0, sizeof(*stats));
+}
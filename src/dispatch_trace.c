@@ -0,0 +1,388 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * @file dispatch_trace.c
+ *
+ * Implements the tracing mode, which records the calls made through
+ * epoxy's function pointers and writes them out in the JSON trace
+ * format that chrome://tracing and Perfetto read.
+ *
+ * Tracing puts the same instrumented thunks in the function pointers
+ * as the statistics mode does, for as long as it's running, and can
+ * be started and stopped at any time.  Each thread records its calls
+ * into a ring of fixed size records of its own, holding the function,
+ * the timestamps and the first few scalar arguments, so recording
+ * takes no locks and an app that keeps tracing running only keeps
+ * its latest calls around.  Flushing copies the records out of the
+ * rings without stopping the threads, and skips the ones that got
+ * overwritten while it was copying them.
+ */
+
+#define _GNU_SOURCE
+#include "config.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "dispatch_common.h"
+
+#if USING_INSTRUMENTATION
+
+/* Each thread keeps its last 4096 calls, unless EPOXY_TRACE_RECORDS
+ * says otherwise.
+ */
+#define DEFAULT_TRACE_RECORDS 4096
+
+struct trace_record {
+    uint64_t start_ns;
+    uint64_t end_ns;
+    int64_t args[EPOXY_INSTRUMENT_MAX_ARGS];
+    uint32_t flags;
+    uint16_t function;
+    uint8_t target;
+};
+
+struct trace_ring {
+    /* The number of records the thread ever wrote, only written by
+     * the thread itself.
+     */
+    uint64_t head;
+    /* The number of them that got flushed, only touched by flushes. */
+    uint64_t flushed;
+    pid_t tid;
+    struct trace_ring *next;
+    struct trace_record records[];
+};
+
+static const char *const trace_categories[EPOXY_TARGET_COUNT] = {
+    [EPOXY_TARGET_GL] = "gl",
+    [EPOXY_TARGET_EGL] = "egl",
+    [EPOXY_TARGET_GLX] = "glx",
+    [EPOXY_TARGET_WGL] = "wgl",
+};
+
+bool epoxy_tracing;
+static unsigned trace_records = DEFAULT_TRACE_RECORDS;
+static char *trace_out;
+
+/* Serializes starting, stopping and flushing. */
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Every thread that ever recorded a call, newest first. */
+static struct trace_ring *trace_rings;
+
+static EPOXY_THREAD_LOCAL_FAST struct trace_ring *current_ring;
+
+static EPOXY_COLD struct trace_ring *
+add_thread_ring(void)
+{
+    struct trace_ring *ring;
+
+    ring = calloc(1, sizeof(*ring) + trace_records * sizeof(ring->records[0]));
+    if (!ring)
+        return NULL;
+
+    ring->tid = syscall(SYS_gettid);
+    do {
+        ring->next = epoxy_atomic_load_ptr(&trace_rings);
+    } while (!epoxy_atomic_cas_ptr(&trace_rings, ring->next, ring));
+    current_ring = ring;
+
+    return ring;
+}
+
+void
+epoxy_trace_record(enum epoxy_dispatch_target target, int function,
+                   uint64_t start, uint64_t end, unsigned flags,
+                   const int64_t *args)
+{
+    struct trace_ring *ring = current_ring;
+    struct trace_record *record;
+    uint64_t head;
+
+    if (!ring) {
+        ring = add_thread_ring();
+        if (!ring)
+            return;
+    }
+
+    /* The record about to be overwritten stops being valid once the
+     * head says so, which flushes must see before any of the writes.
+     */
+    head = ring->head;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    record = &ring->records[head & (trace_records - 1)];
+    record->start_ns = start;
+    record->end_ns = end;
+    memcpy(record->args, args,
+           EPOXY_INSTRUMENT_ARG_COUNT(flags) * sizeof(record->args[0]));
+    record->flags = flags;
+    record->function = function;
+    record->target = target;
+
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+static void
+write_args(FILE *file, const struct trace_record *record)
+{
+    int count = EPOXY_INSTRUMENT_ARG_COUNT(record->flags);
+    int i;
+
+    fputs(",\"args\":{", file);
+    for (i = 0; i < count; i++) {
+        int position = EPOXY_INSTRUMENT_ARG_POSITION(record->flags, i);
+
+        fprintf(file, "%s\"arg%d\":", i ? "," : "", position);
+        if (EPOXY_INSTRUMENT_ARG_IS_FLOAT(record->flags, i)) {
+            union {
+                int64_t bits;
+                double value;
+            } u = { record->args[i] };
+
+            if (isfinite(u.value))
+                fprintf(file, "%.9g", u.value);
+            else
+                fprintf(file, "\"%g\"", u.value);
+        } else {
+            fprintf(file, "%lld", (long long)record->args[i]);
+        }
+    }
+    fputc('}', file);
+}
+
+/*
+ * Writes out the records of a ring that weren't flushed yet and ended
+ * at since_ns or later, returning the count of records written so far.
+ */
+static unsigned
+write_ring(FILE *file, struct trace_ring *ring, struct trace_record *copy,
+           uint64_t since_ns, unsigned written)
+{
+    uint64_t head, first, valid, index;
+
+    head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    first = ring->flushed;
+    if (head - first > trace_records)
+        first = head - trace_records;
+
+    for (index = first; index < head; index++)
+        copy[index - first] = ring->records[index & (trace_records - 1)];
+
+    /* The thread may have started overwriting the oldest of them
+     * meanwhile, which would leave them torn.
+     */
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    valid = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    ring->flushed = head;
+
+    for (index = first; index < head; index++) {
+        const struct trace_record *record = &copy[index - first];
+
+        if (index + trace_records <= valid || record->end_ns < since_ns)
+            continue;
+
+        fprintf(file, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+                "\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d",
+                written++ ? "," : "",
+                epoxy_instrument_function_name(record->target, record->function),
+                trace_categories[record->target],
+                record->start_ns / 1000.0,
+                (record->end_ns - record->start_ns) / 1000.0,
+                (int)getpid(), (int)ring->tid);
+        write_args(file, record);
+        fputc('}', file);
+    }
+
+    return written;
+}
+
+void
+epoxy_trace_init(void)
+{
+    const char *env;
+
+    env = getenv("EPOXY_TRACE_RECORDS");
+    if (env && atoi(env) > 0) {
+        unsigned records = atoi(env);
+
+        /* Rounded up to a power of two, so that indices just wrap. */
+        trace_records = 1;
+        while (trace_records < records && trace_records < (1u << 24))
+            trace_records <<= 1;
+    }
+
+    env = getenv("EPOXY_TRACE_OUT");
+    if (!env || !env[0])
+        return;
+
+    trace_out = strdup(env);
+    epoxy_trace_start();
+}
+
+void
+epoxy_trace_fini(void)
+{
+    if (trace_out && !epoxy_trace_flush(trace_out, 0))
+        fprintf(stderr, "Couldn't write the epoxy trace to %s\n", trace_out);
+}
+
+#else
+
+void
+epoxy_trace_init(void)
+{
+    const char *env = getenv("EPOXY_TRACE_OUT");
+
+    if (env && env[0])
+        fputs("EPOXY_TRACE_OUT isn't supported by this build of epoxy\n", stderr);
+}
+
+void
+epoxy_trace_fini(void)
+{
+}
+
+#endif /* USING_INSTRUMENTATION */
+
+/**
+ * @brief Starts recording the calls made through epoxy's function
+ * pointers, on every thread.
+ *
+ * Each thread keeps its latest calls, 4096 of them unless the
+ * EPOXY_TRACE_RECORDS environment variable says otherwise, until they
+ * get written out by epoxy_trace_flush().
+ *
+ * @return Whether this build of epoxy can trace calls, which it can't
+ * while the command queue or the shadow state run.
+ */
+bool
+epoxy_trace_start(void)
+{
+#if USING_INSTRUMENTATION
+    bool started = true;
+
+    pthread_mutex_lock(&trace_mutex);
+    if (!epoxy_tracing) {
+        __atomic_store_n(&epoxy_tracing, true, __ATOMIC_RELAXED);
+        started = epoxy_instrument(true);
+        if (!started)
+            __atomic_store_n(&epoxy_tracing, false, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&trace_mutex);
+
+    return started;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Stops recording calls, leaving the function pointers as they
+ * were before epoxy_trace_start().
+ *
+ * The calls recorded so far can still be flushed.
+ */
+void
+epoxy_trace_stop(void)
+{
+#if USING_INSTRUMENTATION
+    pthread_mutex_lock(&trace_mutex);
+    if (epoxy_tracing) {
+        __atomic_store_n(&epoxy_tracing, false, __ATOMIC_RELAXED);
+        if (!epoxy_stats_enabled)
+            epoxy_instrument(false);
+    }
+    pthread_mutex_unlock(&trace_mutex);
+#endif
+}
+
+/**
+ * @brief Writes the recorded calls that weren't flushed yet to a file,
+ * in the JSON trace event format of chrome://tracing and Perfetto.
+ *
+ * Tracing keeps going meanwhile.  Each call becomes a complete event
+ * named after the function, in the "gl", "egl" or "glx" category, with
+ * its integer and floating point arguments among the first few as
+ * "arg0", "arg1" and so on, numbered by their position.
+ *
+ * @param path The file to write, which gets replaced.
+ * @param last_ms If not 0, only the calls that ended within the last
+ * this many milliseconds get written out.
+ *
+ * @return Whether this build of epoxy can trace calls, and the file
+ * could be written.
+ */
+bool
+epoxy_trace_flush(const char *path, unsigned last_ms)
+{
+#if USING_INSTRUMENTATION
+    struct trace_record *copy;
+    struct trace_ring *ring;
+    uint64_t since_ns = 0;
+    unsigned written = 0;
+    FILE *file;
+    bool ok;
+
+    if (last_ms) {
+        uint64_t now = epoxy_instrument_now();
+
+        if (now > last_ms * UINT64_C(1000000))
+            since_ns = now - last_ms * UINT64_C(1000000);
+    }
+
+    copy = malloc(trace_records * sizeof(*copy));
+    if (!copy)
+        return false;
+
+    file = fopen(path, "w");
+    if (!file) {
+        free(copy);
+        return false;
+    }
+
+    pthread_mutex_lock(&trace_mutex);
+    fputs("{\"traceEvents\":[", file);
+    for (ring = epoxy_atomic_load_ptr(&trace_rings); ring; ring = ring->next)
+        written = write_ring(file, ring, copy, since_ns, written);
+    fputs("\n],\"displayTimeUnit\":\"ns\"}\n", file);
+    pthread_mutex_unlock(&trace_mutex);
+
+    ok = !ferror(file);
+    ok = fclose(file) == 0 && ok;
+    free(copy);
+
+    return ok;
+#else
+    (void)path;
+    (void)last_ms;
+    return false;
+#endif
+}
@@ -49,7 +49,13 @@ epoxy_conservative_has_wgl_extension(const char *ext)
 bool
 epoxy_has_wgl_extension(HDC hdc, const char *ext)
  {
-     PFNWGLGETEXTENSIONSSTRINGARBPROC getext;
+    const struct epoxy_extension_set *set = epoxy_find_extension_set(hdc, 0);
+    PFNWGLGETEXTENSIONSSTRINGARBPROC getext;
+    const char *extensions;
+    bool new_hdc;
+
+    if (set)
+        return epoxy_extension_set_has(set, ext);
 
      getext = (void *)wglGetProcAddress("wglGetExtensionsStringARB");
      if (!getext) {
@@ -59,7 +65,12 @@ epoxy_has_wgl_extension(HDC hdc, const char *ext)
          return false;
      }
 
-    return epoxy_extension_in_string(getext(hdc), ext);
+    extensions = getext(hdc);
+    set = epoxy_add_extension_set(hdc, 0, extensions, &new_hdc);
+    if (!set)
+        return epoxy_extension_in_string(extensions, ext);
+
+    return epoxy_extension_set_has(set, ext);
 }
 
 /**
@@ -190,7 +201,22 @@ WRAPPER(epoxy_wglMakeAssociatedContextCurrentAMD)(HGLRC hglrc)
     return ret;
 }
 
+/* There's nothing to tell when an HDC gets released and its handle
+ * reused for another device, so the extension sets of all of them are
+ * forgotten whenever a context goes away, which usually comes first.
+ */
+WRAPPER_VISIBILITY (BOOL)
+WRAPPER(epoxy_wglDeleteContext)(HGLRC hglrc)
+{
+    BOOL ret = epoxy_wglDeleteContext_unwrapped(hglrc);
+
+    epoxy_forget_extension_sets(NULL);
+
+    return ret;
+}
+
 PFNWGLMAKECURRENTPROC epoxy_wglMakeCurrent = epoxy_wglMakeCurrent_wrapped;
+PFNWGLDELETECONTEXTPROC epoxy_wglDeleteContext = epoxy_wglDeleteContext_wrapped;
 PFNWGLMAKECONTEXTCURRENTEXTPROC epoxy_wglMakeContextCurrentEXT = epoxy_wglMakeContextCurrentEXT_wrapped;
 PFNWGLMAKECONTEXTCURRENTARBPROC epoxy_wglMakeContextCurrentARB = epoxy_wglMakeContextCurrentARB_wrapped;
 PFNWGLMAKEASSOCIATEDCONTEXTCURRENTAMDPROC epoxy_wglMakeAssociatedContextCurrentEXT = epoxy_wglMakeAssociatedContextCurrentAMD_wrapped;
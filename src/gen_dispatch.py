@@ -28,6 +28,63 @@ import xml.etree.ElementTree as ET
 import re
 import os
 
+def name_hash(name, seed):
+    # Must match epoxy_name_hash() in dispatch_common.h (FNV-1a,
+    # with the seed mixed into the offset basis).
+    h = (2166136261 ^ seed) & 0xffffffff
+    for c in name.encode('ascii'):
+        h ^= c
+        h = (h * 16777619) & 0xffffffff
+    return h
+
+class PerfectHash(object):
+    # A hash-and-displace perfect hash over a list of names: the
+    # unseeded hash picks a bucket, and each bucket has a seed for a
+    # second hash that sends all of its names to distinct slots.
+    def __init__(self, names):
+        self.names = names
+
+        self.num_slots = 1
+        while self.num_slots < len(names):
+            self.num_slots *= 2
+
+        self.num_buckets = 1
+        while self.num_buckets * 4 < len(names):
+            self.num_buckets *= 2
+
+        # A table that's (nearly) full may have no room left for the
+        # last buckets, in which case it gets more slots.
+        while not self.place(names):
+            self.num_slots *= 2
+
+    def place(self, names):
+        buckets = [[] for b in range(self.num_buckets)]
+        for i, name in enumerate(names):
+            buckets[name_hash(name, 0) & (self.num_buckets - 1)].append(i)
+
+        # The slots hold index + 1, so that 0 means empty.
+        self.slots = [0] * self.num_slots
+        self.seeds = [0] * self.num_buckets
+
+        # Place the biggest buckets first, while there's the most room.
+        for b in sorted(range(self.num_buckets), key=lambda b: -len(buckets[b])):
+            if not buckets[b]:
+                continue
+
+            for seed in range(1, 65536):
+                slots = set(name_hash(names[i], seed) & (self.num_slots - 1)
+                            for i in buckets[b])
+                if len(slots) == len(buckets[b]) and not any(self.slots[slot] for slot in slots):
+                    break
+            else:
+                return False
+
+            self.seeds[b] = seed
+            for i in buckets[b]:
+                self.slots[name_hash(names[i], seed) & (self.num_slots - 1)] = i + 1
+
+        return True
+
 class GLProvider(object):
     def __init__(self, condition, condition_name, loader, name):
         # C code for determining if this function is available.
@@ -54,6 +111,32 @@ class GLProvider(object):
         self.enum = "PROVIDER_" + self.enum
 
 class GLFunction(object):
+    # Functions that our hand-written code wraps or calls through the
+    # generated pointers, which get generated even when the build
+    # leaves out everything that provides them.
+    required_functions = {
+        'glBegin',
+        'glEnd',
+        'glGetIntegerv',
+        'glGetString',
+        'glGetStringi',
+        'glXGetProcAddressARB',
+        'glXMakeCurrent',
+        'glXMakeContextCurrent',
+        'glXDestroyContext',
+        'eglMakeCurrent',
+        'eglBindAPI',
+        'eglReleaseThread',
+        'eglDestroyContext',
+        'eglTerminate',
+        'wglGetExtensionsStringARB',
+        'wglMakeCurrent',
+        'wglDeleteContext',
+        'wglMakeContextCurrentEXT',
+        'wglMakeContextCurrentARB',
+        'wglMakeAssociatedContextCurrentAMD',
+    }
+
     def __init__(self, ret_type, name):
         self.name = name
         self.ptr_type = 'PFN' + name.upper() + 'PROC'
@@ -67,7 +150,16 @@ class GLFunction(object):
         wrapped_functions = {
             'glBegin',
             'glEnd',
+            'glXMakeCurrent',
+            'glXMakeContextCurrent',
+            'glXDestroyContext',
+            'eglMakeCurrent',
+            'eglBindAPI',
+            'eglReleaseThread',
+            'eglDestroyContext',
+            'eglTerminate',
             'wglMakeCurrent',
+            'wglDeleteContext',
             'wglMakeContextCurrentEXT',
             'wglMakeContextCurrentARB',
             'wglMakeAssociatedContextCurrentAMD',
@@ -152,6 +244,12 @@ class GLFunction(object):
 class Generator(object):
     def __init__(self, target):
         self.target = target
+
+        # Whether the functions get per-context dispatch tables when
+        # USING_DISPATCH_TABLE.  The GLX and EGL entrypoints don't
+        # depend on the current context, so they always use globals.
+        self.dispatch_table = target in ('gl', 'wgl')
+
         self.enums = {}
         self.functions = {}
         self.sorted_functions = []
@@ -184,6 +282,26 @@ class Generator(object):
         # provided the name of the symbol to be requested.
         self.provider_loader = {}
 
+        # Dictionary mapping human-readable names of providers to the
+        # registry name of the feature or extension they come from,
+        # for resolving a feature's functions by name.
+        self.provider_feature = {}
+
+        # The functions that an app calls the most, hottest first,
+        # whose pointers and thunks get placed together.
+        self.hot_functions = []
+
+        # The subset of the registry to generate code for: the GL API
+        # ('gl', 'glcore', 'gles1' or 'gles2') and newest version to
+        # take GL features from, and the only extensions to take, or
+        # None for all of them.
+        self.gl_api = None
+        self.max_version = None
+        self.selected_extensions = None
+
+        # Commands that the core profile leaves out, for 'glcore'.
+        self.core_removed_functions = set()
+
     def all_text_until_element_name(self, element, element_name):
         text = ''
 
@@ -310,28 +428,127 @@ class Generator(object):
     def sort_functions(self):
         self.sorted_functions = sorted(self.functions.values(), key=lambda func: func.name)
 
-    def process_require_statements(self, feature, condition, loader, human_name):
-        for command in feature.findall('require/command'):
-            name = command.get('name')
-
-            # wgl.xml describes 6 functions in WGL 1.0 that are in
-            # gdi32.dll instead of opengl32.dll, and we would need to
-            # change up our symbol loading to support that.  Just
-            # don't wrap those functions.
-            if self.target == 'wgl' and 'wgl' not in name:
-                del self.functions[name]
+    def load_hot_functions(self, path):
+        # Reads a call-frequency profile: a function name per line,
+        # optionally followed by a call count.  With counts, the most
+        # called functions are the hottest, and otherwise the ones that
+        # come first.  Names from other APIs are skipped.
+        entries = []
+        with open(path) as f:
+            for line in f:
+                fields = line.split('#')[0].split()
+                if not fields or fields[0] not in self.functions:
+                    continue
+                count = int(fields[1]) if len(fields) > 1 else 0
+                entries.append((-count, len(entries), fields[0]))
+
+        names = []
+        for count, index, name in sorted(entries):
+            if name not in names:
+                names.append(name)
+
+        # Two cache lines' worth of pointers is as much as the draw
+        # path should need.
+        self.hot_functions = [self.functions[name] for name in names[:16]]
+
+    def subsetting(self):
+        return (self.gl_api is not None or self.max_version is not None or
+                self.selected_extensions is not None)
+
+    def load_extension_list(self, path):
+        # Reads the list of extensions to generate code for, one name
+        # per line.  It only restricts the extensions of the APIs that
+        # it names any extensions of, so a list of GL extensions
+        # doesn't drop the EGL or GLX ones.
+        names = set()
+        with open(path) as f:
+            for line in f:
+                fields = line.split('#')[0].split()
+                if fields:
+                    names.add(fields[0])
+
+        prefix = self.target.upper() + '_'
+        if self.target == 'glx':
+            prefix = 'GLX_'
+        if any(name.startswith(prefix) for name in names):
+            self.selected_extensions = names
+
+    def feature_selected(self, api, version):
+        if api not in ('gl', 'gles1', 'gles2'):
+            return True
+        if self.gl_api is not None and api != self.gl_api.replace('glcore', 'gl'):
+            return False
+        return self.max_version is None or version <= self.max_version
+
+    def extension_selected(self, extname, apis):
+        if self.gl_api is not None and {'gl', 'gles1', 'gles2'}.intersection(apis):
+            if self.gl_api not in apis:
+                return False
+        return self.selected_extensions is None or extname in self.selected_extensions
+
+    def process_require_statements(self, feature, condition, loader, human_name,
+                                   selected=True):
+        for require in feature.findall('require'):
+            # The core profile doesn't have these, and neither do
+            # the functions it removes.
+            core_only = self.gl_api == 'glcore'
+            if core_only and require.get('profile') == 'compatibility':
                 continue
 
-            func = self.functions[name]
-            func.add_provider(condition, loader, human_name)
+            for command in require.findall('command'):
+                name = command.get('name')
+
+                # wgl.xml describes 6 functions in WGL 1.0 that are in
+                # gdi32.dll instead of opengl32.dll, and we would need to
+                # change up our symbol loading to support that.  Just
+                # don't wrap those functions.
+                if self.target == 'wgl' and 'wgl' not in name:
+                    if name in self.functions:
+                        del self.functions[name]
+                    continue
+
+                # Left out of this build, unless our own code needs it.
+                if not selected or (core_only and name in self.core_removed_functions):
+                    if name not in GLFunction.required_functions:
+                        continue
+
+                func = self.functions[name]
+                func.add_provider(condition, loader, human_name)
+                self.provider_feature[human_name] = feature.get('name')
+
+    def drop_unselected_functions(self):
+        # When generating a subset of the registry, leaves out the
+        # functions that nothing selected provides, but keeps the
+        # functions that those which are kept are aliases of.
+        if not self.subsetting():
+            return
+
+        keep = set()
+        for name, func in self.functions.items():
+            if not func.providers and name not in GLFunction.required_functions:
+                continue
+            while True:
+                keep.add(func.name)
+                if func.alias_name == func.name or func.alias_name not in self.functions:
+                    break
+                func = self.functions[func.alias_name]
+
+        for name in list(self.functions.keys()):
+            if name not in keep:
+                del self.functions[name]
 
     def parse_function_providers(self, reg):
+        for command in reg.findall('feature/remove[@profile="core"]/command'):
+            self.core_removed_functions.add(command.get('name'))
+
         for feature in reg.findall('feature'):
             api = feature.get('api') # string gl, gles1, gles2, glx
             m = re.match(r'([0-9])\.([0-9])', feature.get('number'))
             version = int(m.group(1)) * 10 + int(m.group(2))
 
-            self.supported_versions.add(feature.get('name'))
+            selected = self.feature_selected(api, version)
+            if selected:
+                self.supported_versions.add(feature.get('name'))
 
             if api == 'gl':
                 human_name = 'Desktop OpenGL {0}'.format(feature.get('number'))
@@ -381,34 +598,42 @@ class Generator(object):
             else:
                 sys.exit('unknown API: "{0}"'.format(api))
 
-            self.process_require_statements(feature, condition, loader, human_name)
+            self.process_require_statements(feature, condition, loader, human_name, selected)
 
         for extension in reg.findall('extensions/extension'):
             extname = extension.get('name')
             cond_extname = "enum_string[enum_string_offsets[i]]"
 
-            self.supported_extensions.add(extname)
-
             # 'supported' is a set of strings like gl, gles1, gles2,
             # or glx, which are separated by '|'
             apis = extension.get('supported').split('|')
+
+            selected = self.extension_selected(extname, apis)
+            if selected:
+                self.supported_extensions.add(extname)
+
             if 'glx' in apis:
                 condition = 'epoxy_conservative_has_glx_extension(provider_name)'
                 loader = 'glXGetProcAddress((const GLubyte *){0})'
-                self.process_require_statements(extension, condition, loader, extname)
+                self.process_require_statements(extension, condition, loader, extname, selected)
             if 'egl' in apis:
                 condition = 'epoxy_conservative_has_egl_extension(provider_name)'
                 loader = 'eglGetProcAddress({0})'
-                self.process_require_statements(extension, condition, loader, extname)
+                self.process_require_statements(extension, condition, loader, extname, selected)
             if 'wgl' in apis:
                 condition = 'epoxy_conservative_has_wgl_extension(provider_name)'
                 loader = 'wglGetProcAddress({0})'
-                self.process_require_statements(extension, condition, loader, extname)
-            if {'gl', 'gles1', 'gles2'}.intersection(apis):
-                condition = 'epoxy_conservative_has_gl_extension(provider_name)'
+                self.process_require_statements(extension, condition, loader, extname, selected)
+            # The GL extension conditions need an extension ID, and our
+            # own code doesn't need any GL extension's functions.
+            if selected and {'gl', 'gles1', 'gles2'}.intersection(apis):
+                condition = 'epoxy_conservative_has_gl_extension_id({0})'.format(self.extension_enum(extname))
                 loader = 'epoxy_get_proc_address({0})'
                 self.process_require_statements(extension, condition, loader, extname)
 
+    def extension_enum(self, extname):
+        return 'EXTENSION_' + extname
+
     def fixup_bootstrap_function(self, name, loader):
         # We handle glGetString(), glGetIntegerv(), and
         # glXGetProcAddressARB() specially, because we need to use
@@ -552,14 +777,23 @@ class Generator(object):
                                                                                    func.args_decl))
             self.outln('')
 
+        # GL callers may ask for the entrypoints that ENABLE_IFUNC
+        # builds export, instead of the pointers.
+        if self.target == 'gl':
+            self.outln('#ifdef EPOXY_GL_IFUNC')
+            for func in self.sorted_functions:
+                self.outln('EPOXY_PUBLIC {0} EPOXY_CALLSPEC {1}({2});'.format(func.ret_type,
+                                                                          func.name,
+                                                                          func.args_decl))
+            self.outln('#else')
+
         for func in self.sorted_functions:
             self.outln('#define {0} epoxy_{0}'.format(func.name))
 
-    def write_function_ptr_resolver(self, func):
-        self.outln('static {0}'.format(func.ptr_type))
-        self.outln('epoxy_{0}_resolver(void)'.format(func.wrapped_name))
-        self.outln('{')
+        if self.target == 'gl':
+            self.outln('#endif /* !EPOXY_GL_IFUNC */')
 
+    def function_providers(self, func):
         providers = []
         # Make a local list of all the providers for this alias group
         alias_root = func
@@ -584,7 +818,7 @@ class Generator(object):
             'glBindRenderbuffer' : 'glBindRenderbufferEXT',
             'glBindRenderbufferEXT' : 'glBindRenderbuffer',
         }
-        if func.name in half_aliases:
+        if func.name in half_aliases and half_aliases[func.name] in self.functions:
             alias_func = self.functions[half_aliases[func.name]]
             for provider in alias_func.providers.values():
                 providers.append(provider)
@@ -593,34 +827,63 @@ class Generator(object):
             return (provider.name != func.name, provider.name, provider.enum)
         providers.sort(key=provider_sort)
 
-        if len(providers) != 1:
-            self.outln('    static const enum {0}_provider providers[] = {{'.format(self.target))
-            for provider in providers:
-                self.outln('        {0},'.format(provider.enum))
-            self.outln('        {0}_provider_terminator'.format(self.target))
-            self.outln('    };')
-
-            self.outln('    static const uint32_t entrypoints[] = {')
-            if len(providers) > 1:
-                for provider in providers:
-                    self.outln('        {0} /* "{1}" */,'.format(self.entrypoint_string_offset[provider.name], provider.name))
-            else:
-                self.outln('        0 /* None */,')
-            self.outln('    };')
+        return providers
 
-            self.outln('    return {0}_provider_resolver(entrypoint_strings + {1} /* "{2}" */,'.format(self.target,
-                                                                                                       self.entrypoint_string_offset[func.name],
-                                                                                                       func.name))
-            self.outln('                                providers, entrypoints);')
-        else:
-            assert providers[0].name == func.name
-            self.outln('    return {0}_single_resolver({1}, {2} /* {3} */);'.format(self.target,
-                                                                                    providers[0].enum,
-                                                                                    self.entrypoint_string_offset[func.name],
-                                                                                    func.name))
-        self.outln('}')
+    def function_enum(self, func):
+        return 'FUNCTION_' + func.name
+
+    def write_function_tables(self):
+        # Writes the enum of function IDs, and the provider lists of
+        # every function packed into two parallel arrays: the
+        # providers of a function, ending in the terminator, and the
+        # functions whose names to load from each of them.  Keeping
+        # these in tables instead of inside each resolver lets a
+        # single resolver, and the eager resolution code, walk them.
+        self.outln('enum {0}_function {{'.format(self.target))
+        for func in self.sorted_functions:
+            self.outln('    {0},'.format(self.function_enum(func)))
+        self.outln('};')
+        self.outln('')
+        self.outln('const int {0}_function_count = {1};'.format(self.target, len(self.sorted_functions)))
         self.outln('')
 
+        self.write_table('uint32_t', '{0}_function_names'.format(self.target),
+                         [self.entrypoint_string_offset[func.name] for func in self.sorted_functions])
+
+        offsets = []
+        offset = 0
+        assert len(self.provider_enum) < 65536
+        self.outln('static const uint16_t {0}_providers[] = {{'.format(self.target))
+        for func in self.sorted_functions:
+            providers = self.function_providers(func)
+            # In a subset, a function may be kept only because one of
+            # its aliases is provided.
+            if len(providers) == 1 and not self.subsetting():
+                assert providers[0].name == func.name
+            offsets.append(offset)
+            offset += len(providers) + 1
+            self.outln('    {0}, /* {1} */'.format(', '.join([provider.enum for provider in providers] +
+                                                             ['{0}_provider_terminator'.format(self.target)]),
+                                                   func.name))
+        self.outln('};')
+        self.outln('')
+        # We're using uint16_t for the offsets.
+        assert offset < 65536
+
+        # The names are the functions' own, so these are just function
+        # IDs.
+        assert len(self.sorted_functions) < 65536
+        self.outln('static const uint16_t {0}_provider_entrypoints[] = {{'.format(self.target))
+        for func in self.sorted_functions:
+            providers = self.function_providers(func)
+            self.outln('    {0}, /* {1} */'.format(', '.join([self.function_enum(self.functions[provider.name])
+                                                              for provider in providers] + ['0']),
+                                                   func.name))
+        self.outln('};')
+        self.outln('')
+
+        self.write_table('uint16_t', '{0}_function_provider_offsets'.format(self.target), offsets)
+
     def write_thunks(self, func):
         # Writes out the function that's initially plugged into the
         # global function pointer, which resolves, updates the global
@@ -628,18 +891,331 @@ class Generator(object):
         #
         # It also writes out the actual initialized global function
         # pointer.
+        if not self.dispatch_table:
+            thunks = 'GEN_GLOBAL_THUNKS'
+        elif func in self.hot_functions:
+            thunks = 'GEN_HOT_THUNKS'
+        else:
+            thunks = 'GEN_THUNKS'
+
         if func.ret_type == 'void':
-            self.outln('GEN_THUNKS({0}, ({1}), ({2}))'.format(func.wrapped_name,
-                                                              func.args_decl,
-                                                              func.args_list))
+            self.outln('{0}({1}, {2}, ({3}), ({4}))'.format(thunks,
+                                                            func.wrapped_name,
+                                                            self.function_enum(func),
+                                                            func.args_decl,
+                                                            func.args_list))
         else:
-            self.outln('GEN_THUNKS_RET({0}, {1}, ({2}), ({3}))'.format(func.ret_type,
-                                                                       func.wrapped_name,
-                                                                       func.args_decl,
-                                                                       func.args_list))
+            self.outln('{0}_RET({1}, {2}, {3}, ({4}), ({5}))'.format(thunks,
+                                                                     func.ret_type,
+                                                                     func.wrapped_name,
+                                                                     self.function_enum(func),
+                                                                     func.args_decl,
+                                                                     func.args_list))
+
+    # The calls that end a frame, as far as the statistics go.
+    frame_functions = {
+        'eglSwapBuffers',
+        'eglSwapBuffersWithDamageEXT',
+        'eglSwapBuffersWithDamageKHR',
+        'glXSwapBuffers',
+    }
+
+    # The window system functions that the command queue runs on its
+    # thread, along with GL.
+    queued_window_system_functions = {
+        'eglSwapBuffers',
+        'eglSwapBuffersWithDamageEXT',
+        'eglSwapBuffersWithDamageKHR',
+        'eglSwapInterval',
+        'glXSwapBuffers',
+        'glXSwapIntervalEXT',
+        'glXSwapIntervalMESA',
+        'glXSwapIntervalSGI',
+    }
+
+    # The queued calls that wait for their turn to run anyway, and the
+    # ones after which the thread gets to see what was queued.
+    queue_sync_functions = {
+        'glFinish',
+    }
+    queue_flush_functions = {
+        'glFlush',
+    }
+    # Draws that take nothing but numbers still read the client-side
+    # arrays that are enabled, which may be changed as soon as they
+    # return, so they wait too.
+    queue_sync_draw_pattern = re.compile(r'gl(Multi)?Draw(Arrays|Elements|RangeElement|'
+                                         r'ElementArray|TransformFeedback|MeshArrays)|'
+                                         r'glArrayElement|glLockArrays')
+
+    # The GL functions that the shadow state keeps track of, with what
+    # they do as far as it's concerned.  The ones that it doesn't model
+    # just make it forget what they may change, and so do the ones after
+    # which binding a name may succeed where it failed before.
+    shadow_calls = {
+        'glEnable': 'EPOXY_SHADOW_ENABLE',
+        'glDisable': 'EPOXY_SHADOW_DISABLE',
+        'glActiveTexture': 'EPOXY_SHADOW_ACTIVE_TEXTURE',
+        'glActiveTextureARB': 'EPOXY_SHADOW_ACTIVE_TEXTURE',
+        'glBindTexture': 'EPOXY_SHADOW_BIND_TEXTURE',
+        'glBindTextureEXT': 'EPOXY_SHADOW_BIND_TEXTURE',
+        'glBindBuffer': 'EPOXY_SHADOW_BIND_BUFFER',
+        'glBindBufferARB': 'EPOXY_SHADOW_BIND_BUFFER',
+        'glUseProgram': 'EPOXY_SHADOW_USE_PROGRAM',
+        'glBlendFunc': 'EPOXY_SHADOW_BLEND_FUNC',
+        'glBlendFuncSeparate': 'EPOXY_SHADOW_BLEND_FUNC_SEPARATE',
+        'glBlendFuncSeparateEXT': 'EPOXY_SHADOW_BLEND_FUNC_SEPARATE',
+        'glBlendFuncSeparateINGR': 'EPOXY_SHADOW_BLEND_FUNC_SEPARATE',
+        'glBlendFuncSeparateOES': 'EPOXY_SHADOW_BLEND_FUNC_SEPARATE',
+
+        'glEnablei': 'EPOXY_SHADOW_INDEXED_CAP',
+        'glDisablei': 'EPOXY_SHADOW_INDEXED_CAP',
+        'glEnableIndexedEXT': 'EPOXY_SHADOW_INDEXED_CAP',
+        'glDisableIndexedEXT': 'EPOXY_SHADOW_INDEXED_CAP',
+        'glEnableiEXT': 'EPOXY_SHADOW_INDEXED_CAP',
+        'glDisableiEXT': 'EPOXY_SHADOW_INDEXED_CAP',
+        'glEnableiNV': 'EPOXY_SHADOW_INDEXED_CAP',
+        'glDisableiNV': 'EPOXY_SHADOW_INDEXED_CAP',
+        'glEnableiOES': 'EPOXY_SHADOW_INDEXED_CAP',
+        'glDisableiOES': 'EPOXY_SHADOW_INDEXED_CAP',
+        'glBlendFunci': 'EPOXY_SHADOW_INDEXED_BLEND_FUNC',
+        'glBlendFunciARB': 'EPOXY_SHADOW_INDEXED_BLEND_FUNC',
+        'glBlendFunciEXT': 'EPOXY_SHADOW_INDEXED_BLEND_FUNC',
+        'glBlendFunciOES': 'EPOXY_SHADOW_INDEXED_BLEND_FUNC',
+        'glBlendFuncIndexedAMD': 'EPOXY_SHADOW_INDEXED_BLEND_FUNC',
+        'glBlendFuncSeparatei': 'EPOXY_SHADOW_INDEXED_BLEND_FUNC',
+        'glBlendFuncSeparateiARB': 'EPOXY_SHADOW_INDEXED_BLEND_FUNC',
+        'glBlendFuncSeparateiEXT': 'EPOXY_SHADOW_INDEXED_BLEND_FUNC',
+        'glBlendFuncSeparateiOES': 'EPOXY_SHADOW_INDEXED_BLEND_FUNC',
+        'glBlendFuncSeparateIndexedAMD': 'EPOXY_SHADOW_INDEXED_BLEND_FUNC',
+        'glBindTextures': 'EPOXY_SHADOW_TEXTURES',
+        'glBindTextureUnit': 'EPOXY_SHADOW_TEXTURES',
+        'glBindMultiTextureEXT': 'EPOXY_SHADOW_TEXTURES',
+        'glBindBufferBase': 'EPOXY_SHADOW_BUFFERS',
+        'glBindBufferBaseEXT': 'EPOXY_SHADOW_BUFFERS',
+        'glBindBufferBaseNV': 'EPOXY_SHADOW_BUFFERS',
+        'glBindBufferRange': 'EPOXY_SHADOW_BUFFERS',
+        'glBindBufferRangeEXT': 'EPOXY_SHADOW_BUFFERS',
+        'glBindBufferRangeNV': 'EPOXY_SHADOW_BUFFERS',
+        'glBindBufferOffsetEXT': 'EPOXY_SHADOW_BUFFERS',
+        'glBindBufferOffsetNV': 'EPOXY_SHADOW_BUFFERS',
+        'glBindBuffersBase': 'EPOXY_SHADOW_BUFFERS',
+        'glBindBuffersRange': 'EPOXY_SHADOW_BUFFERS',
+        'glBindVertexArray': 'EPOXY_SHADOW_VERTEX_ARRAY',
+        'glBindVertexArrayAPPLE': 'EPOXY_SHADOW_VERTEX_ARRAY',
+        'glBindVertexArrayOES': 'EPOXY_SHADOW_VERTEX_ARRAY',
+        'glDeleteVertexArrays': 'EPOXY_SHADOW_VERTEX_ARRAY',
+        'glDeleteVertexArraysAPPLE': 'EPOXY_SHADOW_VERTEX_ARRAY',
+        'glDeleteVertexArraysOES': 'EPOXY_SHADOW_VERTEX_ARRAY',
+        'glUseProgramObjectARB': 'EPOXY_SHADOW_PROGRAM',
+        'glEndTransformFeedback': 'EPOXY_SHADOW_PROGRAM',
+        'glEndTransformFeedbackEXT': 'EPOXY_SHADOW_PROGRAM',
+        'glEndTransformFeedbackNV': 'EPOXY_SHADOW_PROGRAM',
+        'glGenTextures': 'EPOXY_SHADOW_OBJECTS',
+        'glGenTexturesEXT': 'EPOXY_SHADOW_OBJECTS',
+        'glCreateTextures': 'EPOXY_SHADOW_OBJECTS',
+        'glDeleteTextures': 'EPOXY_SHADOW_OBJECTS',
+        'glDeleteTexturesEXT': 'EPOXY_SHADOW_OBJECTS',
+        'glGenBuffers': 'EPOXY_SHADOW_OBJECTS',
+        'glGenBuffersARB': 'EPOXY_SHADOW_OBJECTS',
+        'glCreateBuffers': 'EPOXY_SHADOW_OBJECTS',
+        'glDeleteBuffers': 'EPOXY_SHADOW_OBJECTS',
+        'glDeleteBuffersARB': 'EPOXY_SHADOW_OBJECTS',
+        'glLinkProgram': 'EPOXY_SHADOW_OBJECTS',
+        'glLinkProgramARB': 'EPOXY_SHADOW_OBJECTS',
+        'glProgramBinary': 'EPOXY_SHADOW_OBJECTS',
+        'glProgramBinaryOES': 'EPOXY_SHADOW_OBJECTS',
+        'glDeleteProgram': 'EPOXY_SHADOW_OBJECTS',
+        'glDeleteObjectARB': 'EPOXY_SHADOW_OBJECTS',
+        'glNewList': 'EPOXY_SHADOW_NEW_LIST',
+        'glEndList': 'EPOXY_SHADOW_END_LIST',
+        'glCallList': 'EPOXY_SHADOW_ALL',
+        'glCallLists': 'EPOXY_SHADOW_ALL',
+        'glPopAttrib': 'EPOXY_SHADOW_ALL',
+        'glPopClientAttrib': 'EPOXY_SHADOW_ALL',
+    }
+
+    # The GL queries that the query cache, or the shadow state, may be
+    # able to answer, with the hooks that answer them.
+    shadow_queries = {
+        'glGetString': 'epoxy_query_cache_get_string',
+        'glGetStringi': 'epoxy_query_cache_get_stringi',
+        'glGetIntegerv': 'epoxy_query_cache_get_integerv',
+        'glIsEnabled': 'epoxy_shadow_state_is_enabled',
+    }
+
+    # The argument types that the instrumented thunks pass on to the
+    # hooks, as integers or as floating point.
+    instrumented_int_types = {
+        'Bool', 'Colormap', 'EGLAttrib', 'EGLBoolean', 'EGLenum', 'EGLint',
+        'EGLNativeFileDescriptorKHR', 'EGLnsecsANDROID', 'EGLTime',
+        'EGLTimeKHR', 'EGLTimeNV', 'EGLuint64KHR', 'Font', 'GLbitfield',
+        'GLboolean', 'GLbyte', 'GLclampx', 'GLenum', 'GLfixed', 'GLhalfNV',
+        'GLint', 'GLint64', 'GLint64EXT', 'GLintptr', 'GLintptrARB',
+        'GLshort', 'GLsizei', 'GLsizeiptr', 'GLsizeiptrARB', 'GLubyte',
+        'GLuint', 'GLuint64', 'GLuint64EXT', 'GLushort', 'GLvdpauSurfaceNV',
+        'GLXContextID', 'GLXDrawable', 'GLXPbuffer', 'GLXPixmap',
+        'GLXWindow', 'int', 'int64_t', 'Pixmap', 'unsigned int',
+        'unsigned long', 'Window',
+    }
+    instrumented_float_types = {
+        'float', 'GLclampd', 'GLclampf', 'GLdouble', 'GLfloat',
+    }
+
+    def instrumented_args(self, func):
+        # Returns the flags describing the arguments an instrumented
+        # thunk passes on, with the frame flag, and the values to pass.
+        flags = 1 if func.name in self.frame_functions else 0
+        values = []
+        for position, (arg_type, arg_name) in enumerate(func.args[:8]):
+            if len(values) == 4:
+                break
+            if arg_type in self.instrumented_int_types:
+                flags |= position << (4 + 4 * len(values))
+                values.append('(int64_t){0}'.format(arg_name))
+            elif arg_type in self.instrumented_float_types:
+                flags |= (position | 8) << (4 + 4 * len(values))
+                values.append('epoxy_instrument_float({0})'.format(arg_name))
+        flags |= len(values) << 1
+
+        return '0x{0:x}'.format(flags), ', '.join(values) or '0'
+
+    def queued_functions(self):
+        # The functions that the command queue runs on its thread: all
+        # of GL, and the window system functions that act on the
+        # current context.
+        if self.target == 'gl':
+            return self.sorted_functions
+        return [func for func in self.sorted_functions
+                if func.name in self.queued_window_system_functions]
+
+    def queued_flags(self, func):
+        # Calls that return something, or that pass pointers to memory
+        # that may get reused as soon as they return, have to wait for
+        # their turn to run.  The rest just get queued.
+        if func.name in self.queue_flush_functions:
+            return 'EPOXY_QUEUE_FLUSH'
+        if (func.ret_type != 'void' or func.name in self.queue_sync_functions or
+            self.queue_sync_draw_pattern.match(func.name)):
+            return 'EPOXY_QUEUE_SYNC'
+        for arg_type, arg_name in func.args:
+            if (arg_type not in self.instrumented_int_types and
+                arg_type not in self.instrumented_float_types):
+                return 'EPOXY_QUEUE_SYNC'
+        return '0'
+
+    def shadowed_functions(self):
+        # The functions that the shadow state and the query cache have
+        # thunks for, all of them in GL.
+        if self.target != 'gl':
+            return []
+        return [func for func in self.sorted_functions
+                if func.name in self.shadow_calls or func.name in self.shadow_queries]
+
+    def write_interposed_thunks(self):
+        # Writes out the thunks that the statistics and tracing modes,
+        # the command queue and the shadow state put into the global
+        # function pointers, which call through a slot of their own.
+        # That slot then stands in for the global pointer everywhere
+        # public_pointer() is used, so it's what gets resolved.
+        self.outln('#if USING_INTERPOSERS')
+        self.outln('static void *interposed_targets[{0}];'.format(len(self.sorted_functions)))
+        self.outln('static long interposed;')
+        self.outln('#endif')
+        self.outln('')
+
+        self.outln('#if USING_INSTRUMENTATION')
+        self.outln('#define INSTRUMENTED_TARGET EPOXY_TARGET_{0}'.format(self.target.upper()))
+        self.outln('')
+        for func in self.sorted_functions:
+            flags, values = self.instrumented_args(func)
+            if func.ret_type == 'void':
+                self.outln('GEN_INSTRUMENTED_THUNK(epoxy_{0}, {1}, {2}, ({3}), ({4}), ({5}))'.format(func.wrapped_name,
+                                                                                                     self.function_enum(func),
+                                                                                                     flags,
+                                                                                                     func.args_decl,
+                                                                                                     func.args_list,
+                                                                                                     values))
+            else:
+                self.outln('GEN_INSTRUMENTED_THUNK_RET({0}, epoxy_{1}, {2}, {3}, ({4}), ({5}), ({6}))'.format(func.ret_type,
+                                                                                                              func.wrapped_name,
+                                                                                                              self.function_enum(func),
+                                                                                                              flags,
+                                                                                                              func.args_decl,
+                                                                                                              func.args_list,
+                                                                                                              values))
+        self.outln('#endif /* USING_INSTRUMENTATION */')
+        self.outln('')
+
+        # The queued calls carry their arguments in a struct, which is
+        # copied into the queue, or for the calls that wait for their
+        # turn, handed over from the stack.
+        self.outln('#if USING_QUEUE')
+        for func in self.queued_functions():
+            members = ' '.join('{0} {1};'.format(arg_type, arg_name) for arg_type, arg_name in func.args)
+            replay_args = ', '.join('{0}queued->{1}'.format('(uintptr_t)' if arg_type == 'GLhandleARB' else '',
+                                                           arg_name)
+                                    for arg_type, arg_name in func.args)
+            if func.ret_type == 'void':
+                self.outln('GEN_QUEUED_THUNK(epoxy_{0}, {1}, {2}, ({3}), ({4}), {5}, ({6}), ({7}))'.format(func.wrapped_name,
+                                                                                                           self.function_enum(func),
+                                                                                                           self.queued_flags(func),
+                                                                                                           func.args_decl,
+                                                                                                           func.args_list,
+                                                                                                           members or 'char unused;',
+                                                                                                           func.args_list or '0',
+                                                                                                           replay_args))
+            else:
+                self.outln('GEN_QUEUED_THUNK_RET({0}, epoxy_{1}, {2}, ({3}), ({4}), {5}, ({6}), ({7}))'.format(func.ret_type,
+                                                                                                               func.wrapped_name,
+                                                                                                               self.function_enum(func),
+                                                                                                               func.args_decl,
+                                                                                                               func.args_list,
+                                                                                                               members,
+                                                                                                               func.args_list or '0',
+                                                                                                               replay_args))
+        self.outln('#endif /* USING_QUEUE */')
+        self.outln('')
+
+        shadowed = self.shadowed_functions()
+        if shadowed:
+            self.outln('#if USING_SHADOW_STATE')
+            for func in shadowed:
+                if func.name in self.shadow_queries:
+                    if func.ret_type == 'void':
+                        self.outln('GEN_SHADOWED_QUERY_THUNK(epoxy_{0}, {1}, ({2}), ({3}), {4})'.format(func.wrapped_name,
+                                                                                                        self.function_enum(func),
+                                                                                                        func.args_decl,
+                                                                                                        func.args_list,
+                                                                                                        self.shadow_queries[func.name]))
+                    else:
+                        self.outln('GEN_SHADOWED_QUERY_THUNK_RET({0}, epoxy_{1}, {2}, ({3}), ({4}), {5})'.format(func.ret_type,
+                                                                                                                 func.wrapped_name,
+                                                                                                                 self.function_enum(func),
+                                                                                                                 func.args_decl,
+                                                                                                                 func.args_list,
+                                                                                                                 self.shadow_queries[func.name]))
+                    continue
+
+                values = ', '.join('(uint32_t){0}'.format(arg_name)
+                                   for arg_type, arg_name in func.args
+                                   if arg_type in self.instrumented_int_types)
+                self.outln('GEN_SHADOWED_THUNK(epoxy_{0}, {1}, {2}, ({3}), ({4}), ({5}))'.format(func.wrapped_name,
+                                                                                                 self.function_enum(func),
+                                                                                                 self.shadow_calls[func.name],
+                                                                                                 func.args_decl,
+                                                                                                 func.args_list,
+                                                                                                 values or '0'))
+            self.outln('#endif /* USING_SHADOW_STATE */')
+            self.outln('')
 
     def write_function_pointer(self, func):
-        self.outln('{0} epoxy_{1} = epoxy_{1}_global_rewrite_ptr;'.format(func.ptr_type, func.wrapped_name))
+        if func in self.hot_functions:
+            self.outln('{0} epoxy_{1} EPOXY_HOT_DATA = epoxy_{1}_global_rewrite_ptr;'.format(func.ptr_type,
+                                                                                            func.wrapped_name))
+        else:
+            self.outln('{0} epoxy_{1} = epoxy_{1}_global_rewrite_ptr;'.format(func.ptr_type, func.wrapped_name))
+        self.outln('LOCAL_ALIAS({0}, epoxy_{1})'.format(func.ptr_type, func.wrapped_name))
         self.outln('')
 
     def write_provider_enums(self):
@@ -658,6 +1234,9 @@ class Generator(object):
         for human_name in sorted_providers:
             enum = self.provider_enum[human_name]
             self.outln('    {0},'.format(enum))
+
+        # And a count last, for sizing the per-context provider cache.
+        self.outln('    {0}_provider_count'.format(self.target))
         self.outln('} PACKED;')
         self.outln('ENDPACKED')
         self.outln('')
@@ -669,7 +1248,7 @@ class Generator(object):
         sorted_providers = sorted(self.provider_enum.keys())
 
         offset = 0
-        self.outln('static const char *enum_string =')
+        self.outln('static const char enum_string[] =')
         for human_name in sorted_providers:
             self.outln('    "{0}\\0"'.format(human_name))
             self.enum_string_offset[human_name] = offset
@@ -702,33 +1281,223 @@ class Generator(object):
         #assert(offset < 65536)
         self.outln('')
 
-    def write_provider_resolver(self):
-        self.outln('static void *{0}_provider_resolver(const char *name,'.format(self.target))
-        self.outln('                                   const enum {0}_provider *providers,'.format(self.target))
-        self.outln('                                   const uint32_t *entrypoints)')
+    def write_provider_available(self):
+        # Writes the function evaluating whether a provider is present
+        # in the current context.  The answers get remembered per
+        # context, since evaluating the conditions means round trips
+        # to the driver.
+        self.outln('static bool')
+        self.outln('{0}_provider_available(enum {0}_provider provider)'.format(self.target))
         self.outln('{')
-        self.outln('    int i;')
+        if any('provider_name' in condition for condition in self.provider_condition.values()):
+            self.outln('    const char *provider_name = enum_string + enum_string_offsets[provider];')
+        self.outln('    uint8_t *cache;')
+        self.outln('    bool available;')
+        self.outln('')
 
-        self.outln('    for (i = 0; providers[i] != {0}_provider_terminator; i++) {{'.format(self.target))
-        self.outln('        const char *provider_name = enum_string + enum_string_offsets[providers[i]];')
-        self.outln('        switch (providers[i]) {')
+        # Unconditional providers don't need to look at the context,
+        # which also keeps the functions used for finding the current
+        # context from recursing into here.
+        self.outln('    switch (provider) {')
+        for human_name in sorted(self.provider_enum.keys()):
+            if self.provider_condition[human_name] == 'true':
+                self.outln('    case {0}:'.format(self.provider_enum[human_name]))
+        self.outln('        return true;')
+        self.outln('    default:')
+        self.outln('        break;')
+        self.outln('    }')
         self.outln('')
 
+        self.outln('    cache = epoxy_context_provider_cache(EPOXY_TARGET_{0}, {1}_provider_count);'.format(self.target.upper(),
+                                                                                                        self.target))
+        self.outln('    if (cache && cache[provider] != EPOXY_PROVIDER_UNKNOWN)')
+        self.outln('        return cache[provider] == EPOXY_PROVIDER_PRESENT;')
+        self.outln('')
+
+        self.outln('    switch (provider) {')
+        for human_name in sorted(self.provider_enum.keys()):
+            if self.provider_condition[human_name] == 'true':
+                continue
+            self.outln('    case {0}:'.format(self.provider_enum[human_name]))
+            self.outln('        available = {0};'.format(self.provider_condition[human_name]))
+            self.outln('        break;')
+        self.outln('    default:')
+        self.outln('        abort(); /* Not reached */')
+        self.outln('    }')
+        self.outln('')
+
+        self.outln('    if (cache)')
+        self.outln('        cache[provider] = available ? EPOXY_PROVIDER_PRESENT : EPOXY_PROVIDER_ABSENT;')
+        self.outln('')
+        self.outln('    return available;')
+        self.outln('}')
+        self.outln('')
+
+    def write_table(self, ctype, name, values):
+        self.outln('static const {0} {1}[] = {{'.format(ctype, name))
+        for i in range(0, len(values), 16):
+            self.outln('    ' + ' '.join('{0},'.format(v) for v in values[i:i + 16]))
+        self.outln('};')
+        self.outln('')
+
+    def write_perfect_hash_lookup(self, proto, prefix, names, string_expr):
+        # Writes a function returning the index of a name in names, or
+        # -1, given the C expression for the string of an index.
+        table = PerfectHash(names)
+
+        self.write_table('uint16_t', prefix + '_hash_seeds', table.seeds)
+        self.write_table('uint16_t', prefix + '_hash_slots', table.slots)
+
+        self.outln(proto)
+        self.outln('{')
+        self.outln('    uint32_t bucket = epoxy_name_hash(name, len, 0) & {0};'.format(table.num_buckets - 1))
+        self.outln('    uint32_t seed = {0}_hash_seeds[bucket];'.format(prefix))
+        self.outln('    int index = {0}_hash_slots[epoxy_name_hash(name, len, seed) & {1}] - 1;'.format(prefix,
+                                                                                                    table.num_slots - 1))
+        self.outln('    const char *candidate;')
+        self.outln('')
+        self.outln('    if (index < 0)')
+        self.outln('        return -1;')
+        self.outln('')
+        self.outln('    candidate = {0};'.format(string_expr.format('index')))
+        self.outln('    if (strncmp(candidate, name, len) != 0 || candidate[len] != 0)')
+        self.outln('        return -1;')
+        self.outln('')
+        self.outln('    return index;')
+        self.outln('}')
+        self.outln('')
+
+    def write_extensions(self):
+        # Writes IDs for every extension in the registry, whether or
+        # not it provides any functions, so that extension support can
+        # be tracked as bitsets rather than strings.
+        sorted_extensions = sorted(self.supported_extensions)
+
+        self.outln('enum {0}_extension {{'.format(self.target))
+        for extname in sorted_extensions:
+            self.outln('    {0},'.format(self.extension_enum(extname)))
+        self.outln('};')
+        self.outln('')
+        self.outln('const int {0}_extension_count = {1};'.format(self.target, len(sorted_extensions)))
+        self.outln('')
+
+        offset = 0
+        offsets = []
+        self.outln('static const char {0}_extension_strings[] ='.format(self.target))
+        for extname in sorted_extensions:
+            self.outln('    "{0}\\0"'.format(extname))
+            offsets.append(offset)
+            offset += len(extname) + 1
+        self.outln('    ;')
+        self.outln('')
+        # We're using uint16_t for the offsets.
+        assert offset < 65536
+        self.write_table('uint16_t', '{0}_extension_offsets'.format(self.target), offsets)
+
+        self.outln('const char *')
+        self.outln('{0}_extension_name(int id)'.format(self.target))
+        self.outln('{')
+        self.outln('    return {0}_extension_strings + {0}_extension_offsets[id];'.format(self.target))
+        self.outln('}')
+        self.outln('')
+
+        self.write_perfect_hash_lookup('int\n{0}_extension_lookup(const char *name, size_t len)'.format(self.target),
+                                       '{0}_extension'.format(self.target),
+                                       sorted_extensions,
+                                       '{0}_extension_name({{0}})'.format(self.target))
+
+    def write_provider_resolver(self):
+        self.write_provider_available()
+
+        self.outln('static void *')
+        self.outln('{0}_provider_load(enum {0}_provider provider, const char *entrypoint)'.format(self.target))
+        self.outln('{')
+        self.outln('    switch (provider) {')
         for human_name in sorted(self.provider_enum.keys()):
             enum = self.provider_enum[human_name]
-            self.outln('        case {0}:'.format(enum))
-            self.outln('            if ({0})'.format(self.provider_condition[human_name]))
-            self.outln('                return {0};'.format(self.provider_loader[human_name]).format("entrypoint_strings + entrypoints[i]"))
-            self.outln('            break;')
+            self.outln('    case {0}:'.format(enum))
+            self.outln('        return {0};'.format(self.provider_loader[human_name]).format("entrypoint"))
+        self.outln('    case {0}_provider_terminator:'.format(self.target))
+        self.outln('    case {0}_provider_count:'.format(self.target))
+        self.outln('        break;')
+        self.outln('    }')
+        self.outln('')
+        self.outln('    abort(); /* Not reached */')
+        self.outln('}')
+        self.outln('')
 
-        self.outln('        case {0}_provider_terminator:'.format(self.target))
-        self.outln('            abort(); /* Not reached */')
-        self.outln('        }')
+        # What each provider loads its functions with, for the resolve
+        # reports.  The loaders that go through epoxy's own lookups
+        # report what those end up using instead.
+        def loader_name(loader):
+            name = loader.split('(')[0]
+            if name.endswith('_dlsym'):
+                return 'dlsym'
+            if name.startswith('epoxy_'):
+                return 'GetProcAddress'
+            return name
+
+        sorted_providers = sorted(self.provider_enum.keys())
+        loader_names = sorted(set(loader_name(self.provider_loader[human_name])
+                                  for human_name in sorted_providers))
+        self.outln('static const char *const {0}_loader_names[] = {{'.format(self.target))
+        for name in loader_names:
+            self.outln('    "{0}",'.format(name))
+        self.outln('};')
+        self.outln('')
+        self.write_table('uint8_t', '{0}_provider_loaders'.format(self.target),
+                         [0] + [loader_names.index(loader_name(self.provider_loader[human_name]))
+                                for human_name in sorted_providers])
+
+        # Returns the index of the first provider in the list that's
+        # present, or -1.
+        self.outln('static int')
+        self.outln('{0}_find_provider(const uint16_t *providers)'.format(self.target))
+        self.outln('{')
+        self.outln('    int i;')
+        self.outln('')
+        self.outln('    for (i = 0; providers[i] != {0}_provider_terminator; i++) {{'.format(self.target))
+        self.outln('        if ({0}_provider_available(providers[i]))'.format(self.target))
+        self.outln('            return i;')
+        self.outln('    }')
+        self.outln('')
+        self.outln('    return -1;')
+        self.outln('}')
+        self.outln('')
+
+        self.outln('static EPOXY_COLD void *')
+        self.outln('{0}_provider_resolver(enum {0}_function function,'.format(self.target))
+        self.outln('{0}const char *name,'.format(' ' * len(self.target + '_provider_resolver(')))
+        self.outln('{0}const uint16_t *providers,'.format(' ' * len(self.target + '_provider_resolver(')))
+        self.outln('{0}const uint16_t *entrypoints)'.format(' ' * len(self.target + '_provider_resolver(')))
+        self.outln('{')
+        self.outln('    epoxy_resolver_failure_handler_t handler;')
+        self.outln('    struct epoxy_resolve_report report;')
+        self.outln('    void *result;')
+        self.outln('    int i;')
+        self.outln('')
+        self.outln('    epoxy_eager_resolve();')
+        self.outln('')
+        self.outln('    epoxy_resolve_report_begin(&report, name);')
+        self.outln('    i = {0}_find_provider(providers);'.format(self.target))
+        self.outln('    if (i >= 0) {')
+        self.outln('        epoxy_resolve_report_provider(&report,')
+        self.outln('                                      enum_string + enum_string_offsets[providers[i]],')
+        self.outln('                                      {0}_loader_names[{0}_provider_loaders[providers[i]]]);'.format(self.target))
+        self.outln('        result = {0}_provider_load(providers[i],'.format(self.target))
+        self.outln('                                 {0}entrypoint_strings + {1}_function_names[entrypoints[i]]);'.format(' ' * len(self.target),
+                                                                                                               self.target))
+        self.outln('        epoxy_resolve_report_end(&report, result);')
+        self.outln('        if (result)')
+        self.outln('            epoxy_profile_record(EPOXY_TARGET_{0}, function);'.format(self.target.upper()))
+        self.outln('        return result;')
         self.outln('    }')
+        self.outln('    epoxy_resolve_report_end(&report, NULL);')
         self.outln('')
 
-        self.outln('    if (epoxy_resolver_failure_handler)')
-        self.outln('        return epoxy_resolver_failure_handler(name);')
+        self.outln('    handler = epoxy_atomic_load_ptr(&epoxy_resolver_failure_handler);')
+        self.outln('    if (handler)')
+        self.outln('        return handler(name);')
         self.outln('')
 
         # If the function isn't provided by any known extension, print
@@ -748,22 +1517,551 @@ class Generator(object):
         self.outln('}')
         self.outln('')
 
-        single_resolver_proto = '{0}_single_resolver(enum {0}_provider provider, uint32_t entrypoint_offset)'.format(self.target)
-        self.outln('EPOXY_NOINLINE static void *')
-        self.outln('{0};'.format(single_resolver_proto))
+        # The one resolver that every thunk calls, with its function's
+        # ID.
+        function_resolver_proto = 'function_resolver(enum {0}_function function)'.format(self.target)
+        self.outln('EPOXY_NOINLINE static EPOXY_COLD void *')
+        self.outln('{0};'.format(function_resolver_proto))
+        self.outln('')
+        self.outln('static EPOXY_COLD void *')
+        self.outln('{0}'.format(function_resolver_proto))
+        self.outln('{')
+        self.outln('    uint16_t offset = {0}_function_provider_offsets[function];'.format(self.target))
+        self.outln('    const char *name = entrypoint_strings + {0}_function_names[function];'.format(self.target))
+        self.outln('')
+        self.outln('    return {0}_provider_resolver(function, name,'.format(self.target))
+        self.outln('                                {0}_providers + offset,'.format(self.target))
+        self.outln('                                {0}_provider_entrypoints + offset);'.format(self.target))
+        self.outln('}')
+        self.outln('')
+
+    def write_provider_features(self):
+        # Writes the registry names of the features and extensions
+        # behind each provider, for epoxy_resolve_feature().
+        sorted_providers = sorted(self.provider_enum.keys())
+
+        offset = 1
+        offsets = [0]
+        self.outln('static const char {0}_provider_features[] ='.format(self.target))
+        self.outln('    "\\0" /* {0}_provider_terminator */'.format(self.target))
+        for human_name in sorted_providers:
+            feature = self.provider_feature.get(human_name, '')
+            if feature:
+                self.outln('    "{0}\\0"'.format(feature))
+                offsets.append(offset)
+                offset += len(feature) + 1
+            else:
+                offsets.append(0)
+        self.outln('    ;')
+        self.outln('')
+        # We're using uint16_t for the offsets.
+        assert offset < 65536
+        self.write_table('uint16_t', '{0}_provider_feature_offsets'.format(self.target), offsets)
+
+    def write_eager_resolver(self):
+        self.write_provider_features()
+
+        # Returns our own definition of a function's global pointer,
+        # and the thunk it holds until the function gets resolved.
+        # This and interposed_thunk() are switches rather than tables
+        # of pointers: in a shared library each entry of such a table
+        # needs a relocation at load time, taking up more room than
+        # the case it replaces, and dirtying the pages it's on.
+        self.outln('static void **')
+        self.outln('{0}_local_pointer(enum {0}_function function, void **rewrite_ptr)'.format(self.target))
+        self.outln('{')
+        self.outln('    switch (function) {')
+        for func in self.sorted_functions:
+            self.outln('    case {0}:'.format(self.function_enum(func)))
+            self.outln('        *rewrite_ptr = (void *)epoxy_{0}_global_rewrite_ptr;'.format(func.wrapped_name))
+            self.outln('        return (void **)&LOCAL_POINTER(epoxy_{0});'.format(func.wrapped_name))
+        self.outln('    default:')
+        self.outln('        break;')
+        self.outln('    }')
+        self.outln('')
+        self.outln('    abort(); /* Not reached */')
+        self.outln('}')
+        self.outln('')
+
+        # Returns the global pointer that calls to a function go
+        # through, looking it up the first time.
+        wrapped = [func for func in self.sorted_functions if func.wrapped_name != func.name]
+        self.outln('#if USING_PUBLIC_POINTER_LOOKUP')
+        self.outln('static void **{0}_public_pointers[{1}];'.format(self.target, len(self.sorted_functions)))
+        self.outln('#endif')
+        self.outln('')
+        self.outln('static EPOXY_COLD void **')
+        self.outln('exported_pointer(enum {0}_function function)'.format(self.target))
+        self.outln('{')
+        self.outln('    void *rewrite_ptr;')
+        self.outln('#if USING_PUBLIC_POINTER_LOOKUP')
+        self.outln('    void **ptr = epoxy_atomic_load_ptr(&{0}_public_pointers[function]);'.format(self.target))
+        self.outln('')
+        self.outln('    if (ptr)')
+        self.outln('        return ptr;')
+        self.outln('')
+        self.outln('    ptr = {0}_local_pointer(function, &rewrite_ptr);'.format(self.target))
+        if wrapped:
+            # The public pointers of the functions that epoxy wraps
+            # hold the wrappers, and these are internal.
+            self.outln('    if ({0})'.format(' || '.join(['function == ' + self.function_enum(func)
+                                                          for func in wrapped])))
+            self.outln('        return ptr;')
+        self.outln('    ptr = epoxy_public_pointer({0}_function_name(function), ptr);'.format(self.target))
+        self.outln('    epoxy_atomic_store_ptr(&{0}_public_pointers[function], ptr);'.format(self.target))
+        self.outln('    return ptr;')
+        self.outln('#else')
+        self.outln('    return {0}_local_pointer(function, &rewrite_ptr);'.format(self.target))
+        self.outln('#endif')
+        self.outln('}')
         self.outln('')
+
+        # The thunk of each interposer for each function, if it has one.
+        self.outln('#if USING_INTERPOSERS')
         self.outln('static void *')
-        self.outln('{0}'.format(single_resolver_proto))
+        self.outln('interposed_thunk(enum {0}_function function, enum epoxy_interposer interposer)'.format(self.target))
+        self.outln('{')
+        self.outln('    switch (interposer) {')
+        self.outln('#if USING_INSTRUMENTATION')
+        self.outln('    case EPOXY_INTERPOSER_INSTRUMENTATION:')
+        self.outln('        switch (function) {')
+        for func in self.sorted_functions:
+            self.outln('        case {0}:'.format(self.function_enum(func)))
+            self.outln('            return (void *)epoxy_{0}_instrumented_thunk;'.format(func.wrapped_name))
+        self.outln('        default:')
+        self.outln('            break;')
+        self.outln('        }')
+        self.outln('        break;')
+        self.outln('#endif')
+        self.outln('#if USING_QUEUE')
+        self.outln('    case EPOXY_INTERPOSER_QUEUE:')
+        self.outln('        switch (function) {')
+        for func in self.queued_functions():
+            self.outln('        case {0}:'.format(self.function_enum(func)))
+            self.outln('            return (void *)epoxy_{0}_queued_thunk;'.format(func.wrapped_name))
+        self.outln('        default:')
+        self.outln('            break;')
+        self.outln('        }')
+        self.outln('        break;')
+        self.outln('#endif')
+        if self.shadowed_functions():
+            self.outln('#if USING_SHADOW_STATE')
+            self.outln('    case EPOXY_INTERPOSER_SHADOW_STATE:')
+            self.outln('        switch (function) {')
+            for func in self.shadowed_functions():
+                self.outln('        case {0}:'.format(self.function_enum(func)))
+                self.outln('            return (void *)epoxy_{0}_shadowed_thunk;'.format(func.wrapped_name))
+            self.outln('        default:')
+            self.outln('            break;')
+            self.outln('        }')
+            self.outln('        break;')
+            self.outln('#endif')
+        self.outln('    default:')
+        self.outln('        break;')
+        self.outln('    }')
+        self.outln('')
+        self.outln('    return NULL;')
+        self.outln('}')
+        self.outln('#endif')
+        self.outln('')
+
+        # While interposed thunks are in the global pointers, their
+        # slots take the place of the pointers.
+        self.outln('static EPOXY_NOINLINE EPOXY_COLD void **')
+        self.outln('public_pointer(enum {0}_function function)'.format(self.target))
         self.outln('{')
-        self.outln('    enum {0}_provider providers[] = {{'.format(self.target))
-        self.outln('        provider,')
-        self.outln('        {0}_provider_terminator'.format(self.target))
-        self.outln('    };')
-        self.outln('    return {0}_provider_resolver(entrypoint_strings + entrypoint_offset,'.format(self.target))
-        self.outln('                                providers, &entrypoint_offset);')
+        self.outln('#if USING_INTERPOSERS')
+        self.outln('    long interposer = epoxy_atomic_load_long(&interposed);')
+        self.outln('')
+        self.outln('    if (interposer != EPOXY_INTERPOSER_NONE && interposed_thunk(function, interposer))')
+        self.outln('        return &interposed_targets[function];')
+        self.outln('#endif')
+        self.outln('    return exported_pointer(function);')
         self.outln('}')
         self.outln('')
 
+        # Calls may be going on meanwhile.  The slots get filled in
+        # before they take the place of the pointers, and anything
+        # that got resolved into a pointer in between is carried over
+        # when swapping the thunk in.  Taking the thunks out again
+        # may lose a resolve that was going on, which only means that
+        # the function gets resolved again.
+        self.outln('#if USING_INTERPOSERS')
+        self.outln('bool')
+        self.outln('{0}_interpose(enum epoxy_interposer from, enum epoxy_interposer to)'.format(self.target))
+        self.outln('{')
+        self.outln('    long current = epoxy_atomic_load_long(&interposed);')
+        self.outln('    int function;')
+        self.outln('')
+        self.outln('    if (current == to)')
+        self.outln('        return true;')
+        self.outln('    if (current != from)')
+        self.outln('        return false;')
+        self.outln('')
+        self.outln('    if (from != EPOXY_INTERPOSER_NONE) {')
+        self.outln('        for (function = 0; function < {0}_function_count; function++) {{'.format(self.target))
+        self.outln('            if (interposed_thunk(function, from))')
+        self.outln('                epoxy_atomic_store_ptr(exported_pointer(function),')
+        self.outln('                                       epoxy_atomic_load_ptr(&interposed_targets[function]));')
+        self.outln('        }')
+        self.outln('        epoxy_atomic_cas_long(&interposed, from, EPOXY_INTERPOSER_NONE);')
+        self.outln('    }')
+        self.outln('')
+        self.outln('    if (to != EPOXY_INTERPOSER_NONE) {')
+        self.outln('        for (function = 0; function < {0}_function_count; function++)'.format(self.target))
+        self.outln('            interposed_targets[function] = epoxy_atomic_load_ptr(exported_pointer(function));')
+        self.outln('        epoxy_atomic_cas_long(&interposed, EPOXY_INTERPOSER_NONE, to);')
+        self.outln('')
+        self.outln('        for (function = 0; function < {0}_function_count; function++) {{'.format(self.target))
+        self.outln('            void *thunk = interposed_thunk(function, to);')
+        self.outln('            void *rewrite_ptr, *old;')
+        self.outln('')
+        self.outln('            if (!thunk)')
+        self.outln('                continue;')
+        self.outln('')
+        self.outln('            {0}_local_pointer(function, &rewrite_ptr);'.format(self.target))
+        self.outln('            old = epoxy_atomic_exchange_ptr(exported_pointer(function), thunk);')
+        self.outln('            if (old != rewrite_ptr)')
+        self.outln('                epoxy_atomic_cas_ptr(&interposed_targets[function], rewrite_ptr, old);')
+        self.outln('        }')
+        self.outln('    }')
+        self.outln('')
+        self.outln('    return true;')
+        self.outln('}')
+        self.outln('#endif')
+        self.outln('')
+
+        # Returns where calls to a function get their pointer from,
+        # and the thunk it holds until the function gets resolved.
+        self.outln('static void **')
+        self.outln('{0}_function_pointer(enum {0}_function function, void **rewrite_ptr)'.format(self.target))
+        self.outln('{')
+        if self.dispatch_table:
+            self.outln('#if USING_DISPATCH_TABLE')
+            self.outln('    if ({0}_using_dispatch_table) {{'.format(self.target))
+            self.outln('        *rewrite_ptr = NULL;')
+            self.outln('        return &((void **)get_dispatch_table())[function];')
+            self.outln('    }')
+            self.outln('#endif')
+            self.outln('')
+        self.outln('    {0}_local_pointer(function, rewrite_ptr);'.format(self.target))
+        self.outln('    return public_pointer(function);')
+        self.outln('}')
+        self.outln('')
+
+        # Resolves a function into its pointer without going through
+        # the failure handler, for when it's fine for the function to
+        # be missing.
+        self.outln('static bool')
+        self.outln('{0}_resolve_function(enum {0}_function function, void **ptr,'.format(self.target))
+        self.outln('{0}                     void *rewrite_ptr)'.format(' ' * len(self.target)))
+        self.outln('{')
+        self.outln('    uint16_t offset = {0}_function_provider_offsets[function];'.format(self.target))
+        self.outln('    int i = {0}_find_provider({0}_providers + offset);'.format(self.target))
+        self.outln('    void *func;')
+        self.outln('')
+        self.outln('    if (i < 0)')
+        self.outln('        return false;')
+        self.outln('')
+        self.outln('    func = {0}_provider_load({0}_providers[offset + i],'.format(self.target))
+        self.outln('                             entrypoint_strings +')
+        self.outln('                             {0}_function_names[{0}_provider_entrypoints[offset + i]]);'.format(self.target))
+        self.outln('    if (!func)')
+        self.outln('        return false;')
+        self.outln('')
+        # Somebody else may have filled in the pointer meanwhile, or
+        # replaced it with a dispatch table thunk.
+        self.outln('    return epoxy_atomic_cas_ptr(ptr, rewrite_ptr, func);')
+        self.outln('}')
+        self.outln('')
+
+        # Resolves every function that hasn't been resolved yet (and
+        # that the app hasn't replaced), optionally limited to the
+        # functions a single provider can supply.  Functions without
+        # a present provider are left to their thunks, so that calling
+        # them reports the failure as usual.
+        self.outln('static int')
+        self.outln('{0}_resolve_functions(enum {0}_provider feature)'.format(self.target))
+        self.outln('{')
+        self.outln('    int function;')
+        self.outln('    int resolved = 0;')
+        self.outln('')
+        self.outln('    for (function = 0; function < {0}_function_count; function++) {{'.format(self.target))
+        self.outln('        const uint16_t *providers =')
+        self.outln('            {0}_providers + {0}_function_provider_offsets[function];'.format(self.target))
+        self.outln('        void **ptr, *rewrite_ptr;')
+        self.outln('')
+        self.outln('        if (feature != {0}_provider_terminator) {{'.format(self.target))
+        self.outln('            while (*providers != feature && *providers != {0}_provider_terminator)'.format(self.target))
+        self.outln('                providers++;')
+        self.outln('            if (*providers != feature)')
+        self.outln('                continue;')
+        self.outln('        }')
+        self.outln('')
+        self.outln('        ptr = {0}_function_pointer(function, &rewrite_ptr);'.format(self.target))
+        self.outln('        if (*ptr == rewrite_ptr &&')
+        self.outln('            {0}_resolve_function(function, ptr, rewrite_ptr))'.format(self.target))
+        self.outln('            resolved++;')
+        self.outln('    }')
+        self.outln('')
+        self.outln('    return resolved;')
+        self.outln('}')
+        self.outln('')
+
+        self.outln('int')
+        self.outln('{0}_resolve_all(void)'.format(self.target))
+        self.outln('{')
+        self.outln('    return {0}_resolve_functions({0}_provider_terminator);'.format(self.target))
+        self.outln('}')
+        self.outln('')
+
+        self.outln('int')
+        self.outln('{0}_resolve_feature(const char *feature)'.format(self.target))
+        self.outln('{')
+        self.outln('    int provider;')
+        self.outln('')
+        self.outln('    for (provider = 1; provider < {0}_provider_count; provider++) {{'.format(self.target))
+        self.outln('        const char *name = {0}_provider_features + {0}_provider_feature_offsets[provider];'.format(self.target))
+        self.outln('')
+        self.outln('        if (name[0] && strcmp(name, feature) == 0)')
+        self.outln('            return {0}_resolve_functions(provider);'.format(self.target))
+        self.outln('    }')
+        self.outln('')
+        self.outln('    return -1;')
+        self.outln('}')
+        self.outln('')
+
+        # Puts the thunks back, so that the functions get resolved
+        # again for a context that needs other ones than those the
+        # pointers got.
+        if self.dispatch_table:
+            self.outln('#if USING_DISPATCH_TABLE && !defined(_WIN32)')
+            self.outln('void')
+            self.outln('{0}_reset_function_pointers(void)'.format(self.target))
+            self.outln('{')
+            self.outln('    int function;')
+            self.outln('')
+            self.outln('    for (function = 0; function < {0}_function_count; function++) {{'.format(self.target))
+            self.outln('        void *rewrite_ptr;')
+            self.outln('        void **ptr = {0}_function_pointer(function, &rewrite_ptr);'.format(self.target))
+            self.outln('')
+            self.outln('        epoxy_atomic_store_ptr(ptr, rewrite_ptr);')
+            self.outln('    }')
+            self.outln('}')
+            self.outln('#endif')
+            self.outln('')
+
+    def write_function_lookup(self):
+        self.write_perfect_hash_lookup('int\n{0}_function_lookup(const char *name, size_t len)'.format(self.target),
+                                       '{0}_function'.format(self.target),
+                                       [func.name for func in self.sorted_functions],
+                                       'entrypoint_strings + {0}_function_names[{{0}}]'.format(self.target))
+
+        self.outln('const char *')
+        self.outln('{0}_function_name(int function)'.format(self.target))
+        self.outln('{')
+        self.outln('    return entrypoint_strings + {0}_function_names[function];'.format(self.target))
+        self.outln('}')
+        self.outln('')
+
+        # The raw pointers, without the wrappers, for the resolve cache.
+        self.outln('void *')
+        self.outln('{0}_resolved_function(int function)'.format(self.target))
+        self.outln('{')
+        self.outln('    void *rewrite_ptr;')
+        self.outln('    void **ptr = {0}_function_pointer(function, &rewrite_ptr);'.format(self.target))
+        self.outln('')
+        self.outln('    return *ptr == rewrite_ptr ? NULL : *ptr;')
+        self.outln('}')
+        self.outln('')
+
+        self.outln('bool')
+        self.outln('{0}_preset_function(int function, void *func)'.format(self.target))
+        self.outln('{')
+        self.outln('    void *rewrite_ptr;')
+        self.outln('    void **ptr = {0}_function_pointer(function, &rewrite_ptr);'.format(self.target))
+        self.outln('')
+        self.outln('    return epoxy_atomic_cas_ptr(ptr, rewrite_ptr, func);')
+        self.outln('}')
+        self.outln('')
+
+        self.outln('void *')
+        self.outln('{0}_get_function(int function, bool resolve)'.format(self.target))
+        self.outln('{')
+        self.outln('    void *rewrite_ptr;')
+        self.outln('    void **ptr = {0}_function_pointer(function, &rewrite_ptr);'.format(self.target))
+        self.outln('')
+        self.outln('    if (*ptr == rewrite_ptr && resolve)')
+        self.outln('        {0}_resolve_function(function, ptr, rewrite_ptr);'.format(self.target))
+        self.outln('    if (*ptr == rewrite_ptr)')
+        self.outln('        return NULL;')
+        self.outln('')
+
+        # Functions that epoxy wraps have to be called through their
+        # wrappers.
+        wrapped = [func for func in self.sorted_functions if func.wrapped_name != func.name]
+        if wrapped:
+            self.outln('    switch (function) {')
+            for func in wrapped:
+                self.outln('    case {0}:'.format(self.function_enum(func)))
+                self.outln('        return (void *)epoxy_{0};'.format(func.name))
+            self.outln('    default:')
+            self.outln('        break;')
+            self.outln('    }')
+            self.outln('')
+        self.outln('    return *ptr;')
+        self.outln('}')
+        self.outln('')
+
+    def write_dispatch_table(self):
+        self.outln('#if USING_DISPATCH_TABLE')
+
+        self.outln('#ifdef _WIN32')
+        self.outln('uint32_t {0}_tls_index;'.format(self.target))
+        self.outln('uint32_t {0}_tls_size = sizeof(struct dispatch_table);'.format(self.target))
+        self.outln('')
+
+        self.outln('static inline struct dispatch_table *')
+        self.outln('get_current_dispatch_table(void)')
+        self.outln('{')
+        self.outln('	return TlsGetValue({0}_tls_index);'.format(self.target))
+        self.outln('}')
+        self.outln('')
+
+        self.outln('static inline struct dispatch_table *')
+        self.outln('get_dispatch_table(void)')
+        self.outln('{')
+        self.outln('	return get_current_dispatch_table();')
+        self.outln('}')
+        self.outln('')
+
+        self.outln('void')
+        self.outln('{0}_init_dispatch_table(void)'.format(self.target))
+        self.outln('{')
+        self.outln('    struct dispatch_table *dispatch_table = get_dispatch_table();')
+        self.outln('    memset(dispatch_table, 0, sizeof(*dispatch_table));')
+        self.outln('}')
+        self.outln('#else')
+
+        # Elsewhere, the table belongs to the current context, and the
+        # thread only remembers it until the next MakeCurrent.
+        self.outln('static inline struct dispatch_table *')
+        self.outln('get_current_dispatch_table(void)')
+        self.outln('{')
+        self.outln('    return {0}_current_dispatch_table;'.format(self.target))
+        self.outln('}')
+        self.outln('')
+
+        self.outln('static inline struct dispatch_table *')
+        self.outln('get_dispatch_table(void)')
+        self.outln('{')
+        self.outln('    struct dispatch_table *dispatch_table = get_current_dispatch_table();')
+        self.outln('')
+        self.outln('    if (!dispatch_table)')
+        self.outln('        dispatch_table = epoxy_context_dispatch_table(sizeof(*dispatch_table));')
+        self.outln('    return dispatch_table;')
+        self.outln('}')
+        self.outln('#endif')
+        self.outln('')
+
+        # Everything but the usual case stays out of the thunks, so
+        # that they're just a couple of loads and a jump.
+        self.outln('static EPOXY_NOINLINE EPOXY_COLD struct dispatch_table *')
+        self.outln('resolve_dispatch_table_entry(size_t offset)')
+        self.outln('{')
+        self.outln('    struct dispatch_table *dispatch_table = get_dispatch_table();')
+        self.outln('    void **entry = (void **)((char *)dispatch_table + offset);')
+        self.outln('')
+        self.outln('    if (!*entry)')
+        self.outln('        *entry = function_resolver(offset / sizeof(void *));')
+        self.outln('    return dispatch_table;')
+        self.outln('}')
+        self.outln('')
+
+        self.outln('static inline struct dispatch_table *')
+        self.outln('get_resolved_dispatch_table(size_t offset)')
+        self.outln('{')
+        self.outln('    struct dispatch_table *dispatch_table = get_current_dispatch_table();')
+        self.outln('')
+        self.outln('    if (!dispatch_table || !*(void **)((char *)dispatch_table + offset))')
+        self.outln('        dispatch_table = resolve_dispatch_table_entry(offset);')
+        self.outln('    return dispatch_table;')
+        self.outln('}')
+        self.outln('')
+
+        self.outln('static bool {0}_using_dispatch_table;'.format(self.target))
+        self.outln('')
+
+        self.outln('void')
+        self.outln('{0}_switch_to_dispatch_table(void)'.format(self.target))
+        self.outln('{')
+        self.outln('    {0}_using_dispatch_table = true;'.format(self.target))
+        self.outln('')
+
+        for func in self.sorted_functions:
+            self.outln('    PUBLIC_POINTER(epoxy_{0}, {1}) = epoxy_{0}_dispatch_table_thunk;'.format(func.wrapped_name,
+                                                                                       self.function_enum(func)))
+
+        self.outln('}')
+        self.outln('')
+
+        self.outln('#endif /* !USING_DISPATCH_TABLE */')
+
+    def write_ifuncs(self):
+        # Writes out the GL entrypoints under their own names, as GNU
+        # IFUNCs.  When the dynamic linker resolves one of them with a
+        # context current (at the first call through a lazily bound
+        # PLT slot), the caller's slot gets the driver's function, and
+        # otherwise it gets the thunk that calls through our pointer.
+        self.outln('#if ENABLE_IFUNC')
+        self.outln('static EPOXY_NOINLINE EPOXY_COLD void *')
+        self.outln('{0}_ifunc_resolve(enum {0}_function function, void *thunk)'.format(self.target))
+        self.outln('{')
+        self.outln('    void *func;')
+        self.outln('')
+        self.outln('#if USING_DISPATCH_TABLE')
+        self.outln('    /* The current context\'s function isn\'t every context\'s. */')
+        self.outln('    if ({0}_using_dispatch_table)'.format(self.target))
+        self.outln('        return thunk;')
+        self.outln('#endif')
+        self.outln('')
+        self.outln('#if USING_INTERPOSERS')
+        self.outln('    /* Calls have to keep going through the thunks put in. */')
+        self.outln('    if (epoxy_atomic_load_long(&interposed))')
+        self.outln('        return thunk;')
+        self.outln('#endif')
+        self.outln('')
+        self.outln('    func = {0}_get_function(function, epoxy_ifunc_can_resolve());'.format(self.target))
+        self.outln('    if (!func)')
+        self.outln('        return thunk;')
+        self.outln('')
+        self.outln('    /* The caller\'s slot now skips our pointers for good. */')
+        self.outln('    epoxy_ifunc_note_bound();')
+        self.outln('    return func;')
+        self.outln('}')
+        self.outln('')
+
+        for func in self.sorted_functions:
+            if func.wrapped_name != func.name:
+                thunk = 'epoxy_{0}'.format(func.name)
+            else:
+                thunk = 'epoxy_{0}_global_rewrite_ptr'.format(func.name)
+
+            self.outln('static EPOXY_COLD {0}'.format(func.ptr_type))
+            self.outln('epoxy_{0}_ifunc(void)'.format(func.name))
+            self.outln('{')
+            self.outln('    return {0}_ifunc_resolve({1}, (void *){2});'.format(self.target,
+                                                                          self.function_enum(func),
+                                                                          thunk))
+            self.outln('}')
+            self.outln('EPOXY_PUBLIC {0} EPOXY_CALLSPEC epoxy_{1}_export({2})'.format(func.ret_type,
+                                                                                 func.name,
+                                                                                 func.args_decl))
+            self.outln('    __asm__("{0}") __attribute__((ifunc("epoxy_{0}_ifunc")));'.format(func.name))
+            self.outln('')
+
+        self.outln('#endif /* ENABLE_IFUNC */')
+
     def write_source(self, f):
         self.close()
         self.out_file = open(f, 'w')
@@ -775,6 +2073,7 @@ class Generator(object):
         self.outln('')
         self.outln('#include "config.h"')
         self.outln('')
+        self.outln('#include <stddef.h>')
         self.outln('#include <stdlib.h>')
         self.outln('#include <string.h>')
         self.outln('#include <stdio.h>')
@@ -788,6 +2087,12 @@ class Generator(object):
         self.outln('#define EPOXY_NOINLINE __declspec(noinline)')
         self.outln('#endif')
 
+        # Everything in the source is in the same order, with the hot
+        # functions first so that their dispatch table entries share
+        # cache lines too.
+        self.sorted_functions = self.hot_functions + [func for func in self.sorted_functions
+                                                      if func not in self.hot_functions]
+
         self.outln('struct dispatch_table {')
         for func in self.sorted_functions:
             self.outln('    {0} epoxy_{1};'.format(func.ptr_type, func.wrapped_name))
@@ -795,69 +2100,60 @@ class Generator(object):
         self.outln('')
 
         # Early declaration, so we can declare the real thing at the
-        # bottom. (I want the function_ptr_resolver as the first
-        # per-GL-call code, since it's the most interesting to see
-        # when you search for the implementation of a call)
-        self.outln('#if USING_DISPATCH_TABLE')
-        self.outln('static inline struct dispatch_table *')
-        self.outln('get_dispatch_table(void);')
-        self.outln('')
-        self.outln('#endif')
+        # bottom.
+        if self.dispatch_table:
+            self.outln('#if USING_DISPATCH_TABLE')
+            self.outln('static inline struct dispatch_table *')
+            self.outln('get_resolved_dispatch_table(size_t offset);')
+            self.outln('')
+            self.outln('#endif')
 
         self.write_provider_enums()
         self.write_provider_enum_strings()
         self.write_entrypoint_strings()
+        self.write_extensions()
+        self.write_function_tables()
         self.write_provider_resolver()
 
-        for func in self.sorted_functions:
-            self.write_function_ptr_resolver(func)
-
-        for func in self.sorted_functions:
-            self.write_thunks(func)
-        self.outln('')
-
-        self.outln('#if USING_DISPATCH_TABLE')
-
-        self.outln('static struct dispatch_table resolver_table = {')
-        for func in self.sorted_functions:
-            self.outln('    epoxy_{0}_dispatch_table_rewrite_ptr, /* {0} */'.format(func.wrapped_name))
-        self.outln('};')
+        self.outln('static void **public_pointer(enum {0}_function function);'.format(self.target))
         self.outln('')
 
-        self.outln('uint32_t {0}_tls_index;'.format(self.target))
-        self.outln('uint32_t {0}_tls_size = sizeof(struct dispatch_table);'.format(self.target))
-        self.outln('')
-
-        self.outln('static inline struct dispatch_table *')
-        self.outln('get_dispatch_table(void)')
+        # Resolves the function into its global pointer, unless the
+        # pointer has been changed from the thunk already, and returns
+        # the pointer.
+        self.outln('static EPOXY_NOINLINE EPOXY_COLD void **')
+        self.outln('resolve_public_pointer(enum {0}_function function, void *rewrite_ptr)'.format(self.target))
         self.outln('{')
-        self.outln('	return TlsGetValue({0}_tls_index);'.format(self.target))
-        self.outln('}')
+        self.outln('    void **ptr = public_pointer(function);')
         self.outln('')
-
-        self.outln('void')
-        self.outln('{0}_init_dispatch_table(void)'.format(self.target))
-        self.outln('{')
-        self.outln('    struct dispatch_table *dispatch_table = get_dispatch_table();')
-        self.outln('    memcpy(dispatch_table, &resolver_table, sizeof(resolver_table));')
+        self.outln('    if (*ptr == rewrite_ptr)')
+        self.outln('        epoxy_atomic_cas_ptr(ptr, rewrite_ptr, function_resolver(function));')
+        self.outln('    return ptr;')
         self.outln('}')
         self.outln('')
 
-        self.outln('void')
-        self.outln('{0}_switch_to_dispatch_table(void)'.format(self.target))
-        self.outln('{')
-
         for func in self.sorted_functions:
-            self.outln('    epoxy_{0} = epoxy_{0}_dispatch_table_thunk;'.format(func.wrapped_name))
-
-        self.outln('}')
+            self.write_thunks(func)
         self.outln('')
 
-        self.outln('#endif /* !USING_DISPATCH_TABLE */')
+        self.write_interposed_thunks()
+
+        if self.dispatch_table:
+            self.write_dispatch_table()
+
+        if self.hot_functions:
+            self.outln('EPOXY_HOT_DATA_ALIGN')
+            self.outln('')
 
         for func in self.sorted_functions:
             self.write_function_pointer(func)
 
+        self.write_eager_resolver()
+        self.write_function_lookup()
+
+        if self.target == 'gl':
+            self.write_ifuncs()
+
     def close(self):
         if self.out_file:
             self.out_file.close()
@@ -873,6 +2169,10 @@ argparser.add_argument('--source', dest='source', action='store_true', required=
 argparser.add_argument('--no-source', dest='source', action='store_false', required=False, help='Do not generate the source file')
 argparser.add_argument('--header', dest='header', action='store_true', required=False, help='Generate the header file')
 argparser.add_argument('--no-header', dest='header', action='store_false', required=False, help='Do not generate the header file')
+argparser.add_argument('--hot-functions', metavar='file', required=False, help='Call-frequency profile of the functions to place together')
+argparser.add_argument('--api', choices=['gl', 'glcore', 'gles1', 'gles2'], required=False, help='Only generate the GL features and extensions of this API')
+argparser.add_argument('--max-version', metavar='major.minor', required=False, help='Only generate the GL features up to this version')
+argparser.add_argument('--extensions', metavar='file', required=False, help='Only generate the extensions listed in this file')
 args = argparser.parse_args()
 
 if args.outputdir:
@@ -900,7 +2200,16 @@ if not build_source and not build_header:
 for f in args.files:
     name = os.path.basename(f).split('.xml')[0]
     generator = Generator(name)
+    generator.gl_api = args.api
+    if args.max_version:
+        m = re.match(r'([0-9])\.([0-9])$', args.max_version)
+        if not m:
+            sys.exit('bad GL version: "{0}"'.format(args.max_version))
+        generator.max_version = int(m.group(1)) * 10 + int(m.group(2))
+    if args.extensions:
+        generator.load_extension_list(args.extensions)
     generator.parse(f)
+    generator.drop_unselected_functions()
 
     generator.drop_weird_glx_functions()
 
@@ -924,6 +2233,9 @@ for f in args.files:
 
     generator.prepare_provider_enum()
 
+    if args.hot_functions:
+        generator.load_hot_functions(args.hot_functions)
+
     if build_header:
         generator.write_header(os.path.join(includedir, name + '_generated.h'))
     if build_source:
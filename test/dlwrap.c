@@ -30,6 +30,9 @@
  * This lets us simulate some target systems in the test suite, or
  * just stub out GL functions so we can be sure of what's being
  * called.
+ *
+ * Built with DLWRAP_MOCK_DRIVER, the real libraries don't get loaded
+ * at all, and whatever isn't overridden comes from mock_driver.c.
  */
 
 /* dladdr is a glibc extension */
@@ -43,6 +46,9 @@
 #include <assert.h>
 
 #include "dlwrap.h"
+#ifdef DLWRAP_MOCK_DRIVER
+#include "mock_driver.h"
+#endif
 
 #define STRNCMP_LITERAL(var, literal) \
     strncmp ((var), (literal), sizeof (literal) - 1)
@@ -67,6 +73,11 @@ static struct libwrap {
     { "libGL.so", "GL", NULL },
     { "libEGL.so", "EGL", NULL },
     { "libGLESv2.so", "GLES2", NULL },
+#ifdef DLWRAP_MOCK_DRIVER
+    /* Which would otherwise get loaded for real. */
+    { "libGLX.so", "GL", NULL },
+    { "libGLESv1_CM.so", "GLES1", NULL },
+#endif
     { "libOpenGL.so", "GL", NULL},
 };
 
@@ -104,6 +115,21 @@ dlopen(const char *filename, int flag)
     void *ret;
     struct libwrap *wrap;
 
+#ifdef DLWRAP_MOCK_DRIVER
+    wrap = find_wrapped_library(filename);
+    if (wrap) {
+        if (!mock_driver_has_library(wrap->filename))
+            return NULL;
+
+        /* Only what has been opened before is already loaded. */
+        if ((flag & RTLD_NOLOAD) && !wrap->handle)
+            return NULL;
+
+        wrap->handle = wrap;
+        return wrap;
+    }
+#endif
+
     /* Before deciding whether to redirect this dlopen to our own
      * library, we call the real dlopen. This assures that any
      * expected side-effects from loading the intended library are
@@ -199,8 +225,11 @@ dlsym(void *handle, const char *name)
         void *symbol = wrapped_dlsym(wrap->symbol_prefix, name);
         if (symbol)
             return symbol;
-        else
-            return dlwrap_real_dlsym(wrap->handle, name);
+#ifdef DLWRAP_MOCK_DRIVER
+        return mock_driver_dlsym(wrap->filename, name);
+#else
+        return dlwrap_real_dlsym(wrap->handle, name);
+#endif
     }
 
     /* And anything else is some unrelated dlsym. Just pass it
@@ -287,8 +316,12 @@ override_GL_glXGetProcAddress(const char *name)
     if (symbol)
         return symbol;
 
+#ifdef DLWRAP_MOCK_DRIVER
+    return mock_driver_get_proc_address(name);
+#else
     return DEFER_TO_GL("libGL.so.1", override_GL_glXGetProcAddress,
                        "glXGetProcAddress", (name));
+#endif
 }
 
 void *
@@ -300,8 +333,12 @@ override_GL_glXGetProcAddressARB(const char *name)
     if (symbol)
         return symbol;
 
+#ifdef DLWRAP_MOCK_DRIVER
+    return mock_driver_get_proc_address(name);
+#else
     return DEFER_TO_GL("libGL.so.1", override_GL_glXGetProcAddressARB,
                        "glXGetProcAddressARB", (name));
+#endif
 }
 
 void *
@@ -321,6 +358,10 @@ override_EGL_eglGetProcAddress(const char *name)
             return symbol;
     }
 
+#ifdef DLWRAP_MOCK_DRIVER
+    return mock_driver_get_proc_address(name);
+#else
     return DEFER_TO_GL("libEGL.so.1", override_EGL_eglGetProcAddress,
                        "eglGetProcAddress", (name));
+#endif
 }
@@ -0,0 +1,138 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+/**
+ * @file egl_mock_context_reuse.c
+ *
+ * Destroys a context and creates one of another API that the mock
+ * driver hands out at the same address, checking that nothing epoxy
+ * knew about the first one carries over to the second: whether it's
+ * desktop GL, its version and extensions, its dispatch table and its
+ * query cache.
+ */
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "epoxy/gl.h"
+#include "epoxy/egl.h"
+
+#include "mock_driver.h"
+
+static unsigned
+lookups(const char *name)
+{
+    unsigned dlsym_count, proc_address_count;
+
+    mock_driver_lookups(name, &dlsym_count, &proc_address_count);
+    return dlsym_count + proc_address_count;
+}
+
+int
+main(int argc, char **argv)
+{
+    static const EGLint es3_attribs[] = {
+        EGL_CONTEXT_CLIENT_VERSION, 3,
+        EGL_NONE
+    };
+    EGLDisplay dpy;
+    EGLContext ctx, reused;
+    const char *version;
+    bool query_cache, pass = true;
+    unsigned gen_queries_lookups;
+    GLint major = 0;
+    GLuint query;
+
+    setenv("EPOXY_MOCK_WINDOW_SYSTEMS", "egl", true);
+    setenv("EPOXY_MOCK_GL_VERSION", "4.5", true);
+    setenv("EPOXY_MOCK_GL_PROFILE", "compat", true);
+    setenv("EPOXY_MOCK_GL_EXTENSIONS", "GL_ARB_direct_state_access", true);
+    setenv("EPOXY_MOCK_GLES_VERSION", "3.0", true);
+    setenv("EPOXY_MOCK_GLES_EXTENSIONS", "GL_OES_EGL_image", true);
+
+    dpy = mock_driver_init_egl();
+    ctx = mock_driver_create_egl_context(dpy, EGL_OPENGL_API, NULL);
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx);
+
+    query_cache = epoxy_query_cache_start();
+
+    if (!epoxy_is_desktop_gl() || epoxy_gl_version() != 45 ||
+        !epoxy_has_gl_extension("GL_ARB_direct_state_access"))
+        errx(1, "The desktop GL context isn't what the mock was set up for");
+    glGetString(GL_VERSION);
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGenQueries(1, &query);
+
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(dpy, ctx);
+
+    reused = mock_driver_create_egl_context(dpy, EGL_OPENGL_ES_API, es3_attribs);
+    if (reused != ctx)
+        errx(77, "The new context didn't get the old one's handle");
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, reused);
+
+    if (epoxy_is_desktop_gl()) {
+        fputs("The GLES context was taken for desktop GL\n", stderr);
+        pass = false;
+    }
+    if (epoxy_gl_version() != 30) {
+        fprintf(stderr, "GL version %d, expected 30\n", epoxy_gl_version());
+        pass = false;
+    }
+    if (epoxy_has_gl_extension("GL_ARB_direct_state_access") ||
+        !epoxy_has_gl_extension("GL_OES_EGL_image")) {
+        fputs("The extensions of the destroyed context were kept\n", stderr);
+        pass = false;
+    }
+
+    version = (const char *)glGetString(GL_VERSION);
+    if (!version || strncmp(version, "OpenGL ES 3.0", strlen("OpenGL ES 3.0"))) {
+        fprintf(stderr, "GL_VERSION \"%s\"%s, expected the GLES one\n",
+                version ? version : "(null)",
+                query_cache ? " from the query cache" : "");
+        pass = false;
+    }
+
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    if (major != 3) {
+        fprintf(stderr, "GL_MAJOR_VERSION %d%s, expected 3\n", major,
+                query_cache ? " from the query cache" : "");
+        pass = false;
+    }
+
+    /* A GLES context gets its functions through a table of its own. */
+    gen_queries_lookups = lookups("glGenQueries");
+    glGenQueries(1, &query);
+    if (lookups("glGenQueries") != gen_queries_lookups + 1) {
+        fputs("The GLES context used the desktop GL dispatch table\n", stderr);
+        pass = false;
+    }
+
+    if (query_cache)
+        epoxy_query_cache_stop();
+
+    return pass ? 0 : 1;
+}
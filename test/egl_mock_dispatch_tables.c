@@ -0,0 +1,108 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+/**
+ * @file egl_mock_dispatch_tables.c
+ *
+ * Makes desktop GL contexts of different versions current on the same
+ * display, checking that a context only shares the function pointers
+ * of another one that the resolvers pick the same functions for, and
+ * that a GL 2.1 context's extensions outside the registry are found.
+ */
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "epoxy/gl.h"
+#include "epoxy/egl.h"
+
+#include "mock_driver.h"
+
+static bool pass = true;
+
+static void
+expect_lookups(const char *name, unsigned count, const char *what)
+{
+    unsigned dlsym_count, proc_address_count;
+
+    mock_driver_lookups(name, &dlsym_count, &proc_address_count);
+    if (dlsym_count + proc_address_count != count) {
+        fprintf(stderr, "%s: %s looked up %u times, expected %u\n", what, name,
+                dlsym_count + proc_address_count, count);
+        pass = false;
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    EGLDisplay dpy;
+    EGLContext gl45, other_gl45, gl21;
+
+    setenv("EPOXY_MOCK_WINDOW_SYSTEMS", "egl", true);
+    setenv("EPOXY_MOCK_GL_VERSION", "4.5", true);
+    setenv("EPOXY_MOCK_GL_PROFILE", "compat", true);
+
+    dpy = mock_driver_init_egl();
+    gl45 = mock_driver_create_egl_context(dpy, EGL_OPENGL_API, NULL);
+    other_gl45 = mock_driver_create_egl_context(dpy, EGL_OPENGL_API, NULL);
+
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, gl45);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    expect_lookups("glBindFramebuffer", 1, "GL 4.5");
+
+    /* The mock driver versions the contexts it creates from then on. */
+    mock_driver_set_config("gl_version", "2.1");
+    mock_driver_set_config("gl_extensions", "GL_EXT_framebuffer_object GL_EPOXY_unregistered");
+    gl21 = mock_driver_create_egl_context(dpy, EGL_OPENGL_API, NULL);
+
+    /* GL 2.1 only has the extension's name for it. */
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, gl21);
+    if (epoxy_gl_version() != 21)
+        errx(1, "GL version %d, expected 21", epoxy_gl_version());
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    expect_lookups("glBindFramebufferEXT", 1, "GL 2.1");
+
+    /* Names that aren't in the registry get found in the context's list. */
+    if (!epoxy_has_gl_extension("GL_EPOXY_unregistered") ||
+        epoxy_has_gl_extension("GL_EPOXY_unregister")) {
+        fputs("GL 2.1: wrong answer for an extension outside the registry\n", stderr);
+        pass = false;
+    }
+
+    /* The first context's table starts out empty, since its functions
+     * were resolved into the global pointers, but another GL 4.5
+     * context shares it.
+     */
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, gl45);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    expect_lookups("glBindFramebuffer", 2, "GL 4.5 again");
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, other_gl45);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    expect_lookups("glBindFramebuffer", 2, "another GL 4.5");
+    expect_lookups("glBindFramebufferEXT", 1, "another GL 4.5");
+
+    return pass != true;
+}
@@ -0,0 +1,169 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * @file egl_mock_driver.c
+ *
+ * Runs epoxy against the mock driver, checking that versions and
+ * extensions come from the context, that functions get looked up
+ * where they should be and only once, even when several threads call
+ * them for the first time at once.
+ */
+
+#include <err.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "epoxy/gl.h"
+#include "epoxy/egl.h"
+
+#include "mock_driver.h"
+
+#define THREADS 4
+
+static EGLDisplay dpy;
+static EGLContext desktop_ctx;
+
+static bool
+check_lookups(const char *name, unsigned dlsym_count, unsigned proc_address_count)
+{
+    unsigned dlsym_lookups, proc_address_lookups;
+
+    mock_driver_lookups(name, &dlsym_lookups, &proc_address_lookups);
+    if (dlsym_lookups != dlsym_count || proc_address_lookups != proc_address_count) {
+        fprintf(stderr, "%s looked up %u times with dlsym() and %u with "
+                "eglGetProcAddress(), expected %u and %u\n",
+                name, dlsym_lookups, proc_address_lookups,
+                dlsym_count, proc_address_count);
+        return false;
+    }
+
+    return true;
+}
+
+static void *
+first_call(void *data)
+{
+    pthread_barrier_t *barrier = data;
+    GLuint vao = 0;
+
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, desktop_ctx);
+    pthread_barrier_wait(barrier);
+
+    glGenVertexArrays(1, &vao);
+
+    return NULL;
+}
+
+int
+main(int argc, char **argv)
+{
+    static const EGLint es2_attribs[] = {
+        EGL_CONTEXT_CLIENT_VERSION, 2,
+        EGL_NONE
+    };
+    pthread_barrier_t barrier;
+    pthread_t threads[THREADS];
+    unsigned dlsym_count, proc_address_count;
+    EGLContext es_ctx;
+    bool pass = true;
+    int i;
+
+    /* Before epoxy loads the driver, which reads its configuration. */
+    setenv("EPOXY_MOCK_GL_VERSION", "3.3", true);
+    setenv("EPOXY_MOCK_GL_PROFILE", "core", true);
+    setenv("EPOXY_MOCK_GL_EXTENSIONS", "GL_KHR_debug GL_EPOXY_mock_only", true);
+    setenv("EPOXY_MOCK_WINDOW_SYSTEMS", "egl", true);
+    setenv("EPOXY_MOCK_DLSYM",
+           "egl* glGetString glGetStringi glGetIntegerv glGetError glClear", true);
+    /* Makes resolving take long enough for the threads to overlap. */
+    setenv("EPOXY_MOCK_LATENCY_NS", "20000", true);
+
+    dpy = mock_driver_init_egl();
+
+    if (epoxy_egl_version(dpy) != 15) {
+        fprintf(stderr, "EGL version %d, expected 15\n", epoxy_egl_version(dpy));
+        pass = false;
+    }
+    if (!epoxy_has_egl_extension(dpy, "EGL_KHR_surfaceless_context")) {
+        fputs("EGL_KHR_surfaceless_context missing\n", stderr);
+        pass = false;
+    }
+
+    desktop_ctx = mock_driver_create_egl_context(dpy, EGL_OPENGL_API, NULL);
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, desktop_ctx);
+
+    if (epoxy_gl_version() != 33 || !epoxy_is_desktop_gl()) {
+        fprintf(stderr, "GL version %d, desktop %d, expected 33 desktop\n",
+                epoxy_gl_version(), epoxy_is_desktop_gl());
+        pass = false;
+    }
+
+    if (!epoxy_has_gl_extension("GL_KHR_debug") ||
+        epoxy_has_gl_extension("GL_ARB_vertex_buffer_object") ||
+        !epoxy_has_gl_extension("GL_EPOXY_mock_only")) {
+        fputs("Wrong GL extensions\n", stderr);
+        pass = false;
+    }
+
+    /* GL 1.0 is in the library, later versions only in GetProcAddress. */
+    glClear(GL_COLOR_BUFFER_BIT);
+    glClear(GL_COLOR_BUFFER_BIT);
+    pass = check_lookups("glClear", 1, 0) && pass;
+
+    pthread_barrier_init(&barrier, NULL, THREADS);
+    for (i = 0; i < THREADS; i++)
+        pthread_create(&threads[i], NULL, first_call, &barrier);
+    for (i = 0; i < THREADS; i++)
+        pthread_join(threads[i], NULL);
+    pthread_barrier_destroy(&barrier);
+
+    /* Threads racing to resolve may each look the function up, but
+     * once one of them is done, nobody looks it up again.
+     */
+    mock_driver_lookups("glGenVertexArrays", &dlsym_count, &proc_address_count);
+    if (dlsym_count != 0 || proc_address_count < 1 || proc_address_count > THREADS) {
+        fprintf(stderr, "glGenVertexArrays looked up %u times with dlsym() "
+                "and %u with eglGetProcAddress()\n",
+                dlsym_count, proc_address_count);
+        pass = false;
+    }
+    glGenVertexArrays(0, NULL);
+    pass = check_lookups("glGenVertexArrays", 0, proc_address_count) && pass;
+
+    es_ctx = mock_driver_create_egl_context(dpy, EGL_OPENGL_ES_API, es2_attribs);
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, es_ctx);
+
+    if (epoxy_gl_version() != 32 || epoxy_is_desktop_gl()) {
+        fprintf(stderr, "GLES version %d, desktop %d, expected 32 GLES\n",
+                epoxy_gl_version(), epoxy_is_desktop_gl());
+        pass = false;
+    }
+    if (!epoxy_has_gl_extension("GL_OES_EGL_image")) {
+        fputs("GL_OES_EGL_image missing from the GLES context\n", stderr);
+        pass = false;
+    }
+
+    return pass != true;
+}
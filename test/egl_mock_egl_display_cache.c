@@ -0,0 +1,123 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+/**
+ * @file egl_mock_egl_display_cache.c
+ *
+ * Checks that epoxy_egl_version() and epoxy_has_egl_extension() keep
+ * answering from what a display reported until it gets terminated,
+ * and ask it again once it's initialized again, while the client
+ * extensions only get asked for once, without the client version that
+ * EGL 1.4 doesn't have.
+ */
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "epoxy/egl.h"
+
+#include "mock_driver.h"
+
+static bool pass = true;
+
+static void
+expect(EGLDisplay dpy, int version, const char *present, const char *absent,
+       const char *when)
+{
+    if (epoxy_egl_version(dpy) != version) {
+        fprintf(stderr, "%s: EGL %d, expected %d\n", when,
+                epoxy_egl_version(dpy), version);
+        pass = false;
+    }
+
+    if (present && !epoxy_has_egl_extension(dpy, present)) {
+        fprintf(stderr, "%s: %s missing\n", when, present);
+        pass = false;
+    }
+
+    if (absent && epoxy_has_egl_extension(dpy, absent)) {
+        fprintf(stderr, "%s: %s present\n", when, absent);
+        pass = false;
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned dlsym_count, proc_address_count;
+    EGLDisplay dpy;
+
+    setenv("EPOXY_MOCK_WINDOW_SYSTEMS", "egl", true);
+    setenv("EPOXY_MOCK_EGL_VERSION", "1.4", true);
+    /* One of them not in the registry, which epoxy has no ID for. */
+    setenv("EPOXY_MOCK_EGL_EXTENSIONS",
+           "EGL_KHR_surfaceless_context EGL_EPOXY_made_up", true);
+    setenv("EPOXY_MOCK_EGL_CLIENT_EXTENSIONS",
+           "EGL_EXT_client_extensions EGL_EXT_platform_base", true);
+
+    expect(EGL_NO_DISPLAY, 0, "EGL_EXT_client_extensions",
+           "EGL_KHR_surfaceless_context", "EGL_NO_DISPLAY");
+    if (eglGetError() != EGL_SUCCESS) {
+        fputs("Asking about the client raised an EGL error\n", stderr);
+        pass = false;
+    }
+
+    dpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    expect(dpy, 0, NULL, "EGL_KHR_surfaceless_context", "before eglInitialize");
+    expect(dpy, 0, "EGL_EXT_platform_base", NULL, "client before eglInitialize");
+
+    if (!eglInitialize(dpy, NULL, NULL))
+        errx(1, "Couldn't initialize the display");
+    expect(dpy, 14, "EGL_KHR_surfaceless_context", "EGL_KHR_no_config_context",
+           "after eglInitialize");
+    expect(dpy, 14, "EGL_EPOXY_made_up", "EGL_EPOXY_made", "unknown names");
+    expect(dpy, 14, "EGL_EXT_platform_base", NULL, "client extensions");
+
+    /* Not asked again until the display gets terminated. */
+    mock_driver_set_config("egl_version", "1.5");
+    mock_driver_set_config("egl_extensions", "EGL_KHR_no_config_context");
+    mock_driver_set_config("egl_client_extensions", "EGL_EXT_client_extensions");
+    expect(dpy, 14, "EGL_KHR_surfaceless_context", "EGL_KHR_no_config_context",
+           "without eglTerminate");
+
+    eglTerminate(dpy);
+    expect(dpy, 0, NULL, "EGL_KHR_surfaceless_context", "after eglTerminate");
+
+    if (!eglInitialize(dpy, NULL, NULL))
+        errx(1, "Couldn't initialize the display again");
+    expect(dpy, 15, "EGL_KHR_no_config_context", "EGL_KHR_surfaceless_context",
+           "after initializing again");
+    expect(dpy, 15, NULL, "EGL_EPOXY_made_up", "unknown names again");
+    expect(dpy, 15, "EGL_EXT_platform_base", NULL, "client extensions again");
+
+    mock_driver_lookups("eglTerminate", &dlsym_count, &proc_address_count);
+    if (dlsym_count + proc_address_count != 1) {
+        fprintf(stderr, "eglTerminate looked up %u times\n",
+                dlsym_count + proc_address_count);
+        pass = false;
+    }
+
+    return pass != true;
+}
@@ -0,0 +1,335 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * @file egl_mock_epoxy_api.c
+ *
+ * Checks epoxy's own API against a desktop GL context of the mock
+ * driver: the extension IDs and sets, epoxy_lookup(), the profiles and
+ * eager resolution, and what epoxy_get_context_info() reports, also
+ * after the context was made current behind epoxy's back.
+ */
+
+#ifdef __sun
+#define __EXTENSIONS__
+#else
+#define _GNU_SOURCE
+#endif
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "epoxy/gl.h"
+#include "epoxy/egl.h"
+
+#include "mock_driver.h"
+
+#define ARRAY_SIZE(arr) (sizeof(arr) / sizeof(arr[0]))
+
+static bool pass = true;
+
+static void
+test_extension_ids(void)
+{
+    static const char *names[] = {
+        "GL_ARB_vertex_buffer_object",
+        "GL_ARB_direct_state_access",
+        "GL_EXT_framebuffer_object",
+        "GL_KHR_debug",
+        "GL_NV_fence",
+    };
+    /* Which of the above the context has. */
+    static const bool expected[] = { true, false, true, true, false };
+    int ids[ARRAY_SIZE(names)];
+    uint64_t mask;
+    unsigned i;
+
+    for (i = 0; i < ARRAY_SIZE(names); i++) {
+        ids[i] = epoxy_gl_extension_id(names[i]);
+        if (ids[i] < 0) {
+            fprintf(stderr, "No ID for %s\n", names[i]);
+            pass = false;
+        }
+    }
+
+    if (epoxy_gl_extension_id("GL_EPOXY_not_an_extension") != -1) {
+        fputs("Got an ID for a made up extension\n", stderr);
+        pass = false;
+    }
+
+    mask = epoxy_has_gl_extension_ids(ids, ARRAY_SIZE(names));
+
+    for (i = 0; i < ARRAY_SIZE(names); i++) {
+        if (epoxy_has_gl_extension_id(ids[i]) != expected[i] ||
+            epoxy_has_gl_extension(names[i]) != expected[i] ||
+            !!(mask & ((uint64_t)1 << i)) != expected[i]) {
+            fprintf(stderr, "Wrong support reported for %s\n", names[i]);
+            pass = false;
+        }
+    }
+}
+
+static void
+test_extension_set(EGLDisplay dpy)
+{
+    const char *extensions = (const char *)glGetString(GL_EXTENSIONS);
+    struct epoxy_extension_set *set = epoxy_extension_set_create(extensions);
+    const char *egl_extensions = eglQueryString(dpy, EGL_EXTENSIONS);
+    unsigned int iter = 0, count = 0;
+    const char *name;
+    size_t len;
+
+    if (!set)
+        errx(1, "Couldn't make an extension set");
+
+    while ((name = epoxy_extension_set_next(set, &iter, &len))) {
+        char *copy = strndup(name, len);
+
+        if (!epoxy_extension_set_has(set, copy) ||
+            !epoxy_extension_in_string(extensions, copy)) {
+            fprintf(stderr, "%s missing from the extension set\n", copy);
+            pass = false;
+        }
+        /* A prefix of a name isn't in the list. */
+        copy[len - 1] = '\0';
+        if (epoxy_extension_set_has(set, copy) ||
+            epoxy_extension_in_string(extensions, copy)) {
+            fprintf(stderr, "Wrong support reported for %s\n", copy);
+            pass = false;
+        }
+        free(copy);
+        count++;
+    }
+
+    if (count != 4 || epoxy_extension_set_count(set) != count ||
+        epoxy_extension_set_has(set, "GL_EPOXY_not_an_extension")) {
+        fputs("Wrong extensions in the extension set\n", stderr);
+        pass = false;
+    }
+
+    epoxy_extension_set_destroy(set);
+
+    /* The helpers keep a set of their own for each list. */
+    set = epoxy_extension_set_create(egl_extensions);
+    iter = 0;
+    count = 0;
+    while ((name = epoxy_extension_set_next(set, &iter, &len))) {
+        char *copy = strndup(name, len);
+
+        if (!epoxy_has_egl_extension(dpy, copy)) {
+            fprintf(stderr, "epoxy_has_egl_extension() missed %s\n", copy);
+            pass = false;
+        }
+        free(copy);
+        count++;
+    }
+    epoxy_extension_set_destroy(set);
+
+    if (count != 2 || epoxy_has_egl_extension(dpy, "EGL_KHR_image")) {
+        fputs("Wrong EGL extensions reported\n", stderr);
+        pass = false;
+    }
+}
+
+static void
+test_lookup(void)
+{
+    if (epoxy_lookup("glEPOXYNotAFunction") != NULL) {
+        fputs("Looked up a made up function\n", stderr);
+        pass = false;
+    }
+
+    /* Already resolved by the calls above. */
+    if (epoxy_lookup("glGetString") != (void *)glGetString) {
+        fputs("Looked up the wrong glGetString\n", stderr);
+        pass = false;
+    }
+
+    /* Has to go through epoxy's wrapper. */
+    if (epoxy_lookup("glBegin") != (void *)glBegin) {
+        fputs("Looked up the wrong glBegin\n", stderr);
+        pass = false;
+    }
+
+    if (!epoxy_lookup("glDrawArrays") ||
+        epoxy_lookup("glDrawArrays") != (void *)glDrawArrays) {
+        fputs("Couldn't look up glDrawArrays\n", stderr);
+        pass = false;
+    }
+
+    if (!epoxy_lookup("eglGetCurrentContext")) {
+        fputs("Couldn't look up eglGetCurrentContext\n", stderr);
+        pass = false;
+    }
+}
+
+static void
+test_profile(void)
+{
+    char path[] = "/tmp/epoxy-profile-XXXXXX";
+    const char *profile =
+        "glDrawArrays\n"
+        "glEPOXYNotAFunction\n"
+        "\n"
+        "glCreateShader\r\n";
+    unsigned dlsym_count, proc_address_count;
+    int fd;
+
+    if (epoxy_preresolve_profile("/nonexistent/epoxy-profile") != -1) {
+        fputs("Read a missing profile\n", stderr);
+        pass = false;
+    }
+
+    fd = mkstemp(path);
+    if (fd < 0)
+        err(1, "Couldn't create a profile");
+    if (write(fd, profile, strlen(profile)) != (ssize_t)strlen(profile))
+        err(1, "Couldn't write the profile");
+    close(fd);
+
+    if (epoxy_preresolve_profile(path) != 2) {
+        fputs("Wrong number of profiled functions resolved\n", stderr);
+        pass = false;
+    }
+
+    unlink(path);
+
+    mock_driver_lookups("glCreateShader", &dlsym_count, &proc_address_count);
+    if (dlsym_count + proc_address_count != 1) {
+        fputs("The profile didn't resolve glCreateShader\n", stderr);
+        pass = false;
+    }
+}
+
+static void
+test_eager_resolution(void)
+{
+    unsigned dlsym_count, proc_address_count;
+
+    if (epoxy_resolve_feature("GL_EPOXY_not_a_feature") != -1) {
+        fputs("Resolved a made up feature\n", stderr);
+        pass = false;
+    }
+
+    if (epoxy_resolve_feature("GL_VERSION_1_5") <= 0) {
+        fputs("Couldn't resolve any GL 1.5 functions\n", stderr);
+        pass = false;
+    }
+
+    mock_driver_lookups("glGenBuffers", &dlsym_count, &proc_address_count);
+    if (dlsym_count + proc_address_count != 1) {
+        fputs("GL 1.5's glGenBuffers didn't get resolved\n", stderr);
+        pass = false;
+    }
+
+    if (epoxy_resolve_all() <= 0) {
+        fputs("Couldn't resolve the remaining functions\n", stderr);
+        pass = false;
+    }
+
+    /* Everything the context provides is resolved now, and the rest
+     * should be left alone.
+     */
+    if (epoxy_resolve_all() != 0) {
+        fputs("Resolved functions twice\n", stderr);
+        pass = false;
+    }
+
+    if (glGetError() != GL_NO_ERROR) {
+        fputs("GL error after eager resolution\n", stderr);
+        pass = false;
+    }
+}
+
+static void
+expect_context_info(EGLContext ctx, const char *what)
+{
+    struct epoxy_context_info info;
+
+    if (!epoxy_get_context_info(&info)) {
+        fprintf(stderr, "%s: no info about the current context\n", what);
+        pass = false;
+    } else if (info.platform != EPOXY_CONTEXT_PLATFORM_EGL ||
+               info.context != ctx ||
+               !info.is_desktop_gl ||
+               info.gl_version != 45 ||
+               info.glsl_version != 460) {
+        fprintf(stderr, "%s: context info doesn't match the context\n", what);
+        pass = false;
+    }
+}
+
+static void
+test_current_context_tracking(EGLDisplay dpy, EGLContext ctx)
+{
+    PFNEGLMAKECURRENTPROC driver_make_current =
+        mock_driver_dlsym("libEGL.so.1", "eglMakeCurrent");
+    struct epoxy_context_info info;
+
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (epoxy_get_context_info(&info)) {
+        fputs("Context still current after releasing it\n", stderr);
+        pass = false;
+    }
+
+    /* Making the context current behind epoxy's back needs to be
+     * reported to it.
+     */
+    driver_make_current(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx);
+    epoxy_handle_external_eglMakeCurrent();
+    expect_context_info(ctx, "made current behind epoxy's back");
+}
+
+int
+main(int argc, char **argv)
+{
+    EGLDisplay dpy;
+    EGLContext ctx;
+
+    setenv("EPOXY_MOCK_WINDOW_SYSTEMS", "egl", true);
+    setenv("EPOXY_MOCK_GL_VERSION", "4.5", true);
+    setenv("EPOXY_MOCK_GL_EXTENSIONS",
+           "GL_ARB_vertex_buffer_object GL_EXT_framebuffer_object "
+           "GL_KHR_debug GL_ARB_debug_output", true);
+    setenv("EPOXY_MOCK_EGL_EXTENSIONS",
+           "EGL_KHR_create_context EGL_KHR_image_base", true);
+
+    dpy = mock_driver_init_egl();
+    ctx = mock_driver_create_egl_context(dpy, EGL_OPENGL_API, NULL);
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx);
+
+    if (!epoxy_is_desktop_gl())
+        errx(1, "The mock context isn't desktop GL");
+    expect_context_info(ctx, "made current");
+
+    test_extension_ids();
+    test_extension_set(dpy);
+    test_lookup();
+    test_profile();
+    test_eager_resolution();
+    test_current_context_tracking(dpy, ctx);
+
+    return pass != true;
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+/**
+ * @file egl_mock_ifunc.c
+ *
+ * Calls a GL entrypoint that epoxy exports as an IFUNC, which the
+ * dynamic linker binds to the mock driver's function at the first
+ * call, and checks that the command queue, the shadow state and the
+ * query cache then refuse to start, since calls through the bound slot
+ * would get past them.
+ */
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "epoxy/gl.h"
+#include "epoxy/egl.h"
+
+#include "mock_driver.h"
+
+int
+main(int argc, char **argv)
+{
+    unsigned dlsym_count, proc_address_count;
+    EGLDisplay dpy;
+    EGLContext ctx;
+    bool pass = true;
+
+    setenv("EPOXY_MOCK_WINDOW_SYSTEMS", "egl", true);
+
+    dpy = mock_driver_init_egl();
+    ctx = mock_driver_create_egl_context(dpy, EGL_OPENGL_API, NULL);
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx);
+
+    glClear(GL_COLOR_BUFFER_BIT);
+    mock_driver_lookups("glClear", &dlsym_count, &proc_address_count);
+    if (dlsym_count + proc_address_count == 0)
+        errx(77, "glClear wasn't resolved through its IFUNC");
+
+    if (epoxy_queue_start()) {
+        fputs("The queue started with a bound IFUNC\n", stderr);
+        epoxy_queue_stop();
+        pass = false;
+    }
+    if (epoxy_shadow_state_start()) {
+        fputs("The shadow state started with a bound IFUNC\n", stderr);
+        epoxy_shadow_state_stop();
+        pass = false;
+    }
+    if (epoxy_query_cache_start()) {
+        fputs("The query cache started with a bound IFUNC\n", stderr);
+        epoxy_query_cache_stop();
+        pass = false;
+    }
+
+    return pass != true;
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * @file egl_mock_probe_context.c
+ *
+ * Makes a GL 2.1 context current and destroys it, as apps do to find
+ * out what they can get, before making the GL 4.5 contexts they go on
+ * with, checking that the functions get resolved again for those, and
+ * that they still go through the global pointers rather than dispatch
+ * tables, since they're all alike.
+ */
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "epoxy/gl.h"
+#include "epoxy/egl.h"
+
+#include "mock_driver.h"
+
+static bool pass = true;
+
+static void
+expect_lookups(const char *name, unsigned count, const char *what)
+{
+    unsigned dlsym_count, proc_address_count;
+
+    mock_driver_lookups(name, &dlsym_count, &proc_address_count);
+    if (dlsym_count + proc_address_count != count) {
+        fprintf(stderr, "%s: %s looked up %u times, expected %u\n", what, name,
+                dlsym_count + proc_address_count, count);
+        pass = false;
+    }
+}
+
+/* A dispatch table's thunk is in the public pointer instead. */
+static void
+expect_global_pointer(const char *what)
+{
+    if ((void *)glBindFramebuffer != epoxy_lookup("glBindFramebuffer")) {
+        fprintf(stderr, "%s: glBindFramebuffer isn't called directly\n", what);
+        pass = false;
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    EGLDisplay dpy;
+    EGLContext probe, gl45, other_gl45;
+
+    setenv("EPOXY_MOCK_WINDOW_SYSTEMS", "egl", true);
+    setenv("EPOXY_MOCK_GL_VERSION", "2.1", true);
+    setenv("EPOXY_MOCK_GL_EXTENSIONS", "GL_EXT_framebuffer_object", true);
+
+    dpy = mock_driver_init_egl();
+    probe = mock_driver_create_egl_context(dpy, EGL_OPENGL_API, NULL);
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, probe);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    expect_lookups("glBindFramebufferEXT", 1, "probe");
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(dpy, probe);
+
+    mock_driver_set_config("gl_version", "4.5");
+    mock_driver_set_config("gl_extensions", "GL_ARB_framebuffer_object");
+    gl45 = mock_driver_create_egl_context(dpy, EGL_OPENGL_API, NULL);
+    other_gl45 = mock_driver_create_egl_context(dpy, EGL_OPENGL_API, NULL);
+
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, gl45);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    expect_lookups("glBindFramebuffer", 1, "GL 4.5");
+    expect_global_pointer("GL 4.5");
+
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, other_gl45);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    expect_lookups("glBindFramebuffer", 1, "another GL 4.5");
+    expect_global_pointer("another GL 4.5");
+
+    return pass != true;
+}
@@ -0,0 +1,217 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+/**
+ * @file egl_mock_query_cache.c
+ *
+ * Runs the query cache against the mock driver, checking that the
+ * queries of immutable values keep their answers and stop reaching the
+ * driver after the first one on each context, that the strings are
+ * copies that outlive the driver's, that errors don't get cached, that
+ * the shadow state answers the queries of what it knows, and that the
+ * function pointers go back to calling the driver directly once both
+ * are stopped.
+ */
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "epoxy/gl.h"
+#include "epoxy/egl.h"
+
+#include "mock_driver.h"
+
+static uint64_t last_answered;
+static bool pass = true;
+
+static void
+expect_answered(uint64_t count, const char *what)
+{
+    struct epoxy_shadow_state_stats stats;
+
+    epoxy_shadow_state_snapshot(&stats);
+    if (stats.queries_answered - last_answered != count) {
+        fprintf(stderr, "%s: %llu queries answered, expected %llu\n", what,
+                (unsigned long long)(stats.queries_answered - last_answered),
+                (unsigned long long)count);
+        pass = false;
+    }
+    last_answered = stats.queries_answered;
+}
+
+static void
+ignore_answered(void)
+{
+    struct epoxy_shadow_state_stats stats;
+
+    epoxy_shadow_state_snapshot(&stats);
+    last_answered = stats.queries_answered;
+}
+
+static void
+expect_integer(GLenum pname, GLint expected, const char *what)
+{
+    GLint value = -1;
+
+    glGetIntegerv(pname, &value);
+    if (value != expected) {
+        fprintf(stderr, "%s: got %d, expected %d\n", what, value, expected);
+        pass = false;
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned dlsym_count, proc_address_count;
+    const GLubyte *renderer, *extension;
+    EGLDisplay dpy;
+    EGLContext ctx, other;
+    GLint extensions;
+
+    setenv("EPOXY_MOCK_WINDOW_SYSTEMS", "egl", true);
+    setenv("EPOXY_MOCK_GL_VERSION", "4.5", true);
+    setenv("EPOXY_MOCK_GL_PROFILE", "compat", true);
+
+    dpy = mock_driver_init_egl();
+    ctx = mock_driver_create_egl_context(dpy, EGL_OPENGL_API, NULL);
+    other = mock_driver_create_egl_context(dpy, EGL_OPENGL_API, NULL);
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx);
+
+    if (!epoxy_query_cache_start())
+        errx(77, "epoxy was built without the query cache");
+
+    if ((void *)glGetString == epoxy_lookup("glGetString")) {
+        fputs("glGetString isn't cached\n", stderr);
+        pass = false;
+    }
+
+    /* The first query of each value goes to the driver. */
+    /* Not GL_VERSION, which epoxy asks for itself. */
+    renderer = glGetString(GL_RENDERER);
+    expect_answered(0, "first glGetString");
+    if (glGetString(GL_RENDERER) != renderer || glGetString(GL_RENDERER) != renderer) {
+        fputs("glGetString(GL_RENDERER) changed\n", stderr);
+        pass = false;
+    }
+    expect_answered(2, "glGetString");
+
+    expect_integer(GL_MAJOR_VERSION, 4, "GL_MAJOR_VERSION");
+    expect_integer(GL_MAJOR_VERSION, 4, "cached GL_MAJOR_VERSION");
+    expect_integer(GL_MINOR_VERSION, 5, "GL_MINOR_VERSION");
+    expect_answered(1, "glGetIntegerv");
+
+    /* epoxy may have gone through the extensions itself. */
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensions);
+    if (extensions > 0) {
+        extension = glGetStringi(GL_EXTENSIONS, 0);
+        ignore_answered();
+        if (glGetStringi(GL_EXTENSIONS, 0) != extension) {
+            fputs("glGetStringi(GL_EXTENSIONS, 0) changed\n", stderr);
+            pass = false;
+        }
+        expect_answered(1, "glGetStringi");
+
+        /* The cached strings are epoxy's own, not the driver's, which
+         * may be gone by the time they're asked for again.
+         */
+        mock_driver_set_config("gl_extensions", "GL_EPOXY_replaced");
+        if (strcmp((const char *)glGetStringi(GL_EXTENSIONS, 0),
+                   "GL_ARB_vertex_buffer_object") != 0) {
+            fputs("The cached glGetStringi(GL_EXTENSIONS, 0) was the driver's\n",
+                  stderr);
+            pass = false;
+        }
+        ignore_answered();
+    }
+
+    /* The mock driver doesn't know about GL_MAX_TEXTURE_SIZE. */
+    expect_integer(GL_MAX_TEXTURE_SIZE, -1, "GL_MAX_TEXTURE_SIZE");
+    if (glGetError() != GL_INVALID_ENUM) {
+        fputs("GL_MAX_TEXTURE_SIZE didn't raise an error\n", stderr);
+        pass = false;
+    }
+    expect_integer(GL_MAX_TEXTURE_SIZE, -1, "GL_MAX_TEXTURE_SIZE again");
+    if (glGetError() != GL_INVALID_ENUM) {
+        fputs("The GL_MAX_TEXTURE_SIZE error got cached\n", stderr);
+        pass = false;
+    }
+    expect_answered(0, "glGetIntegerv raising an error");
+
+    /* Each context has a cache of its own. */
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, other);
+    glGetString(GL_RENDERER);
+    expect_answered(0, "glGetString on another context");
+    glGetString(GL_RENDERER);
+    expect_answered(1, "glGetString on another context again");
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx);
+    if (glGetString(GL_RENDERER) != renderer) {
+        fputs("glGetString(GL_RENDERER) changed with the context\n", stderr);
+        pass = false;
+    }
+    expect_answered(1, "glGetString back on the first context");
+
+    /* The shadow state answers what it knows, which the mock driver
+     * doesn't.
+     */
+    if (!epoxy_shadow_state_start())
+        errx(1, "Couldn't start the shadow state");
+    glUseProgram(4);
+    expect_integer(GL_CURRENT_PROGRAM, 4, "GL_CURRENT_PROGRAM");
+    glEnable(GL_BLEND);
+    if (!glIsEnabled(GL_BLEND)) {
+        fputs("GL_BLEND isn't enabled\n", stderr);
+        pass = false;
+    }
+    expect_answered(2, "queries of the shadow state");
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx);
+    expect_integer(GL_CURRENT_PROGRAM, -1, "GL_CURRENT_PROGRAM after eglMakeCurrent");
+    glGetError();
+    expect_answered(0, "queries after eglMakeCurrent");
+    epoxy_shadow_state_stop();
+
+    /* Still cached with just the query cache running. */
+    glGetString(GL_VERSION);
+    expect_answered(1, "glGetString after stopping the shadow state");
+
+    epoxy_query_cache_stop();
+    glGetString(GL_VERSION);
+    expect_answered(0, "glGetString after stopping");
+
+    if ((void *)glGetString != epoxy_lookup("glGetString")) {
+        fputs("glGetString is still cached\n", stderr);
+        pass = false;
+    }
+
+    mock_driver_lookups("glGetString", &dlsym_count, &proc_address_count);
+    if (dlsym_count + proc_address_count != 1) {
+        fprintf(stderr, "glGetString looked up %u times\n",
+                dlsym_count + proc_address_count);
+        pass = false;
+    }
+
+    return pass != true;
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+/**
+ * @file egl_mock_queue.c
+ *
+ * Runs GL calls through the command queue against the mock driver,
+ * checking that they get made on a thread that has the context current
+ * (the mock driver's GL only answers on those), that the calls that
+ * return something wait for their results, that draws wait until
+ * they've read the client-side arrays, and that the context and the
+ * function pointers are back where they were once it's stopped.
+ */
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "epoxy/gl.h"
+#include "epoxy/egl.h"
+
+#include "mock_driver.h"
+
+int
+main(int argc, char **argv)
+{
+    unsigned dlsym_count, proc_address_count;
+    const char *version;
+    EGLDisplay dpy;
+    EGLContext ctx;
+    GLint major = 0;
+    GLfloat vertices[] = { 1, 0, 2, 0, 3, 0 };
+    bool pass = true;
+    int i;
+
+    setenv("EPOXY_MOCK_WINDOW_SYSTEMS", "egl", true);
+    setenv("EPOXY_MOCK_GL_VERSION", "4.5", true);
+    /* Small enough for the calls below to wrap around it. */
+    setenv("EPOXY_QUEUE_SIZE", "65536", true);
+
+    dpy = mock_driver_init_egl();
+    ctx = mock_driver_create_egl_context(dpy, EGL_OPENGL_API, NULL);
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx);
+
+    /* Resolved before the queue starts, so that it has to carry it over. */
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    if (!epoxy_queue_start())
+        errx(77, "epoxy was built without the command queue");
+
+    if (epoxy_queue_start()) {
+        fputs("The queue started twice\n", stderr);
+        pass = false;
+    }
+
+    if ((void *)glClear == epoxy_lookup("glClear")) {
+        fputs("glClear isn't queued\n", stderr);
+        pass = false;
+    }
+
+    for (i = 0; i < 10000; i++) {
+        glViewport(1, 2, 3, 4);
+        glClearColor(0.5, 0.25, 0, 1);
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
+    eglSwapBuffers(dpy, EGL_NO_SURFACE);
+
+    /* Only the queue's thread has the context current. */
+    version = (const char *)glGetString(GL_VERSION);
+    if (!version || strncmp(version, "4.5", 3) != 0) {
+        fprintf(stderr, "glGetString(GL_VERSION) returned %s\n",
+                version ? version : "NULL");
+        pass = false;
+    }
+
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    if (major != 4) {
+        fprintf(stderr, "glGetIntegerv(GL_MAJOR_VERSION) returned %d\n", major);
+        pass = false;
+    }
+
+    glGetString(GL_RENDERER + 0x100);
+    if (glGetError() != GL_INVALID_ENUM) {
+        fputs("glGetError() didn't see the error\n", stderr);
+        pass = false;
+    }
+
+    /* A draw reads the client-side arrays before returning, even when
+     * the queue's thread takes its time.
+     */
+    epoxy_queue_finish();
+    mock_driver_set_config("latency_ns", "1000000");
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(2, GL_FLOAT, 0, vertices);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    vertices[0] = vertices[2] = vertices[4] = 0;
+    epoxy_queue_finish();
+    mock_driver_set_config("latency_ns", "0");
+    if (mock_driver_drawn() != 6) {
+        fprintf(stderr, "glDrawArrays() read %g, expected 6\n", mock_driver_drawn());
+        pass = false;
+    }
+
+    epoxy_queue_finish();
+    epoxy_queue_stop();
+
+    if ((void *)glClear != epoxy_lookup("glClear")) {
+        fputs("glClear is still queued\n", stderr);
+        pass = false;
+    }
+
+    if (eglGetCurrentContext() != ctx || !glGetString(GL_VERSION)) {
+        fputs("The context didn't come back\n", stderr);
+        pass = false;
+    }
+
+    mock_driver_lookups("glClear", &dlsym_count, &proc_address_count);
+    if (dlsym_count + proc_address_count != 1) {
+        fprintf(stderr, "glClear looked up %u times\n",
+                dlsym_count + proc_address_count);
+        pass = false;
+    }
+
+    return pass != true;
+}
@@ -0,0 +1,214 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * @file egl_mock_resolve_cache.c
+ *
+ * Runs itself over and over against the mock driver with
+ * EPOXY_RESOLVE_CACHE set, checking that a run against the same driver
+ * as the last one presets the functions from the cache without looking
+ * any of them up, and that the cache gets ignored when the GL version,
+ * the extensions or the library build-ids changed, or when the file is
+ * corrupt or truncated.
+ */
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "epoxy/gl.h"
+#include "epoxy/egl.h"
+
+#include "mock_driver.h"
+
+static const char *self;
+static char cache_path[] = "/tmp/epoxy-resolve-cache-XXXXXX";
+static bool pass = true;
+
+static unsigned
+lookups(const char *name)
+{
+    unsigned dlsym_count, proc_address_count;
+
+    mock_driver_lookups(name, &dlsym_count, &proc_address_count);
+    return dlsym_count + proc_address_count;
+}
+
+/* What each run does, exiting with how many times it looked up the
+ * functions that the cache should have had.
+ */
+static int
+child_main(void)
+{
+    static const GLfloat vertices[] = { 1, 2, 3 };
+    EGLDisplay dpy;
+    EGLContext ctx;
+
+    dpy = mock_driver_init_egl();
+    ctx = mock_driver_create_egl_context(dpy, EGL_OPENGL_API, NULL);
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx);
+
+    /* The cache gets loaded by the first resolve with a context
+     * current, which is this one.
+     */
+    glGetError();
+
+    glVertexPointer(1, GL_FLOAT, 0, vertices);
+    glDrawArrays(GL_POINTS, 0, 3);
+    if (mock_driver_drawn() != 6)
+        errx(100, "glDrawArrays() didn't reach the driver's");
+
+    return lookups("glVertexPointer") + lookups("glDrawArrays");
+}
+
+static void
+run(const char *gl_version, const char *gl_extensions,
+    int expected_lookups, const char *what)
+{
+    int status;
+    pid_t pid;
+
+    setenv("EPOXY_MOCK_GL_VERSION", gl_version, true);
+    setenv("EPOXY_MOCK_GL_EXTENSIONS", gl_extensions, true);
+
+    pid = fork();
+    if (pid < 0)
+        err(1, "fork");
+    if (pid == 0) {
+        execl(self, self, "child", NULL);
+        _exit(101);
+    }
+
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status))
+        errx(1, "%s: the run didn't exit", what);
+
+    if (WEXITSTATUS(status) != expected_lookups) {
+        fprintf(stderr, "%s: exited with %d, expected %d lookups\n",
+                what, WEXITSTATUS(status), expected_lookups);
+        pass = false;
+    }
+}
+
+static char *
+read_cache(void)
+{
+    FILE *file = fopen(cache_path, "r");
+    char *contents;
+    long size;
+
+    if (!file)
+        err(1, "Couldn't open %s", cache_path);
+
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    rewind(file);
+
+    contents = calloc(1, size + 1);
+    if (!contents || fread(contents, 1, size, file) != (size_t)size)
+        errx(1, "Couldn't read %s", cache_path);
+    fclose(file);
+
+    return contents;
+}
+
+static void
+write_cache(const char *contents, size_t size)
+{
+    FILE *file = fopen(cache_path, "w");
+
+    if (!file || fwrite(contents, 1, size, file) != size || fclose(file) != 0)
+        err(1, "Couldn't write %s", cache_path);
+}
+
+int
+main(int argc, char **argv)
+{
+    static const char *exts = "GL_ARB_vertex_buffer_object";
+    static const char *more_exts = "GL_ARB_vertex_buffer_object GL_KHR_debug";
+    char *contents, *library;
+    FILE *file;
+    int fd;
+
+    if (argc > 1 && strcmp(argv[1], "child") == 0)
+        return child_main();
+
+    self = argv[0];
+
+    fd = mkstemp(cache_path);
+    if (fd < 0)
+        err(1, "mkstemp");
+    close(fd);
+
+    setenv("EPOXY_MOCK_WINDOW_SYSTEMS", "egl", true);
+    setenv("EPOXY_RESOLVE_CACHE", cache_path, true);
+
+    run("4.5", exts, 2, "first run");
+
+    /* Without a build-id on the mock driver there's nothing to cache. */
+    contents = read_cache();
+    if (!strstr(contents, " glDrawArrays\n")) {
+        unlink(cache_path);
+        return 77;
+    }
+    free(contents);
+
+    run("4.5", exts, 0, "same driver");
+
+    run("4.6", exts, 2, "another GL version");
+    run("4.6", exts, 0, "same driver as the last run");
+
+    run("4.6", more_exts, 2, "other extensions");
+    run("4.6", more_exts, 0, "same extensions as the last run");
+
+    contents = read_cache();
+    library = strstr(contents, "library ");
+    if (!library)
+        errx(1, "The cache has no libraries:\n%s", contents);
+    for (library += strlen("library "); *library != '\n'; library++)
+        *library = '0';
+    write_cache(contents, strlen(contents));
+    free(contents);
+    run("4.6", more_exts, 2, "another library build-id");
+
+    /* Everything before the bad line is fine, but none of it may be
+     * used.
+     */
+    file = fopen(cache_path, "a");
+    if (!file || fputs("garbage\n", file) < 0 || fclose(file) != 0)
+        err(1, "Couldn't append to %s", cache_path);
+    run("4.6", more_exts, 2, "corrupt cache");
+
+    contents = read_cache();
+    write_cache(contents, strlen(contents) - 4);
+    free(contents);
+    run("4.6", more_exts, 2, "truncated cache");
+
+    run("4.6", more_exts, 0, "rewritten cache");
+
+    unlink(cache_path);
+
+    return pass ? 0 : 1;
+}
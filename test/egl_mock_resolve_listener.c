@@ -0,0 +1,168 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * @file egl_mock_resolve_listener.c
+ *
+ * Listens to the functions getting resolved against the mock driver,
+ * checking that each one is reported once, with the provider chosen
+ * for it, what looked it up and the libraries that got opened for it.
+ */
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "epoxy/gl.h"
+#include "epoxy/egl.h"
+
+#include "mock_driver.h"
+
+#define MAX_EVENTS 64
+
+struct resolved {
+    const char *name;
+    const char *provider;
+    const char *loader;
+    const char *library;
+    bool found;
+    bool times_add_up;
+};
+
+static struct resolved events[MAX_EVENTS];
+static int event_count;
+
+static void
+listener(const struct epoxy_resolve_event *event, void *data)
+{
+    struct resolved *resolved = &events[event_count];
+
+    if (data != &event_count)
+        errx(1, "Got the wrong listener data");
+    if (event_count == MAX_EVENTS)
+        errx(1, "Too many functions resolved");
+    event_count++;
+
+    resolved->name = event->name;
+    resolved->provider = event->provider;
+    resolved->loader = event->loader;
+    resolved->library = event->library_count ? event->libraries[0] : NULL;
+    resolved->found = event->function != NULL;
+    resolved->times_add_up =
+        event->elapsed_ns == event->condition_ns + event->load_ns &&
+        event->dlopen_ns <= event->elapsed_ns;
+}
+
+static bool
+check_resolved(const char *name, const char *provider, const char *loader,
+               const char *library)
+{
+    const struct resolved *resolved = NULL;
+    int i;
+
+    for (i = 0; i < event_count; i++) {
+        if (strcmp(events[i].name, name) != 0)
+            continue;
+        if (resolved) {
+            fprintf(stderr, "%s reported twice\n", name);
+            return false;
+        }
+        resolved = &events[i];
+    }
+
+    if (!resolved) {
+        fprintf(stderr, "%s not reported\n", name);
+        return false;
+    }
+
+    if (!resolved->found || !resolved->provider ||
+        strcmp(resolved->provider, provider) != 0 ||
+        strcmp(resolved->loader, loader) != 0) {
+        fprintf(stderr, "%s resolved from %s via %s, expected %s via %s\n",
+                name, resolved->provider ? resolved->provider : "nothing",
+                resolved->loader ? resolved->loader : "nothing",
+                provider, loader);
+        return false;
+    }
+
+    if (library && (!resolved->library ||
+                    strncmp(resolved->library, library, strlen(library)) != 0)) {
+        fprintf(stderr, "%s opened %s, expected %s\n", name,
+                resolved->library ? resolved->library : "nothing", library);
+        return false;
+    }
+
+    if (!resolved->times_add_up) {
+        fprintf(stderr, "%s took a different time than its parts\n", name);
+        return false;
+    }
+
+    return true;
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned dlsym_count, proc_address_count;
+    EGLDisplay dpy;
+    EGLContext ctx;
+    bool pass = true;
+    GLuint query;
+    int count;
+
+    setenv("EPOXY_MOCK_WINDOW_SYSTEMS", "egl", true);
+
+    epoxy_set_resolve_listener(listener, &event_count);
+
+    dpy = mock_driver_init_egl();
+    ctx = mock_driver_create_egl_context(dpy, EGL_OPENGL_API, NULL);
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx);
+
+    glClear(GL_COLOR_BUFFER_BIT);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glGenQueries(1, &query);
+
+    pass = check_resolved("eglGetDisplay", "EGL 10", "dlsym", "libEGL") && pass;
+    pass = check_resolved("glClear", "Desktop OpenGL 1.0", "dlsym", "libOpenGL") && pass;
+    /* Looked up by the context's GetProcAddress. */
+    pass = check_resolved("glGenQueries", "Desktop OpenGL 1.5",
+                          "eglGetProcAddress", NULL) && pass;
+
+    epoxy_set_resolve_listener(NULL, NULL);
+    count = event_count;
+    glViewport(0, 0, 1, 1);
+    if (event_count != count) {
+        fputs("Resolves reported without a listener\n", stderr);
+        pass = false;
+    }
+
+    mock_driver_lookups("glViewport", &dlsym_count, &proc_address_count);
+    if (dlsym_count + proc_address_count != 1) {
+        fprintf(stderr, "glViewport looked up %u times\n",
+                dlsym_count + proc_address_count);
+        pass = false;
+    }
+
+    return pass != true;
+}
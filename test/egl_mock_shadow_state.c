@@ -0,0 +1,203 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+/**
+ * @file egl_mock_shadow_state.c
+ *
+ * Runs the shadow state against the mock driver, checking which of the
+ * calls get dropped, that it forgets what it knows when it should,
+ * including after the calls that may make failed ones succeed and when
+ * another context gets made current behind epoxy's back, and that the
+ * function pointers go back to calling the driver directly once it's
+ * stopped.
+ */
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "epoxy/gl.h"
+#include "epoxy/egl.h"
+
+#include "mock_driver.h"
+
+static uint64_t last_dropped;
+static bool pass = true;
+
+static void
+expect_dropped(uint64_t count, const char *what)
+{
+    struct epoxy_shadow_state_stats stats;
+
+    epoxy_shadow_state_snapshot(&stats);
+    if (stats.dropped - last_dropped != count) {
+        fprintf(stderr, "%s: %llu calls dropped, expected %llu\n", what,
+                (unsigned long long)(stats.dropped - last_dropped),
+                (unsigned long long)count);
+        pass = false;
+    }
+    last_dropped = stats.dropped;
+}
+
+int
+main(int argc, char **argv)
+{
+    unsigned dlsym_count, proc_address_count;
+    struct epoxy_shadow_state_stats stats;
+    PFNEGLMAKECURRENTPROC make_current;
+    EGLDisplay dpy;
+    EGLContext ctx, other;
+    GLuint texture = 1, buffer;
+
+    setenv("EPOXY_MOCK_WINDOW_SYSTEMS", "egl", true);
+    setenv("EPOXY_MOCK_GL_PROFILE", "compat", true);
+
+    dpy = mock_driver_init_egl();
+    ctx = mock_driver_create_egl_context(dpy, EGL_OPENGL_API, NULL);
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx);
+
+    /* Resolved before it starts, so that it has to carry it over. */
+    glEnable(GL_BLEND);
+
+    if (!epoxy_shadow_state_start())
+        errx(77, "epoxy was built without the shadow state");
+
+    if ((void *)glEnable == epoxy_lookup("glEnable")) {
+        fputs("glEnable isn't shadowed\n", stderr);
+        pass = false;
+    }
+
+    /* It doesn't know what was set before it started. */
+    glEnable(GL_BLEND);
+    glEnable(GL_BLEND);
+    glEnable(GL_BLEND);
+    expect_dropped(2, "glEnable");
+    glDisable(GL_BLEND);
+    glEnable(GL_BLEND);
+    expect_dropped(0, "glDisable");
+    glEnable(GL_TEXTURE_2D);
+    glEnable(GL_TEXTURE_2D);
+    expect_dropped(0, "glEnable of a capability it doesn't know");
+    glEnablei(GL_BLEND, 1);
+    glEnable(GL_BLEND);
+    expect_dropped(0, "glEnable after glEnablei");
+
+    /* Textures are only kept track of once the unit is known. */
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, 1);
+    glBindTexture(GL_TEXTURE_2D, 1);
+    glBindTexture(GL_TEXTURE_3D, 1);
+    expect_dropped(1, "glBindTexture");
+    glActiveTexture(GL_TEXTURE1);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, 1);
+    expect_dropped(1, "glActiveTexture");
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, 1);
+    expect_dropped(1, "glBindTexture on another unit");
+    glActiveTexture(GL_TEXTURE0 + 40);
+    glActiveTexture(GL_TEXTURE0 + 40);
+    glBindTexture(GL_TEXTURE_2D, 1);
+    expect_dropped(0, "glActiveTexture past the last unit");
+    glDeleteTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, 1);
+    expect_dropped(0, "glBindTexture after glDeleteTextures");
+
+    glBindBuffer(GL_ARRAY_BUFFER, 2);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 3);
+    glBindBuffer(GL_ARRAY_BUFFER, 2);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 3);
+    expect_dropped(2, "glBindBuffer");
+    glBindVertexArray(1);
+    glBindBuffer(GL_ARRAY_BUFFER, 2);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 3);
+    expect_dropped(1, "glBindBuffer after glBindVertexArray");
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, 2);
+    expect_dropped(0, "glBindBuffer after glGenBuffers");
+
+    glUseProgram(4);
+    glUseProgram(4);
+    glUseProgram(0);
+    expect_dropped(1, "glUseProgram");
+    glUseProgram(5);
+    glLinkProgram(5);
+    glUseProgram(5);
+    expect_dropped(0, "glUseProgram after glLinkProgram");
+
+    glBlendFunc(GL_ONE, GL_ZERO);
+    glBlendFunc(GL_ONE, GL_ZERO);
+    glBlendFuncSeparate(GL_ONE, GL_ZERO, GL_ONE, GL_ZERO);
+    glBlendFuncSeparate(GL_ONE, GL_ZERO, GL_ZERO, GL_ZERO);
+    expect_dropped(2, "glBlendFunc");
+
+    /* Calls that go into a display list don't change the state. */
+    glNewList(1, GL_COMPILE);
+    glUseProgram(0);
+    glEndList();
+    glUseProgram(0);
+    expect_dropped(0, "glUseProgram after a display list");
+
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx);
+    glUseProgram(0);
+    glEnable(GL_BLEND);
+    expect_dropped(0, "calls after eglMakeCurrent");
+
+    make_current = mock_driver_dlsym("libEGL.so.1", "eglMakeCurrent");
+    other = mock_driver_create_egl_context(dpy, EGL_OPENGL_API, NULL);
+    make_current(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, other);
+    epoxy_handle_external_eglMakeCurrent();
+    glUseProgram(0);
+    glUseProgram(0);
+    expect_dropped(1, "glUseProgram on a context made current elsewhere");
+    make_current(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx);
+    glUseProgram(0);
+    expect_dropped(0, "glUseProgram on another context made current elsewhere");
+
+    epoxy_shadow_state_snapshot(&stats);
+    if (stats.calls != 51 || stats.invalidations != 13) {
+        fprintf(stderr, "%llu calls and %llu invalidations\n",
+                (unsigned long long)stats.calls,
+                (unsigned long long)stats.invalidations);
+        pass = false;
+    }
+
+    epoxy_shadow_state_stop();
+    glEnable(GL_BLEND);
+    expect_dropped(0, "glEnable after stopping");
+
+    if ((void *)glEnable != epoxy_lookup("glEnable")) {
+        fputs("glEnable is still shadowed\n", stderr);
+        pass = false;
+    }
+
+    mock_driver_lookups("glEnable", &dlsym_count, &proc_address_count);
+    if (dlsym_count + proc_address_count != 1) {
+        fprintf(stderr, "glEnable looked up %u times\n",
+                dlsym_count + proc_address_count);
+        pass = false;
+    }
+
+    return pass != true;
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * @file egl_mock_stats.c
+ *
+ * Runs with EPOXY_STATS=1 and every call timed against the mock driver,
+ * checking that the calls of every thread get counted, including the
+ * first ones that resolve the functions, that the functions still only
+ * get looked up once, and that buffer swaps count as frames.
+ */
+
+#include <err.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "epoxy/gl.h"
+#include "epoxy/egl.h"
+
+#include "mock_driver.h"
+
+#define THREADS 4
+#define CALLS 10
+#define FRAMES 3
+
+static EGLDisplay dpy;
+static EGLContext ctx;
+
+static void *
+make_calls(void *data)
+{
+    int i;
+
+    (void)data;
+
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx);
+    for (i = 0; i < CALLS; i++)
+        glIsEnabled(GL_DITHER);
+
+    return NULL;
+}
+
+static const struct epoxy_stats_entry *
+find_entry(const struct epoxy_stats *stats, const char *name)
+{
+    int i;
+
+    for (i = 0; i < stats->entry_count; i++) {
+        if (strcmp(stats->entries[i].name, name) == 0)
+            return &stats->entries[i];
+    }
+
+    return NULL;
+}
+
+static bool
+check_calls(const struct epoxy_stats *stats, const char *name, uint64_t calls)
+{
+    const struct epoxy_stats_entry *entry = find_entry(stats, name);
+    uint64_t counted = entry ? entry->calls : 0;
+
+    if (counted != calls) {
+        fprintf(stderr, "%s called %llu times, expected %llu\n", name,
+                (unsigned long long)counted, (unsigned long long)calls);
+        return false;
+    }
+
+    /* EPOXY_STATS_SAMPLE=1 times them all. */
+    if (entry && entry->sampled_calls != calls) {
+        fprintf(stderr, "%s timed %llu times, expected %llu\n", name,
+                (unsigned long long)entry->sampled_calls,
+                (unsigned long long)calls);
+        return false;
+    }
+
+    return true;
+}
+
+int
+main(int argc, char **argv)
+{
+    pthread_t threads[THREADS];
+    unsigned dlsym_count, proc_address_count;
+    struct epoxy_stats stats;
+    bool pass = true;
+    int i;
+
+    if (!epoxy_stats_snapshot(&stats))
+        errx(77, "epoxy was built without the statistics mode");
+    epoxy_stats_release(&stats);
+
+    setenv("EPOXY_MOCK_WINDOW_SYSTEMS", "egl", true);
+
+    dpy = mock_driver_init_egl();
+    ctx = mock_driver_create_egl_context(dpy, EGL_OPENGL_API, NULL);
+
+    for (i = 0; i < THREADS; i++)
+        pthread_create(&threads[i], NULL, make_calls, NULL);
+    for (i = 0; i < THREADS; i++)
+        pthread_join(threads[i], NULL);
+
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx);
+    for (i = 0; i < FRAMES; i++) {
+        glClear(GL_COLOR_BUFFER_BIT);
+        eglSwapBuffers(dpy, EGL_NO_SURFACE);
+    }
+
+    mock_driver_lookups("glClear", &dlsym_count, &proc_address_count);
+    if (dlsym_count + proc_address_count != 1) {
+        fprintf(stderr, "glClear looked up %u times\n",
+                dlsym_count + proc_address_count);
+        pass = false;
+    }
+
+    if (!epoxy_stats_snapshot(&stats))
+        errx(1, "Couldn't read the stats");
+
+    if (stats.frames != FRAMES) {
+        fprintf(stderr, "%llu frames, expected %d\n",
+                (unsigned long long)stats.frames, FRAMES);
+        pass = false;
+    }
+
+    pass = check_calls(&stats, "glIsEnabled", THREADS * CALLS) && pass;
+    pass = check_calls(&stats, "glClear", FRAMES) && pass;
+    pass = check_calls(&stats, "eglSwapBuffers", FRAMES) && pass;
+    /* Wrapped functions count the calls that get to the driver. */
+    pass = check_calls(&stats, "eglMakeCurrent", THREADS + 1) && pass;
+    pass = check_calls(&stats, "glDrawArrays", 0) && pass;
+
+    epoxy_stats_release(&stats);
+
+    return pass != true;
+}
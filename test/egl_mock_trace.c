@@ -0,0 +1,144 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * @file egl_mock_trace.c
+ *
+ * Starts and stops tracing at runtime against the mock driver,
+ * checking that the calls made in between get written out with their
+ * arguments, and that the function pointers go back to calling the
+ * driver directly once it's stopped.
+ */
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "epoxy/gl.h"
+#include "epoxy/egl.h"
+
+#include "mock_driver.h"
+
+static char *
+read_file(const char *path)
+{
+    static char contents[65536];
+    FILE *file = fopen(path, "r");
+    size_t size;
+
+    if (!file)
+        errx(1, "Couldn't read %s", path);
+    size = fread(contents, 1, sizeof(contents) - 1, file);
+    contents[size] = '\0';
+    fclose(file);
+
+    return contents;
+}
+
+static bool
+check_trace(const char *trace, const char *event, bool present)
+{
+    if ((strstr(trace, event) != NULL) != present) {
+        fprintf(stderr, "%s %s in the trace:\n%s\n", event,
+                present ? "missing" : "unexpectedly", trace);
+        return false;
+    }
+
+    return true;
+}
+
+int
+main(int argc, char **argv)
+{
+    char path[] = "/tmp/epoxy-trace-XXXXXX";
+    unsigned dlsym_count, proc_address_count;
+    const char *trace;
+    EGLDisplay dpy;
+    EGLContext ctx;
+    bool pass = true;
+    int fd;
+
+    setenv("EPOXY_MOCK_WINDOW_SYSTEMS", "egl", true);
+
+    dpy = mock_driver_init_egl();
+    ctx = mock_driver_create_egl_context(dpy, EGL_OPENGL_API, NULL);
+    eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx);
+
+    /* Resolved before tracing starts, so that it has to carry it over. */
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    if (!epoxy_trace_start())
+        errx(77, "epoxy was built without the tracing mode");
+
+    if ((void *)glClear == epoxy_lookup("glClear")) {
+        fputs("glClear isn't traced\n", stderr);
+        pass = false;
+    }
+
+    glViewport(1, 2, 3, 4);
+    glClearColor(0.5, 0.25, 0, 1);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    epoxy_trace_stop();
+    glFlush();
+
+    if ((void *)glClear != epoxy_lookup("glClear")) {
+        fputs("glClear is still traced\n", stderr);
+        pass = false;
+    }
+
+    mock_driver_lookups("glClear", &dlsym_count, &proc_address_count);
+    if (dlsym_count + proc_address_count != 1) {
+        fprintf(stderr, "glClear looked up %u times\n",
+                dlsym_count + proc_address_count);
+        pass = false;
+    }
+
+    fd = mkstemp(path);
+    if (fd < 0)
+        errx(1, "Couldn't create a temporary file");
+    close(fd);
+
+    if (!epoxy_trace_flush(path, 0))
+        errx(1, "Couldn't flush the trace");
+    trace = read_file(path);
+
+    pass = check_trace(trace, "{\"traceEvents\":[", true) && pass;
+    pass = check_trace(trace, "\"name\":\"glViewport\",\"cat\":\"gl\"", true) && pass;
+    pass = check_trace(trace, "\"args\":{\"arg0\":1,\"arg1\":2,\"arg2\":3,\"arg3\":4}", true) && pass;
+    pass = check_trace(trace, "\"args\":{\"arg0\":0.5,\"arg1\":0.25,\"arg2\":0,\"arg3\":1}", true) && pass;
+    pass = check_trace(trace, "\"name\":\"glClear\"", true) && pass;
+    pass = check_trace(trace, "\"name\":\"glFlush\"", false) && pass;
+
+    /* What got flushed once doesn't get flushed again. */
+    if (!epoxy_trace_flush(path, 0))
+        errx(1, "Couldn't flush the trace");
+    trace = read_file(path);
+    pass = check_trace(trace, "\"name\"", false) && pass;
+
+    unlink(path);
+
+    return pass != true;
+}
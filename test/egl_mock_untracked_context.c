@@ -0,0 +1,107 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * @file egl_mock_untracked_context.c
+ *
+ * Makes contexts current and destroys them through the mock driver's
+ * own EGL entrypoints, as toolkits that look the driver up themselves
+ * do, checking that a context that gets a destroyed one's handle isn't
+ * taken for it once epoxy finds it current after another.  Then makes
+ * and destroys many contexts through epoxy, for the states of the
+ * destroyed ones to be freed.
+ */
+
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "epoxy/gl.h"
+#include "epoxy/egl.h"
+
+#include "mock_driver.h"
+
+static bool pass = true;
+
+static void
+expect_version(int version, const char *what)
+{
+    if (epoxy_gl_version() != version) {
+        fprintf(stderr, "%s: GL version %d, expected %d\n", what,
+                epoxy_gl_version(), version);
+        pass = false;
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    PFNEGLMAKECURRENTPROC make_current;
+    PFNEGLDESTROYCONTEXTPROC destroy_context;
+    EGLDisplay dpy;
+    EGLContext ctx, other, reused;
+    int i;
+
+    setenv("EPOXY_MOCK_WINDOW_SYSTEMS", "egl", true);
+    setenv("EPOXY_MOCK_GL_VERSION", "4.5", true);
+
+    make_current = mock_driver_dlsym("libEGL.so.1", "eglMakeCurrent");
+    destroy_context = mock_driver_dlsym("libEGL.so.1", "eglDestroyContext");
+    if (!make_current || !destroy_context)
+        errx(1, "The mock driver has no EGL entrypoints");
+
+    dpy = mock_driver_init_egl();
+    ctx = mock_driver_create_egl_context(dpy, EGL_OPENGL_API, NULL);
+    other = mock_driver_create_egl_context(dpy, EGL_OPENGL_API, NULL);
+
+    make_current(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx);
+    expect_version(45, "first context");
+    make_current(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, other);
+    expect_version(45, "second context");
+
+    destroy_context(dpy, ctx);
+    mock_driver_set_config("gl_version", "3.3");
+    reused = mock_driver_create_egl_context(dpy, EGL_OPENGL_API, NULL);
+    if (reused != ctx)
+        errx(77, "The new context didn't get the old one's handle");
+
+    make_current(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, reused);
+    expect_version(33, "context with a destroyed one's handle");
+    make_current(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, other);
+    expect_version(45, "second context again");
+    make_current(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, reused);
+    expect_version(33, "context with a destroyed one's handle again");
+    make_current(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+    for (i = 0; i < 1000; i++) {
+        ctx = mock_driver_create_egl_context(dpy, EGL_OPENGL_API, NULL);
+        eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx);
+        expect_version(33, "short-lived context");
+        epoxy_has_gl_extension("GL_KHR_debug");
+        glClear(GL_COLOR_BUFFER_BIT);
+        eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(dpy, ctx);
+    }
+
+    return pass ? 0 : 1;
+}
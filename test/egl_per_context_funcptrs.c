@@ -0,0 +1,153 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * @file egl_per_context_funcptrs.c
+ *
+ * Tests that epoxy keeps separate function pointers for a desktop GL
+ * and a GLES context on the same EGL display.
+ *
+ * Both contexts' functions come from different libraries, so once
+ * the GLES context shows up, the pointers that the desktop context
+ * resolved globally can't be used for it any more.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <err.h>
+#include "epoxy/gl.h"
+#include "epoxy/egl.h"
+
+#include "egl_common.h"
+
+static EGLContext
+create_context(EGLDisplay *dpy, EGLConfig cfg, EGLenum api)
+{
+    static const EGLint context_attribs[] = {
+        EGL_CONTEXT_CLIENT_VERSION, 2,
+        EGL_NONE
+    };
+    EGLContext ctx;
+
+    if (!eglBindAPI(api))
+        errx(77, "Couldn't bind the %s API\n",
+             api == EGL_OPENGL_API ? "desktop GL" : "GLES");
+
+    ctx = eglCreateContext(dpy, cfg, NULL, context_attribs);
+    if (!ctx)
+        errx(77, "Couldn't create a %s context\n",
+             api == EGL_OPENGL_API ? "desktop GL" : "GLES");
+
+    return ctx;
+}
+
+static bool
+make_current_and_test(EGLDisplay *dpy, EGLContext ctx, bool desktop,
+                      void **get_string)
+{
+    const char *string;
+    bool is_es;
+    GLuint shader;
+    bool pass = true;
+
+    eglMakeCurrent(dpy, NULL, NULL, ctx);
+
+    string = (const char *)glGetString(GL_VERSION);
+    printf("GL version: %s\n", string);
+
+    is_es = strncmp(string, "OpenGL ES", strlen("OpenGL ES")) == 0;
+    if (is_es == desktop) {
+        fprintf(stderr, "Got a %s context's version from a %s context\n",
+                is_es ? "GLES" : "desktop GL",
+                desktop ? "desktop GL" : "GLES");
+        pass = false;
+    }
+
+    if (epoxy_is_desktop_gl() != desktop) {
+        fprintf(stderr, "Claimed to%s be desktop\n", desktop ? " not" : "");
+        pass = false;
+    }
+
+    shader = glCreateShader(GL_FRAGMENT_SHADER);
+    if (!glIsShader(shader)) {
+        fputs("Couldn't create a shader\n", stderr);
+        pass = false;
+    }
+    glDeleteShader(shader);
+
+    if (*get_string && *get_string != epoxy_lookup("glGetString")) {
+        fputs("glGetString changed when making the context current again\n",
+              stderr);
+        pass = false;
+    }
+    *get_string = epoxy_lookup("glGetString");
+
+    return pass;
+}
+
+int
+main(int argc, char **argv)
+{
+    bool pass = true;
+    EGLDisplay *dpy = get_egl_display_or_skip();
+    static const EGLint config_attribs[] = {
+	EGL_SURFACE_TYPE, EGL_WINDOW_BIT,
+	EGL_RED_SIZE, 1,
+	EGL_GREEN_SIZE, 1,
+	EGL_BLUE_SIZE, 1,
+	EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT | EGL_OPENGL_ES2_BIT,
+	EGL_NONE
+    };
+    EGLContext gl_ctx, gles_ctx;
+    void *gl_get_string = NULL, *gles_get_string = NULL;
+    EGLConfig cfg;
+    EGLint count;
+    int i;
+
+    if (!epoxy_has_egl_extension(dpy, "EGL_KHR_surfaceless_context"))
+        errx(77, "Test requires EGL_KHR_surfaceless_context");
+
+    if (!eglChooseConfig(dpy, config_attribs, &cfg, 1, &count) || !count)
+        errx(77, "Couldn't get an EGLConfig\n");
+
+    gl_ctx = create_context(dpy, cfg, EGL_OPENGL_API);
+    gles_ctx = create_context(dpy, cfg, EGL_OPENGL_ES_API);
+
+    /* The desktop context goes first, so that its functions have
+     * already been resolved globally when the GLES context shows up.
+     */
+    for (i = 0; i < 2; i++) {
+        pass = make_current_and_test(dpy, gl_ctx, true,
+                                     &gl_get_string) && pass;
+        pass = make_current_and_test(dpy, gles_ctx, false,
+                                     &gles_get_string) && pass;
+    }
+
+    if (gl_get_string == gles_get_string) {
+        fputs("Desktop GL and GLES share a glGetString\n", stderr);
+        pass = false;
+    }
+
+    return pass != true;
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * @file egl_pointer_copy.c
+ *
+ * Tests that resolving a function updates the function pointer that
+ * the program calls through.
+ *
+ * An executable may have its own copy of the pointers it refers to
+ * (through copy relocations, as x86-64 executables normally do), so
+ * that's the one that epoxy has to update, not its own.
+ */
+
+#include <stdio.h>
+#include <err.h>
+#include "epoxy/egl.h"
+
+int
+main(int argc, char **argv)
+{
+    PFNEGLGETCURRENTCONTEXTPROC thunk = epoxy_eglGetCurrentContext;
+
+    if (eglGetCurrentContext() != EGL_NO_CONTEXT)
+        errx(1, "A context was current at startup");
+
+    if (epoxy_eglGetCurrentContext == thunk)
+        errx(1, "eglGetCurrentContext() is still called through its thunk");
+
+    return 0;
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * @file glx_mock_extension_sets.c
+ *
+ * Checks that epoxy_has_glx_extension() keeps answering from what a
+ * display reported until Xlib closes it, that displays opened and
+ * closed over and over don't stop it from keeping what new ones
+ * report, and that it asks every time about a display it can't hear
+ * getting closed.  Xlib's extension hooks are faked here, and found by
+ * epoxy through -rdynamic.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "epoxy/glx.h"
+#include <X11/Xlibint.h>
+
+#include "mock_driver.h"
+
+typedef int (*close_display_proc)(Display *dpy, XExtCodes *codes);
+
+static char displays[100];
+static close_display_proc close_procs[100];
+static XExtCodes codes[100];
+static bool hooks_missing;
+static bool pass = true;
+
+static Display *
+display(int i)
+{
+    return (Display *)&displays[i];
+}
+
+XExtCodes *
+XAddExtension(Display *dpy)
+{
+    int i = (char *)dpy - displays;
+
+    if (hooks_missing)
+        return NULL;
+
+    codes[i].extension = 128 + i;
+    return &codes[i];
+}
+
+close_display_proc
+XESetCloseDisplay(Display *dpy, int extension, close_display_proc proc)
+{
+    int i = (char *)dpy - displays;
+
+    if (extension != codes[i].extension)
+        errx(1, "Wrong extension number for display %d", i);
+    close_procs[i] = proc;
+    return NULL;
+}
+
+static void
+close_display(int i)
+{
+    if (close_procs[i])
+        close_procs[i](display(i), &codes[i]);
+    close_procs[i] = NULL;
+}
+
+static void
+expect(int i, const char *present, const char *absent, const char *when)
+{
+    if (present && !epoxy_has_glx_extension(display(i), 0, present)) {
+        fprintf(stderr, "%s: %s missing\n", when, present);
+        pass = false;
+    }
+
+    if (absent && epoxy_has_glx_extension(display(i), 0, absent)) {
+        fprintf(stderr, "%s: %s present\n", when, absent);
+        pass = false;
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    int i;
+
+    setenv("EPOXY_MOCK_WINDOW_SYSTEMS", "glx", true);
+    setenv("EPOXY_MOCK_GLX_EXTENSIONS", "GLX_ARB_create_context", true);
+
+    expect(0, "GLX_ARB_create_context", "GLX_ARB_create", "first display");
+
+    /* Not asked again until the display gets closed. */
+    mock_driver_set_config("glx_extensions", "GLX_EXT_swap_control");
+    expect(0, "GLX_ARB_create_context", "GLX_EXT_swap_control",
+           "before closing");
+    close_display(0);
+    expect(0, "GLX_EXT_swap_control", "GLX_ARB_create_context",
+           "after closing");
+    close_display(0);
+
+    /* A display that can't be watched doesn't get anything kept. */
+    hooks_missing = true;
+    expect(99, "GLX_EXT_swap_control", NULL, "unwatched display");
+    mock_driver_set_config("glx_extensions", "GLX_ARB_create_context");
+    expect(99, "GLX_ARB_create_context", "GLX_EXT_swap_control",
+           "unwatched display, asked again");
+    hooks_missing = false;
+
+    /* Far more displays than get kept at once, one after the other. */
+    for (i = 1; i < 90; i++) {
+        expect(i, "GLX_ARB_create_context", NULL, "short-lived displays");
+        close_display(i);
+    }
+    expect(90, "GLX_ARB_create_context", NULL, "after many closes");
+    mock_driver_set_config("glx_extensions", "GLX_EXT_swap_control");
+    expect(90, "GLX_ARB_create_context", "GLX_EXT_swap_control",
+           "kept after many closes");
+
+    /* Opened again at the same address, reporting the same as before. */
+    mock_driver_set_config("glx_extensions", "GLX_ARB_create_context");
+    expect(1, "GLX_ARB_create_context", NULL, "display opened again");
+    mock_driver_set_config("glx_extensions", "GLX_EXT_swap_control");
+    expect(1, "GLX_ARB_create_context", "GLX_EXT_swap_control",
+           "display opened again, before closing");
+    close_display(1);
+    expect(1, "GLX_EXT_swap_control", "GLX_ARB_create_context",
+           "display opened again, after closing");
+
+    return pass != true;
+}
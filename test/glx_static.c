@@ -31,6 +31,11 @@
  *
  * Note that if configured without --enable-static, this test will end
  * up dynamically linked anyway, defeating the test.
+ *
+ * Built with EPOXY_GL_IFUNC, it instead calls the GL entrypoints that
+ * epoxy exports as IFUNCs when configured with -Difunc=true, which get
+ * bound to the driver or to epoxy's thunks depending on whether they
+ * are resolved lazily or when the program is loaded.
  */
 
 #include <stdio.h>
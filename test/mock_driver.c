@@ -0,0 +1,1201 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * @file mock_driver.c
+ *
+ * A fake GL, EGL and GLX driver, so that the tests and benchmarks can
+ * run the same way on any machine, without a GPU or a window system.
+ *
+ * It gets built together with dlwrap.c into a library that either
+ * gets linked into a test or preloaded with LD_PRELOAD, and then
+ * epoxy's dlopen() of libGL, libEGL, libGLESv2 and so on gets the
+ * mock instead.  Only the entrypoints that epoxy itself relies on are
+ * implemented (strings, versions, contexts and making them current),
+ * plus glVertexPointer() and glDrawArrays() far enough to tell what a
+ * draw read from client memory; any other name that the configuration
+ * lets be looked up gets a stub that does nothing and returns 0.
+ *
+ * The configuration is read from the file named by EPOXY_MOCK_CONFIG,
+ * with a "key = value" per line, and then from EPOXY_MOCK_<KEY>
+ * environment variables, which take precedence:
+ *
+ *     gl_version       desktop GL version, "4.6"
+ *     gl_profile       "core" or "compat"
+ *     gl_extensions    desktop GL extensions
+ *     gles_version     version of GLES 2+ contexts, "3.2"
+ *     gles_extensions  GLES extensions
+ *     apis             client APIs the driver has, "gl gles"
+ *     window_systems   "egl glx"
+ *     egl_version, egl_extensions, egl_client_extensions
+ *     glx_version, glx_extensions
+ *     dlsym            names that dlsym() finds in the libraries
+ *                      they'd be in, as fnmatch() patterns
+ *     proc_address     names GetProcAddress finds, as patterns
+ *     latency_ns       time every call takes
+ */
+
+#define _GNU_SOURCE
+
+#include <fnmatch.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "epoxy/gl.h"
+#include "epoxy/egl.h"
+
+#include "mock_driver.h"
+
+/* From GL/glx.h and GL/glxext.h, which need Xlib. */
+#define GLX_VENDOR 1
+#define GLX_VERSION 2
+#define GLX_EXTENSIONS 3
+#define GLX_SCREEN 0x800C
+#define GLX_CONTEXT_PROFILE_MASK_ARB 0x9126
+#define GLX_CONTEXT_ES2_PROFILE_BIT_EXT 0x00000004
+
+#define ARRAY_SIZE(arr) (sizeof(arr) / sizeof(arr[0]))
+
+struct word_list {
+    char *string;
+    char *storage;
+    char **words;
+    unsigned count;
+};
+
+static struct mock_config {
+    char *gl_version;
+    char *gl_profile;
+    struct word_list gl_extensions;
+    char *gles_version;
+    struct word_list gles_extensions;
+    struct word_list apis;
+    struct word_list window_systems;
+    char *egl_version;
+    struct word_list egl_extensions;
+    struct word_list egl_client_extensions;
+    char *glx_version;
+    struct word_list glx_extensions;
+    struct word_list dlsym;
+    struct word_list proc_address;
+    long latency_ns;
+} config;
+
+enum value_type {
+    VALUE_STRING,
+    VALUE_WORDS,
+    VALUE_LONG,
+};
+
+static const struct config_key {
+    const char *name;
+    enum value_type type;
+    size_t offset;
+    const char *default_value;
+} config_keys[] = {
+#define KEY(name, type, default_value) \
+    { #name, type, offsetof(struct mock_config, name), default_value }
+    KEY(gl_version, VALUE_STRING, "4.6"),
+    KEY(gl_profile, VALUE_STRING, "compat"),
+    KEY(gl_extensions, VALUE_WORDS,
+        "GL_ARB_vertex_buffer_object GL_ARB_framebuffer_object "
+        "GL_ARB_direct_state_access GL_KHR_debug"),
+    KEY(gles_version, VALUE_STRING, "3.2"),
+    KEY(gles_extensions, VALUE_WORDS,
+        "GL_OES_EGL_image GL_EXT_texture_format_BGRA8888 GL_KHR_debug"),
+    KEY(apis, VALUE_WORDS, "gl gles"),
+    KEY(window_systems, VALUE_WORDS, "egl glx"),
+    KEY(egl_version, VALUE_STRING, "1.5"),
+    KEY(egl_extensions, VALUE_WORDS,
+        "EGL_KHR_create_context EGL_KHR_surfaceless_context "
+        "EGL_KHR_no_config_context"),
+    KEY(egl_client_extensions, VALUE_WORDS,
+        "EGL_EXT_client_extensions EGL_EXT_platform_base "
+        "EGL_MESA_platform_surfaceless"),
+    KEY(glx_version, VALUE_STRING, "1.4"),
+    KEY(glx_extensions, VALUE_WORDS,
+        "GLX_ARB_create_context GLX_ARB_create_context_profile "
+        "GLX_EXT_create_context_es2_profile"),
+    KEY(dlsym, VALUE_WORDS, "*"),
+    KEY(proc_address, VALUE_WORDS, "*"),
+    KEY(latency_ns, VALUE_LONG, "0"),
+#undef KEY
+};
+
+static pthread_once_t config_once = PTHREAD_ONCE_INIT;
+
+struct mock_context {
+    EGLenum api;
+    int client_version;
+    bool core;
+    char version[64];
+    const struct word_list *extensions;
+    GLenum error;
+    /* What glVertexPointer() set, as GLfloats. */
+    const GLfloat *vertices;
+    GLint vertex_stride;
+    /* How many threads have it current, and whether it's been
+     * destroyed, which frees it once none do.
+     */
+    int current_count;
+    bool destroyed;
+    struct mock_context *next_free;
+};
+
+struct mock_display {
+    bool initialized;
+};
+
+static struct mock_display display;
+static int config_placeholder;
+static pthread_mutex_t context_mutex = PTHREAD_MUTEX_INITIALIZER;
+/* Freed contexts, which new ones reuse first, so their handles come back. */
+static struct mock_context *free_contexts;
+/* What the last glDrawArrays() on any thread read, also under the mutex. */
+static float drawn;
+
+static __thread struct mock_context *current;
+static __thread bool current_is_glx;
+static __thread void *current_display;
+static __thread void *current_drawable;
+static __thread EGLenum bound_api = EGL_OPENGL_ES_API;
+static __thread EGLint egl_error = EGL_SUCCESS;
+
+#define MAX_LOOKUP_NAMES 1024
+
+static struct lookup_count {
+    char *name;
+    unsigned dlsym;
+    unsigned proc_address;
+} lookup_counts[MAX_LOOKUP_NAMES];
+static pthread_mutex_t lookup_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void
+split_words(struct word_list *list, const char *string)
+{
+    char *word, *save;
+
+    free(list->string);
+    free(list->storage);
+    free(list->words);
+
+    list->string = strdup(string);
+    list->words = NULL;
+    list->count = 0;
+
+    /* Tokenize a copy, so that string stays usable as the list. */
+    list->storage = strdup(string);
+    for (word = strtok_r(list->storage, " \t", &save); word;
+         word = strtok_r(NULL, " \t", &save)) {
+        list->words = realloc(list->words, (list->count + 1) * sizeof(char *));
+        list->words[list->count++] = word;
+    }
+}
+
+static bool
+has_word(const struct word_list *list, const char *word)
+{
+    unsigned i;
+
+    for (i = 0; i < list->count; i++) {
+        if (strcmp(list->words[i], word) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+static bool
+matches_pattern(const struct word_list *patterns, const char *name)
+{
+    unsigned i;
+
+    for (i = 0; i < patterns->count; i++) {
+        if (fnmatch(patterns->words[i], name, 0) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+static void
+set_value(const struct config_key *key, const char *value)
+{
+    void *field = (char *)&config + key->offset;
+
+    switch (key->type) {
+    case VALUE_STRING:
+        free(*(char **)field);
+        *(char **)field = strdup(value);
+        break;
+    case VALUE_WORDS:
+        split_words(field, value);
+        break;
+    case VALUE_LONG:
+        *(long *)field = strtol(value, NULL, 0);
+        break;
+    }
+}
+
+static const struct config_key *
+find_key(const char *name)
+{
+    unsigned i;
+
+    for (i = 0; i < ARRAY_SIZE(config_keys); i++) {
+        if (strcmp(config_keys[i].name, name) == 0)
+            return &config_keys[i];
+    }
+
+    return NULL;
+}
+
+static char *
+trim(char *s)
+{
+    char *end;
+
+    s += strspn(s, " \t");
+    end = s + strlen(s);
+    while (end > s && strchr(" \t\r\n", end[-1]))
+        end--;
+    *end = '\0';
+
+    return s;
+}
+
+static void
+read_config_file(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    char line[4096];
+    int line_number = 0;
+
+    if (!file) {
+        fprintf(stderr, "mock driver: couldn't open %s\n", path);
+        abort();
+    }
+
+    while (fgets(line, sizeof(line), file)) {
+        const struct config_key *key;
+        char *name, *value;
+
+        line_number++;
+        name = trim(line);
+        if (name[0] == '\0' || name[0] == '#')
+            continue;
+
+        value = strchr(name, '=');
+        if (!value) {
+            fprintf(stderr, "mock driver: %s:%d: expected key = value\n",
+                    path, line_number);
+            abort();
+        }
+        *value++ = '\0';
+
+        key = find_key(trim(name));
+        if (!key) {
+            fprintf(stderr, "mock driver: %s:%d: unknown key %s\n",
+                    path, line_number, trim(name));
+            abort();
+        }
+        set_value(key, trim(value));
+    }
+
+    fclose(file);
+}
+
+static void
+load_config(void)
+{
+    const char *path = getenv("EPOXY_MOCK_CONFIG");
+    unsigned i;
+
+    for (i = 0; i < ARRAY_SIZE(config_keys); i++)
+        set_value(&config_keys[i], config_keys[i].default_value);
+
+    if (path)
+        read_config_file(path);
+
+    for (i = 0; i < ARRAY_SIZE(config_keys); i++) {
+        char env_name[64] = "EPOXY_MOCK_";
+        const char *value;
+        char *c;
+
+        strcat(env_name, config_keys[i].name);
+        for (c = env_name; *c; c++)
+            *c = *c >= 'a' && *c <= 'z' ? *c - 'a' + 'A' : *c;
+
+        value = getenv(env_name);
+        if (value)
+            set_value(&config_keys[i], value);
+    }
+}
+
+static const struct mock_config *
+get_config(void)
+{
+    pthread_once(&config_once, load_config);
+    return &config;
+}
+
+static void
+delay(void)
+{
+    long latency = get_config()->latency_ns;
+    struct timespec start, now;
+
+    if (latency <= 0)
+        return;
+
+    /* Spin rather than sleep, since sleeps are far too coarse. */
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    } while ((now.tv_sec - start.tv_sec) * 1000000000L +
+             (now.tv_nsec - start.tv_nsec) < latency);
+}
+
+/* Called with context_mutex held. */
+static void
+free_context(struct mock_context *ctx)
+{
+    ctx->next_free = free_contexts;
+    free_contexts = ctx;
+}
+
+static void
+make_current(struct mock_context *ctx, bool glx, void *dpy, void *drawable)
+{
+    struct mock_context *old = current;
+
+    /* Like with libglvnd, a thread has one current context, whichever
+     * window system made it current.
+     */
+    pthread_mutex_lock(&context_mutex);
+    if (ctx)
+        ctx->current_count++;
+    if (old && --old->current_count == 0 && old->destroyed)
+        free_context(old);
+    pthread_mutex_unlock(&context_mutex);
+
+    current = ctx;
+    current_is_glx = ctx && glx;
+    current_display = ctx ? dpy : NULL;
+    current_drawable = ctx ? drawable : NULL;
+}
+
+static struct mock_context *
+create_context(EGLenum api, int client_version, bool core)
+{
+    const struct mock_config *cfg = get_config();
+    struct mock_context *ctx;
+
+    if (!has_word(&cfg->apis, api == EGL_OPENGL_API ? "gl" : "gles"))
+        return NULL;
+
+    pthread_mutex_lock(&context_mutex);
+    ctx = free_contexts;
+    if (ctx)
+        free_contexts = ctx->next_free;
+    pthread_mutex_unlock(&context_mutex);
+
+    if (ctx)
+        memset(ctx, 0, sizeof(*ctx));
+    else
+        ctx = calloc(1, sizeof(*ctx));
+    ctx->api = api;
+    ctx->client_version = client_version;
+    ctx->error = GL_NO_ERROR;
+
+    if (api == EGL_OPENGL_API) {
+        int major = atoi(cfg->gl_version);
+
+        ctx->core = core || strcmp(cfg->gl_profile, "core") == 0;
+        ctx->extensions = &cfg->gl_extensions;
+        if (major < 3)
+            snprintf(ctx->version, sizeof(ctx->version), "%s Mock",
+                     cfg->gl_version);
+        else
+            snprintf(ctx->version, sizeof(ctx->version), "%s (%s Profile) Mock",
+                     cfg->gl_version, ctx->core ? "Core" : "Compatibility");
+    } else {
+        ctx->extensions = &cfg->gles_extensions;
+        if (client_version < 2) {
+            snprintf(ctx->version, sizeof(ctx->version), "OpenGL ES-CM 1.1 Mock");
+        } else {
+            ctx->client_version = atoi(cfg->gles_version);
+            snprintf(ctx->version, sizeof(ctx->version), "OpenGL ES %s Mock",
+                     cfg->gles_version);
+        }
+    }
+
+    return ctx;
+}
+
+static void
+parse_version(const char *version, int *major, int *minor)
+{
+    if (sscanf(version, "%d.%d", major, minor) != 2) {
+        *major = atoi(version);
+        *minor = 0;
+    }
+}
+
+/* GL */
+
+static const GLubyte *
+mock_glGetString(GLenum name)
+{
+    delay();
+
+    if (!current)
+        return NULL;
+
+    switch (name) {
+    case GL_VENDOR:
+    case GL_RENDERER:
+        return (const GLubyte *)"Mock";
+    case GL_VERSION:
+        return (const GLubyte *)current->version;
+    case GL_SHADING_LANGUAGE_VERSION:
+        return (const GLubyte *)(current->api == EGL_OPENGL_API ?
+                                 "4.60" : "OpenGL ES GLSL ES 3.20");
+    case GL_EXTENSIONS:
+        /* Gone from core profiles, in favor of glGetStringi(). */
+        if (!current->core)
+            return (const GLubyte *)current->extensions->string;
+        break;
+    }
+
+    current->error = GL_INVALID_ENUM;
+    return NULL;
+}
+
+static const GLubyte *
+mock_glGetStringi(GLenum name, GLuint index)
+{
+    delay();
+
+    if (!current)
+        return NULL;
+
+    if (name != GL_EXTENSIONS || index >= current->extensions->count) {
+        current->error = GL_INVALID_VALUE;
+        return NULL;
+    }
+
+    return (const GLubyte *)current->extensions->words[index];
+}
+
+static void
+mock_glGetIntegerv(GLenum name, GLint *data)
+{
+    int major, minor;
+
+    delay();
+
+    if (!current)
+        return;
+
+    parse_version(current->version + strcspn(current->version, "0123456789"),
+                  &major, &minor);
+
+    switch (name) {
+    case GL_NUM_EXTENSIONS:
+        *data = current->extensions->count;
+        break;
+    case GL_MAJOR_VERSION:
+        *data = major;
+        break;
+    case GL_MINOR_VERSION:
+        *data = minor;
+        break;
+    case GL_CONTEXT_PROFILE_MASK:
+        *data = current->core ? GL_CONTEXT_CORE_PROFILE_BIT :
+            GL_CONTEXT_COMPATIBILITY_PROFILE_BIT;
+        break;
+    case GL_CONTEXT_FLAGS:
+        *data = 0;
+        break;
+    case GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS:
+        *data = 32;
+        break;
+    case GL_MAX_TEXTURE_UNITS:
+        *data = 4;
+        break;
+    default:
+        current->error = GL_INVALID_ENUM;
+        break;
+    }
+}
+
+/* These two are exported like a real driver's entrypoints, since
+ * EPOXY_RESOLVE_CACHE only caches pointers to exported symbols.
+ */
+void mock_glVertexPointer(GLint size, GLenum type, GLsizei stride, const void *pointer);
+void mock_glDrawArrays(GLenum mode, GLint first, GLsizei count);
+
+void
+mock_glVertexPointer(GLint size, GLenum type, GLsizei stride, const void *pointer)
+{
+    delay();
+
+    if (!current)
+        return;
+
+    if (type != GL_FLOAT || size < 1) {
+        current->error = GL_INVALID_ENUM;
+        return;
+    }
+
+    current->vertices = pointer;
+    current->vertex_stride = stride ? stride / sizeof(GLfloat) : size;
+}
+
+void
+mock_glDrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+    float sum = 0;
+    GLsizei i;
+
+    delay();
+
+    if (!current || !current->vertices)
+        return;
+
+    for (i = 0; i < count; i++)
+        sum += current->vertices[(first + i) * current->vertex_stride];
+
+    pthread_mutex_lock(&context_mutex);
+    drawn = sum;
+    pthread_mutex_unlock(&context_mutex);
+}
+
+static GLenum
+mock_glGetError(void)
+{
+    GLenum error;
+
+    delay();
+
+    if (!current)
+        return GL_NO_ERROR;
+
+    error = current->error;
+    current->error = GL_NO_ERROR;
+    return error;
+}
+
+/* EGL */
+
+static EGLint
+mock_eglGetError(void)
+{
+    EGLint error = egl_error;
+
+    egl_error = EGL_SUCCESS;
+    return error;
+}
+
+static EGLDisplay
+mock_eglGetDisplay(EGLNativeDisplayType native_display)
+{
+    delay();
+    return &display;
+}
+
+static EGLDisplay
+mock_eglGetPlatformDisplay(EGLenum platform, void *native_display,
+                           const EGLAttrib *attribs)
+{
+    delay();
+    return &display;
+}
+
+static EGLDisplay
+mock_eglGetPlatformDisplayEXT(EGLenum platform, void *native_display,
+                              const EGLint *attribs)
+{
+    delay();
+    return &display;
+}
+
+static EGLBoolean
+mock_eglInitialize(EGLDisplay dpy, EGLint *major, EGLint *minor)
+{
+    int version_major, version_minor;
+
+    delay();
+
+    if (dpy != &display) {
+        egl_error = EGL_BAD_DISPLAY;
+        return EGL_FALSE;
+    }
+
+    parse_version(get_config()->egl_version, &version_major, &version_minor);
+    if (major)
+        *major = version_major;
+    if (minor)
+        *minor = version_minor;
+
+    display.initialized = true;
+    return EGL_TRUE;
+}
+
+static EGLBoolean
+mock_eglTerminate(EGLDisplay dpy)
+{
+    delay();
+
+    display.initialized = false;
+    return EGL_TRUE;
+}
+
+static const char *
+mock_eglQueryString(EGLDisplay dpy, EGLint name)
+{
+    const struct mock_config *cfg = get_config();
+
+    delay();
+
+    if (dpy == EGL_NO_DISPLAY) {
+        int major, minor;
+
+        parse_version(cfg->egl_version, &major, &minor);
+        if (name == EGL_EXTENSIONS)
+            return cfg->egl_client_extensions.string;
+        /* Only EGL 1.5 has a client version. */
+        if (name == EGL_VERSION && major * 10 + minor >= 15)
+            return cfg->egl_version;
+        egl_error = EGL_BAD_DISPLAY;
+        return NULL;
+    }
+
+    if (dpy != &display || !display.initialized) {
+        egl_error = EGL_NOT_INITIALIZED;
+        return NULL;
+    }
+
+    switch (name) {
+    case EGL_VENDOR:
+        return "Mock";
+    case EGL_VERSION:
+        return cfg->egl_version;
+    case EGL_EXTENSIONS:
+        return cfg->egl_extensions.string;
+    case EGL_CLIENT_APIS:
+        if (has_word(&cfg->apis, "gl") && has_word(&cfg->apis, "gles"))
+            return "OpenGL OpenGL_ES";
+        return has_word(&cfg->apis, "gl") ? "OpenGL" : "OpenGL_ES";
+    }
+
+    egl_error = EGL_BAD_PARAMETER;
+    return NULL;
+}
+
+static EGLBoolean
+mock_eglBindAPI(EGLenum api)
+{
+    const struct mock_config *cfg = get_config();
+
+    delay();
+
+    if ((api != EGL_OPENGL_API && api != EGL_OPENGL_ES_API) ||
+        !has_word(&cfg->apis, api == EGL_OPENGL_API ? "gl" : "gles")) {
+        egl_error = EGL_BAD_PARAMETER;
+        return EGL_FALSE;
+    }
+
+    bound_api = api;
+    return EGL_TRUE;
+}
+
+static EGLenum
+mock_eglQueryAPI(void)
+{
+    delay();
+    return bound_api;
+}
+
+static EGLBoolean
+mock_eglChooseConfig(EGLDisplay dpy, const EGLint *attribs,
+                     EGLConfig *configs, EGLint size, EGLint *count)
+{
+    delay();
+
+    *count = 0;
+    if (configs && size > 0)
+        configs[(*count)++] = &config_placeholder;
+    else if (!configs)
+        *count = 1;
+
+    return EGL_TRUE;
+}
+
+static EGLContext
+mock_eglCreateContext(EGLDisplay dpy, EGLConfig cfg, EGLContext share,
+                      const EGLint *attribs)
+{
+    struct mock_context *ctx;
+    int client_version = 1;
+    bool core = false;
+
+    delay();
+
+    for (; attribs && attribs[0] != EGL_NONE; attribs += 2) {
+        if (attribs[0] == EGL_CONTEXT_CLIENT_VERSION)
+            client_version = attribs[1];
+        else if (attribs[0] == EGL_CONTEXT_OPENGL_PROFILE_MASK)
+            core = attribs[1] & EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT;
+    }
+
+    ctx = create_context(bound_api, client_version, core);
+    if (!ctx) {
+        egl_error = EGL_BAD_MATCH;
+        return EGL_NO_CONTEXT;
+    }
+
+    return ctx;
+}
+
+/* Like real drivers, frees the context once it isn't current anywhere,
+ * and a new one gets the same handle.
+ */
+static void
+destroy_context(struct mock_context *ctx)
+{
+    pthread_mutex_lock(&context_mutex);
+    ctx->destroyed = true;
+    if (ctx->current_count == 0)
+        free_context(ctx);
+    pthread_mutex_unlock(&context_mutex);
+}
+
+static EGLBoolean
+mock_eglDestroyContext(EGLDisplay dpy, EGLContext ctx)
+{
+    delay();
+
+    destroy_context(ctx);
+    return EGL_TRUE;
+}
+
+static EGLBoolean
+mock_eglQueryContext(EGLDisplay dpy, EGLContext context, EGLint attribute,
+                     EGLint *value)
+{
+    struct mock_context *ctx = context;
+
+    delay();
+
+    switch (attribute) {
+    case EGL_CONTEXT_CLIENT_TYPE:
+        *value = ctx->api;
+        return EGL_TRUE;
+    case EGL_CONTEXT_CLIENT_VERSION:
+        *value = ctx->client_version;
+        return EGL_TRUE;
+    }
+
+    egl_error = EGL_BAD_ATTRIBUTE;
+    return EGL_FALSE;
+}
+
+static EGLBoolean
+mock_eglMakeCurrent(EGLDisplay dpy, EGLSurface draw, EGLSurface read,
+                    EGLContext ctx)
+{
+    delay();
+
+    make_current(ctx, false, dpy, draw);
+    return EGL_TRUE;
+}
+
+static EGLContext
+mock_eglGetCurrentContext(void)
+{
+    delay();
+    return current && !current_is_glx ? current : EGL_NO_CONTEXT;
+}
+
+static EGLDisplay
+mock_eglGetCurrentDisplay(void)
+{
+    delay();
+    return current && !current_is_glx ? current_display : EGL_NO_DISPLAY;
+}
+
+static EGLSurface
+mock_eglGetCurrentSurface(EGLint readdraw)
+{
+    delay();
+    return current && !current_is_glx ? current_drawable : EGL_NO_SURFACE;
+}
+
+static EGLBoolean
+mock_eglSwapBuffers(EGLDisplay dpy, EGLSurface surface)
+{
+    delay();
+    return EGL_TRUE;
+}
+
+static EGLBoolean
+mock_eglReleaseThread(void)
+{
+    delay();
+
+    make_current(NULL, false, NULL, NULL);
+    return EGL_TRUE;
+}
+
+/* GLX, with the X types left opaque. */
+
+static const char *
+mock_glXQueryExtensionsString(void *dpy, int screen)
+{
+    delay();
+    return get_config()->glx_extensions.string;
+}
+
+static const char *
+mock_glXGetClientString(void *dpy, int name)
+{
+    const struct mock_config *cfg = get_config();
+
+    delay();
+
+    switch (name) {
+    case GLX_VENDOR:
+        return "Mock";
+    case GLX_VERSION:
+        return cfg->glx_version;
+    case GLX_EXTENSIONS:
+        return cfg->glx_extensions.string;
+    }
+
+    return NULL;
+}
+
+static const char *
+mock_glXQueryServerString(void *dpy, int screen, int name)
+{
+    return mock_glXGetClientString(dpy, name);
+}
+
+static int
+mock_glXQueryVersion(void *dpy, int *major, int *minor)
+{
+    delay();
+
+    parse_version(get_config()->glx_version, major, minor);
+    return true;
+}
+
+static void *
+mock_glXCreateContext(void *dpy, void *visual, void *share, int direct)
+{
+    delay();
+    return create_context(EGL_OPENGL_API, 0, false);
+}
+
+static void *
+mock_glXCreateNewContext(void *dpy, void *fbconfig, int render_type,
+                         void *share, int direct)
+{
+    delay();
+    return create_context(EGL_OPENGL_API, 0, false);
+}
+
+static void *
+mock_glXCreateContextAttribsARB(void *dpy, void *fbconfig, void *share,
+                                int direct, const int *attribs)
+{
+    int profile = 0;
+
+    delay();
+
+    for (; attribs && attribs[0]; attribs += 2) {
+        if (attribs[0] == GLX_CONTEXT_PROFILE_MASK_ARB)
+            profile = attribs[1];
+    }
+
+    if (profile & GLX_CONTEXT_ES2_PROFILE_BIT_EXT)
+        return create_context(EGL_OPENGL_ES_API, 2, false);
+
+    return create_context(EGL_OPENGL_API, 0, profile & 1);
+}
+
+static void
+mock_glXDestroyContext(void *dpy, void *ctx)
+{
+    delay();
+
+    destroy_context(ctx);
+}
+
+static int
+mock_glXMakeContextCurrent(void *dpy, unsigned long draw, unsigned long read,
+                           void *ctx)
+{
+    delay();
+
+    make_current(ctx, true, dpy, (void *)draw);
+    return true;
+}
+
+static int
+mock_glXMakeCurrent(void *dpy, unsigned long drawable, void *ctx)
+{
+    return mock_glXMakeContextCurrent(dpy, drawable, drawable, ctx);
+}
+
+static void *
+mock_glXGetCurrentContext(void)
+{
+    delay();
+    return current && current_is_glx ? current : NULL;
+}
+
+static void *
+mock_glXGetCurrentDisplay(void)
+{
+    delay();
+    return current && current_is_glx ? current_display : NULL;
+}
+
+static unsigned long
+mock_glXGetCurrentDrawable(void)
+{
+    delay();
+    return current && current_is_glx ? (unsigned long)current_drawable : 0;
+}
+
+static int
+mock_glXQueryContext(void *dpy, void *ctx, int attribute, int *value)
+{
+    delay();
+
+    if (attribute != GLX_SCREEN)
+        return 2; /* GLX_BAD_ATTRIBUTE */
+
+    *value = 0;
+    return 0;
+}
+
+static void
+mock_glXSwapBuffers(void *dpy, unsigned long drawable)
+{
+    delay();
+}
+
+/* Whatever else gets called. */
+static uintptr_t
+mock_stub(void)
+{
+    delay();
+    return 0;
+}
+
+static const struct mock_function {
+    const char *name;
+    void *func;
+} mock_functions[] = {
+#define FUNC(name) { #name, (void *)mock_##name }
+    FUNC(glGetString),
+    FUNC(glGetStringi),
+    FUNC(glGetIntegerv),
+    FUNC(glGetError),
+    FUNC(glVertexPointer),
+    FUNC(glDrawArrays),
+    FUNC(eglGetError),
+    FUNC(eglGetDisplay),
+    FUNC(eglGetPlatformDisplay),
+    FUNC(eglGetPlatformDisplayEXT),
+    FUNC(eglInitialize),
+    FUNC(eglTerminate),
+    FUNC(eglQueryString),
+    FUNC(eglBindAPI),
+    FUNC(eglQueryAPI),
+    FUNC(eglChooseConfig),
+    FUNC(eglCreateContext),
+    FUNC(eglDestroyContext),
+    FUNC(eglQueryContext),
+    FUNC(eglMakeCurrent),
+    FUNC(eglGetCurrentContext),
+    FUNC(eglGetCurrentDisplay),
+    FUNC(eglGetCurrentSurface),
+    FUNC(eglSwapBuffers),
+    FUNC(eglReleaseThread),
+    FUNC(glXQueryExtensionsString),
+    FUNC(glXGetClientString),
+    FUNC(glXQueryServerString),
+    FUNC(glXQueryVersion),
+    FUNC(glXCreateContext),
+    FUNC(glXCreateNewContext),
+    FUNC(glXCreateContextAttribsARB),
+    FUNC(glXDestroyContext),
+    FUNC(glXMakeContextCurrent),
+    FUNC(glXMakeCurrent),
+    FUNC(glXGetCurrentContext),
+    FUNC(glXGetCurrentDisplay),
+    FUNC(glXGetCurrentDrawable),
+    FUNC(glXQueryContext),
+    FUNC(glXSwapBuffers),
+#undef FUNC
+};
+
+static void *
+find_function(const char *name)
+{
+    unsigned i;
+
+    for (i = 0; i < ARRAY_SIZE(mock_functions); i++) {
+        if (strcmp(mock_functions[i].name, name) == 0)
+            return mock_functions[i].func;
+    }
+
+    return (void *)mock_stub;
+}
+
+static void
+count_lookup(const char *name, bool proc_address)
+{
+    unsigned i;
+
+    pthread_mutex_lock(&lookup_mutex);
+    for (i = 0; i < MAX_LOOKUP_NAMES; i++) {
+        if (!lookup_counts[i].name)
+            lookup_counts[i].name = strdup(name);
+        if (strcmp(lookup_counts[i].name, name) == 0) {
+            if (proc_address)
+                lookup_counts[i].proc_address++;
+            else
+                lookup_counts[i].dlsym++;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&lookup_mutex);
+}
+
+bool
+mock_driver_has_library(const char *filename)
+{
+    const struct mock_config *cfg = get_config();
+
+    if (strncmp(filename, "libEGL.", 7) == 0)
+        return has_word(&cfg->window_systems, "egl");
+    if (strncmp(filename, "libGL.", 6) == 0 ||
+        strncmp(filename, "libGLX.", 7) == 0)
+        return has_word(&cfg->window_systems, "glx") &&
+            has_word(&cfg->apis, "gl");
+    if (strncmp(filename, "libOpenGL.", 10) == 0)
+        return has_word(&cfg->apis, "gl");
+    if (strncmp(filename, "libGLES", 7) == 0)
+        return has_word(&cfg->apis, "gles");
+
+    return false;
+}
+
+void *
+mock_driver_dlsym(const char *filename, const char *name)
+{
+    bool in_library;
+
+    /* Each library only has its own API's entrypoints. */
+    if (strncmp(filename, "libEGL.", 7) == 0)
+        in_library = strncmp(name, "egl", 3) == 0;
+    else if (strncmp(filename, "libGLX.", 7) == 0)
+        in_library = strncmp(name, "glX", 3) == 0;
+    else if (strncmp(filename, "libGL.", 6) == 0)
+        in_library = strncmp(name, "gl", 2) == 0;
+    else
+        in_library = strncmp(name, "gl", 2) == 0 && strncmp(name, "glX", 3) != 0;
+
+    if (!in_library || !matches_pattern(&get_config()->dlsym, name))
+        return NULL;
+
+    count_lookup(name, false);
+    return find_function(name);
+}
+
+void *
+mock_driver_get_proc_address(const char *name)
+{
+    if (!matches_pattern(&get_config()->proc_address, name))
+        return NULL;
+
+    count_lookup(name, true);
+    return find_function(name);
+}
+
+void
+mock_driver_lookups(const char *name, unsigned *dlsym_count,
+                    unsigned *proc_address_count)
+{
+    unsigned i;
+
+    *dlsym_count = 0;
+    *proc_address_count = 0;
+
+    pthread_mutex_lock(&lookup_mutex);
+    for (i = 0; i < MAX_LOOKUP_NAMES && lookup_counts[i].name; i++) {
+        if (strcmp(lookup_counts[i].name, name) == 0) {
+            *dlsym_count = lookup_counts[i].dlsym;
+            *proc_address_count = lookup_counts[i].proc_address;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&lookup_mutex);
+}
+
+float
+mock_driver_drawn(void)
+{
+    float sum;
+
+    pthread_mutex_lock(&context_mutex);
+    sum = drawn;
+    pthread_mutex_unlock(&context_mutex);
+
+    return sum;
+}
+
+void
+mock_driver_set_config(const char *name, const char *value)
+{
+    const struct config_key *key;
+
+    get_config();
+
+    key = find_key(name);
+    if (!key) {
+        fprintf(stderr, "mock driver: unknown key %s\n", name);
+        abort();
+    }
+    set_value(key, value);
+}
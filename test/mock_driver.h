@@ -0,0 +1,126 @@
+/*
+ * Copyright © 2026 The libepoxy contributors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * @file mock_driver.h
+ *
+ * A fake GL, EGL and GLX driver that dlwrap.c hands out instead of the
+ * real libraries when it's built into the mock driver library.
+ */
+
+#ifndef MOCK_DRIVER_H
+#define MOCK_DRIVER_H
+
+#include <err.h>
+#include <stdbool.h>
+
+#include "epoxy/egl.h"
+
+/**
+ * Returns whether the configuration has the given library, one of the
+ * ones dlwrap.c wraps.
+ */
+bool
+mock_driver_has_library(const char *filename);
+
+/**
+ * Returns what dlsym() on the given library finds for name, or NULL.
+ */
+void *
+mock_driver_dlsym(const char *filename, const char *name);
+
+/**
+ * Returns what glXGetProcAddress() or eglGetProcAddress() return for
+ * name, or NULL.
+ */
+void *
+mock_driver_get_proc_address(const char *name);
+
+/**
+ * Returns how many times name has been looked up with dlsym() and with
+ * GetProcAddress.
+ */
+void
+mock_driver_lookups(const char *name, unsigned *dlsym_count,
+                    unsigned *proc_address_count);
+
+/**
+ * Returns the sum of the first coordinates of the vertices that the last
+ * glDrawArrays() on any thread read from its glVertexPointer() array.
+ */
+float
+mock_driver_drawn(void);
+
+/**
+ * Changes a value of the configuration, as if the driver was set up
+ * differently from then on.  The strings it returned for the old value
+ * get freed, and nothing may be calling into it meanwhile.
+ */
+void
+mock_driver_set_config(const char *name, const char *value);
+
+/*
+ * What the tests set up through epoxy.  These go through epoxy's entrypoints,
+ * which the driver library itself doesn't link against, so they're inline
+ * here rather than in mock_driver.c.
+ */
+
+/**
+ * Gets and initializes the default EGL display, exiting if it can't.  The
+ * driver reads its configuration when epoxy first loads it, so the
+ * environment has to be set up before this.
+ */
+static inline EGLDisplay
+mock_driver_init_egl(void)
+{
+    EGLDisplay dpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    if (!eglInitialize(dpy, NULL, NULL))
+        errx(1, "Couldn't initialize the display");
+
+    return dpy;
+}
+
+/**
+ * Creates a context for api on dpy with the given attributes, exiting if
+ * it can't.
+ */
+static inline EGLContext
+mock_driver_create_egl_context(EGLDisplay dpy, EGLenum api, const EGLint *attribs)
+{
+    EGLConfig cfg;
+    EGLint count;
+    EGLContext ctx;
+
+    if (!eglBindAPI(api) ||
+        !eglChooseConfig(dpy, NULL, &cfg, 1, &count) || !count)
+        errx(1, "Couldn't choose a config");
+
+    ctx = eglCreateContext(dpy, cfg, EGL_NO_CONTEXT, attribs);
+    if (!ctx)
+        errx(1, "Couldn't create a context");
+
+    return ctx;
+}
+
+#endif /* MOCK_DRIVER_H */